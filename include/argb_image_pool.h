@@ -0,0 +1,50 @@
+#ifndef ARGB_IMAGE_POOL_H_GUARD
+#define ARGB_IMAGE_POOL_H_GUARD
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+
+#include <QImage>
+#include <QSize>
+
+// ArgbImagePool - keeps released ARGB32 QImages keyed by size so that a
+// renderer flipping between a few resolutions (e.g. 360p/540p/720p under
+// bandwidth adaptation) reuses backing stores instead of reallocating.
+//
+// Idle images are kept in LRU order and the oldest are freed once their
+// total size exceeds the byte budget. Images handed out by Acquire() are
+// owned by the caller and do not count against the budget. Not thread-safe.
+class ArgbImagePool {
+ public:
+  explicit ArgbImagePool(size_t budget_bytes);
+
+  ArgbImagePool(const ArgbImagePool&) = delete;
+  ArgbImagePool& operator=(const ArgbImagePool&) = delete;
+
+  // Returns an image of |size|, reusing an idle one if available. The
+  // contents are unspecified. Returns a null image for an empty size.
+  QImage Acquire(const QSize& size);
+
+  // Gives |image| back to the pool. Null images are ignored. The caller
+  // must not keep other copies, or the pooled image would be shared.
+  void Release(QImage image);
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  uint64_t evictions() const { return evictions_; }
+  size_t idle_bytes() const { return idle_bytes_; }
+
+ private:
+  void EvictToBudget();
+
+  const size_t budget_bytes_;
+  // Most recently released first.
+  std::list<QImage> idle_;
+  size_t idle_bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+#endif  // ARGB_IMAGE_POOL_H_GUARD
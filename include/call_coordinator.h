@@ -1,6 +1,9 @@
 #ifndef CALL_COORDINATOR_H_GUARD
 #define CALL_COORDINATOR_H_GUARD
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <mutex>
@@ -13,6 +16,7 @@
 
 #include "api/environment/environment.h"
 #include "api/peer_connection_interface.h"
+#include "rtc_base/thread.h"
 #include "webrtcengine.h"
 
 #ifdef QT_NO_EMIT_DEFINED
@@ -36,6 +40,7 @@ class RTCStatsReport;
 class CallCoordinator : public WebRTCEngineObserver,
                         public SignalClientObserver,
                         public CallManagerObserver,
+                        public FileTransferObserver,
                         public ICallController {
  public:
   explicit CallCoordinator(const webrtc::Environment& env);
@@ -58,18 +63,35 @@ class CallCoordinator : public WebRTCEngineObserver,
   CallState GetCallState() const override;
   std::string GetCurrentPeerId() const override;
   std::string GetClientId() const override;
-  RtcStatsSnapshot GetLatestRtcStats() override;
+  RtcStatsSnapshot GetLatestRtcStats() const override;
+  void SetVideoSendConstraints(const VideoSendConstraints& constraints) override;
+  bool SendFile(const std::string& path_utf8) override;
+  void CancelFileTransfer(uint32_t id, bool outgoing) override;
+  void SetStatsSampleInterval(int interval_ms) override;
+  StatsSummary GetStatsSummary(StatsMetric metric, int window_seconds) const override;
+  std::vector<StatsSample> GetStatsHistory(int window_seconds) const override;
 
  private:
   // WebRTCEngineObserver 实现
   void OnLocalVideoTrackAdded(webrtc::VideoTrackInterface* track) override;
-  void OnRemoteVideoTrackAdded(webrtc::VideoTrackInterface* track) override;
-  void OnRemoteVideoTrackRemoved() override;
-  void OnIceConnectionStateChanged(webrtc::PeerConnectionInterface::IceConnectionState state) override;
-  void OnOfferCreated(const std::string& sdp) override;
-  void OnAnswerCreated(const std::string& sdp) override;
-  void OnIceCandidateGenerated(const std::string& sdp_mid, int sdp_mline_index, const std::string& candidate) override;
-  void OnError(const std::string& error) override;
+  void OnRemoteVideoTrackAdded(const std::string& peer_id, webrtc::VideoTrackInterface* track) override;
+  void OnRemoteVideoTrackRemoved(const std::string& peer_id) override;
+  void OnIceConnectionStateChanged(const std::string& peer_id,
+                                   webrtc::PeerConnectionInterface::IceConnectionState state) override;
+  void OnOfferCreated(const std::string& peer_id, const std::string& sdp) override;
+  void OnAnswerCreated(const std::string& peer_id, const std::string& sdp) override;
+  void OnIceCandidateGenerated(const std::string& peer_id, const std::string& sdp_mid,
+                               int sdp_mline_index, const std::string& candidate) override;
+  void OnIceGatheringComplete(const std::string& peer_id) override;
+  void OnIceRestarting(const std::string& peer_id, int attempt) override;
+  void OnIceRecovered(const std::string& peer_id, int64_t recovery_ms, int restarts) override;
+  void OnDataChannelStateChanged(const std::string& peer_id, const std::string& label,
+                                 webrtc::DataChannelInterface::DataState state) override;
+  void OnDataChannelMessage(const std::string& peer_id, const std::string& label,
+                            const webrtc::CopyOnWriteBuffer& data, bool binary) override;
+  void OnDataChannelBufferedAmountChange(const std::string& peer_id, const std::string& label,
+                                         uint64_t sent_data_size) override;
+  void OnError(const std::string& peer_id, const std::string& error) override;
   
   // SignalClientObserver 实现
   void OnConnected(const std::string& client_id) override;
@@ -79,12 +101,14 @@ class CallCoordinator : public WebRTCEngineObserver,
   void OnClientListUpdate(const QJsonArray& clients) override;
   void OnUserOffline(const std::string& client_id) override;
   void OnCallRequest(const std::string& from, const QJsonObject& payload) override;
-  void OnCallResponse(const std::string& from, bool accepted, const std::string& reason) override;
+  void OnCallResponse(const std::string& from, bool accepted, const std::string& reason,
+                      const QJsonObject& payload) override;
   void OnCallCancel(const std::string& from, const std::string& reason) override;
   void OnCallEnd(const std::string& from, const std::string& reason) override;
   void OnOffer(const std::string& from, const QJsonObject& sdp) override;
   void OnAnswer(const std::string& from, const QJsonObject& sdp) override;
   void OnIceCandidate(const std::string& from, const QJsonObject& candidate) override;
+  void OnIceCandidates(const std::string& from, const QJsonArray& candidates) override;
 
   // CallManagerObserver 实现
   void OnCallStateChanged(CallState state, const std::string& peer_id) override;
@@ -95,13 +119,57 @@ class CallCoordinator : public WebRTCEngineObserver,
   void OnCallEnded(const std::string& peer_id, const std::string& reason) override;
   void OnCallTimeout() override;
   void OnNeedCreatePeerConnection(const std::string& peer_id, bool is_caller) override;
+  void OnNeedPreparePeerConnection(const std::string& peer_id, bool is_caller) override;
   void OnNeedClosePeerConnection() override;
+  
+  // FileTransferObserver 实现
+  void OnFileTransferProgress(const FileTransferProgress& progress) override;
 
  private:
+  class StatsSamplerCallback;
+  
   void ProcessOffer(const std::string& from, const QJsonObject& sdp);
   void ProcessAnswer(const std::string& from, const QJsonObject& sdp);
   void ProcessIceCandidate(const std::string& from, const QJsonObject& candidate);
-  void ExtractAndStoreRtcStats(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report);
+  void ProcessIceCandidates(const std::string& from, const QJsonArray& candidates);
+  // 发出 |peer_id| 攒下的本地候选；候选被扣住时不发。仅在 UI 线程调用
+  void FlushLocalIceCandidates(const std::string& peer_id);
+  // 呼叫请求发出前对端还没有会话，先扣住发给它的候选；发出后放行。
+  // 仅在 UI 线程调用
+  void HoldLocalIceCandidates(const std::string& peer_id);
+  void ReleaseLocalIceCandidates(const std::string& peer_id);
+  // 文件传输通道：主叫在 CreateOffer 之前创建；会话建好后创建传输管理器
+  void CreateFileChannel(const std::string& peer_id);
+  void StartFileTransfer(const std::string& peer_id);
+  // 通话中通道意外关闭时由主叫重建，未完成的传输随之续传；仅在 UI 线程调用
+  void ReopenFileChannel(const std::string& peer_id);
+  // 先停止文件传输和统计采样再关闭会话
+  void ClosePeerConnection(const std::string& peer_id);
+  // 当前通话对端；任意线程调用
+  void SetCurrentPeer(const std::string& peer_id, bool is_caller);
+  bool IsCurrentPeer(const std::string& peer_id) const;
+  // 置位/取走快速路径标志；只有登记的对端能取走，任意线程调用
+  void ArmFastPath(bool& flag, const std::string& peer_id);
+  bool TakeFastPath(bool& flag, const std::string& peer_id);
+  // 把 video_send_constraints_ 应用到与 |peer_id| 的会话
+  bool ApplyVideoSendConstraints(const std::string& peer_id);
+  // 后台统计采样：通话开始时按最长通话时长分配历史，之后每个间隔在
+  // stats_thread_ 上发起一次 GetStats，结果在信令线程经 OnSampledStats 写入
+  void StartStatsSampling(const std::string& peer_id);
+  void StopStatsSampling(const std::string& peer_id);
+  void SampleStats();
+  // |generation| 是发起该次采样时的 stats_generation_
+  void OnSampledStats(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report,
+                      uint64_t generation);
+  // 原地更新 last_stats_；报告为空时返回 false，last_stats_ 不变
+  bool ExtractAndStoreRtcStats(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report);
+  // 每个采样间隔在 stats_thread_ 上更新 last_stats_ 中的 CPU 占用，
+  // 并报告给引擎供编解码器选择
+  void SampleCpuLoad();
+  // 两次调用之间的进程 CPU 占用；仅在 stats_thread_ 上调用
+  double SampleProcessCpuPercent();
+  // 两次调用之间各引擎线程的 CPU 占用；仅在 stats_thread_ 上调用
+  std::vector<ThreadCpuStats> SampleThreadCpu();
   std::string IceStateToString(webrtc::PeerConnectionInterface::IceConnectionState state) const;
 
   // 组件
@@ -113,11 +181,34 @@ class CallCoordinator : public WebRTCEngineObserver,
   // 观察者
   ICallUIObserver* ui_observer_;
   
-  // 状态
+  // 状态；当前对端在 UI 线程改写，WebRTC 回调线程持锁读取
+  mutable std::mutex peer_mutex_;
   std::string current_peer_id_;
   bool is_caller_;
   std::vector<IceServerConfig> ice_servers_;
   std::string last_ice_state_;
+  VideoSendConstraints video_send_constraints_;  // 仅在 UI 线程访问
+  
+  // 本地候选按对端攒批：WebRTC 线程追加，UI 线程取走发送
+  std::mutex ice_batch_mutex_;
+  std::map<std::string, QJsonArray> pending_local_candidates_;
+  std::string held_candidates_peer_id_;  // 候选暂不发出的对端
+  
+  // 当前通话的文件传输；UI 线程创建和销毁，WebRTC 线程持锁转发通道事件
+  std::mutex file_transfer_mutex_;
+  std::unique_ptr<FileTransferManager> file_transfer_;
+  std::string file_transfer_peer_id_;
+  std::atomic<int> file_channel_reopen_attempts_{0};
+  
+  // 快速建连：offer 随 call-request、answer 随 call-response 发送
+  // 以下两个标志在 UI 线程置位，在 WebRTC 回调线程按对端取走；受 fast_path_mutex_ 保护
+  std::mutex fast_path_mutex_;
+  std::string fast_path_peer_id_;        // 标志所属的对端，其他会话的回调不能取走
+  bool offer_for_call_request_ = false;   // 主叫：下一个 offer 随呼叫请求发出
+  bool answer_for_call_response_ = false; // 被叫：下一个 answer 随接受响应发出
+  bool offer_sent_in_request_ = false;  // 主叫：offer 已随呼叫请求发出
+  QJsonObject bundled_remote_offer_;    // 被叫：来电自带的 offer
+  QJsonObject bundled_remote_answer_;   // 主叫：接受响应自带的 answer
 
   mutable std::mutex stats_mutex_;
   RtcStatsSnapshot last_stats_;
@@ -129,6 +220,25 @@ class CallCoordinator : public WebRTCEngineObserver,
     bool valid = false;
   };
   RateSample last_rate_sample_;
+  // 本次呼叫开始建连的时间，ICE 连通后清零；受 stats_mutex_ 保护
+  int64_t call_setup_start_ms_ = 0;
+  bool call_setup_pooled_ = false;
+  
+  // 后台统计采样；stats_history_ 自带锁
+  std::unique_ptr<webrtc::Thread> stats_thread_;
+  webrtc::scoped_refptr<StatsSamplerCallback> stats_callback_;  // 每次采样复用
+  std::atomic<int> stats_sample_interval_ms_;
+  std::mutex stats_sampler_mutex_;
+  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> stats_peer_connection_;
+  std::string stats_peer_id_;
+  uint64_t stats_generation_ = 0;  // 每次开始/停止采样递增
+  StatsHistory stats_history_;
+  
+  // 进程 CPU 采样点，仅在 stats_thread_ 上访问
+  int64_t last_cpu_time_ns_ = 0;
+  int64_t last_cpu_wall_ns_ = 0;
+  std::map<std::string, int64_t> last_thread_cpu_ns_;
+  int64_t last_thread_cpu_wall_ns_ = 0;
 };
 
 #endif  // CALL_COORDINATOR_H_GUARD
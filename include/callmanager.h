@@ -42,6 +42,9 @@ class CallManagerObserver {
   
   // 需要创建/关闭对等连接
   virtual void OnNeedCreatePeerConnection(const std::string& peer_id, bool is_caller) = 0;
+  // 呼叫请求发出/收到时预创建对等连接以提前收集 ICE 候选；
+  // 呼叫未接通时通过 OnNeedClosePeerConnection 丢弃
+  virtual void OnNeedPreparePeerConnection(const std::string& peer_id, bool is_caller) = 0;
   virtual void OnNeedClosePeerConnection() = 0;
 };
 
@@ -59,14 +62,20 @@ class CallManager : public QObject {
   // 注册观察者
   void RegisterObserver(CallManagerObserver* observer);
   
-  // 发起呼叫
-  bool InitiateCall(const QString& target_client_id);
+  // 发起呼叫。|bundle_offer| 为 true 时先不发送呼叫请求，等观察者在
+  // OnNeedPreparePeerConnection 中建好 offer 后通过 SendPendingCallRequest 一起发出
+  bool InitiateCall(const QString& target_client_id, bool bundle_offer = false);
+  bool IsCallRequestPending() const { return call_request_pending_; }
+  // 发出等待中的呼叫请求，|offer| 为空时退回普通请求；呼叫已结束时返回 false
+  bool SendPendingCallRequest(const QJsonObject& offer);
   
   // 取消呼叫（主叫方）
   void CancelCall();
   
-  // 接听呼叫（被叫方）
+  // 接听呼叫（被叫方）。来电自带 offer 时接受响应会推迟到 answer 生成后，
+  // 由 SendAcceptWithAnswer 发出
   void AcceptCall();
+  bool SendAcceptWithAnswer(const QJsonObject& answer);
   
   // 拒绝呼叫（被叫方）
   void RejectCall(const QString& reason = QString());
@@ -83,7 +92,7 @@ class CallManager : public QObject {
   void NotifyPeerConnectionEstablished();
   
   // 处理来自信令服务器的消息（由Conductor调用）
-  void HandleCallRequest(const QString& from);
+  void HandleCallRequest(const QString& from, bool offer_included = false);
   void HandleCallResponse(const QString& from, bool accepted, const QString& reason);
   void HandleCallCancel(const QString& from, const QString& reason);
   void HandleCallEnd(const QString& from, const QString& reason);
@@ -107,6 +116,8 @@ class CallManager : public QObject {
   CallState call_state_;
   QString current_peer_;
   bool is_caller_;  // 是否是主叫方
+  bool call_request_pending_;  // 主叫：呼叫请求等待 offer 后再发送
+  bool accept_with_answer_;    // 被叫：接受响应等待 answer 后再发送
   
   std::unique_ptr<QTimer> call_request_timer_;
   
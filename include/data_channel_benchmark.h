@@ -0,0 +1,21 @@
+#ifndef DATA_CHANNEL_BENCHMARK_H_GUARD
+#define DATA_CHANNEL_BENCHMARK_H_GUARD
+
+namespace webrtc {
+class Environment;
+}
+
+// Command line switch that runs RunDataChannelBenchmark() instead of the UI.
+extern const char kDataChannelBenchmarkSwitch[];
+
+// Measures WebRTCEngine data channels between two engines in the same
+// process, connected over loopback with SDP and candidates relayed in
+// memory. First the round trip of small messages echoed on a reliable
+// ordered channel, then the throughput of a bulk transfer on a reliable
+// ordered, a reliable unordered and an unordered no-retransmit channel,
+// paced on buffered_amount(). Every send shares one preallocated buffer.
+// Results are printed to stdout and the WebRTC log. Needs sockets and SSL
+// initialised. Returns the process exit code.
+int RunDataChannelBenchmark(const webrtc::Environment& env);
+
+#endif  // DATA_CHANNEL_BENCHMARK_H_GUARD
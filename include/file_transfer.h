@@ -0,0 +1,137 @@
+#ifndef FILE_TRANSFER_H_GUARD
+#define FILE_TRANSFER_H_GUARD
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "rtc_base/copy_on_write_buffer.h"
+#include "rtc_base/thread.h"
+
+enum class FileTransferState {
+  kWaiting,    // Offered, the receiver has not answered yet
+  kActive,
+  kPaused,     // The channel closed; resumes when it opens again
+  kCompleted,
+  kFailed,
+  kCancelled,
+};
+
+// Snapshot of one transfer, reported on every state change and at most
+// every 250 ms while data moves.
+struct FileTransferProgress {
+  uint32_t id = 0;  // Chosen by the sending side
+  bool outgoing = true;
+  std::string name;  // File name without directories, UTF-8
+  uint64_t size = 0;
+  // Sending: bytes handed to the channel. Receiving: bytes on disk.
+  uint64_t transferred = 0;
+  // Since the previous report; for a completed transfer, over its lifetime.
+  double bytes_per_second = 0.0;
+  FileTransferState state = FileTransferState::kWaiting;
+  std::string error;
+};
+
+// The data channel a FileTransferManager runs on. It must be reliable and
+// ordered. Both methods may be called from any thread.
+class FileTransferTransport {
+ public:
+  virtual ~FileTransferTransport() = default;
+  // Returns false if the channel is not open or cannot queue |message|.
+  virtual bool Send(webrtc::CopyOnWriteBuffer message) = 0;
+  virtual uint64_t BufferedAmount() const = 0;
+};
+
+class FileTransferObserver {
+ public:
+  virtual ~FileTransferObserver() = default;
+  // Called on the manager's own thread.
+  virtual void OnFileTransferProgress(const FileTransferProgress& progress) = 0;
+};
+
+// Sends and receives files in chunks over one data channel, in both
+// directions at once. Outgoing files take turns chunk by chunk, and sending
+// stops while more than 1 MiB is queued in the channel, continuing when
+// OnBufferedAmountChange() reports it drained below 256 KiB. When the
+// channel closes, unfinished transfers pause; once a channel opens again
+// the sender offers them anew and the receiver answers with the number of
+// bytes it already has, so each transfer continues where it stopped.
+// Received files are written to "<name>.part" in the receive directory and
+// renamed when complete. File I/O runs on the manager's own thread; every
+// public method may be called from any thread.
+class FileTransferManager {
+ public:
+  FileTransferManager(std::unique_ptr<FileTransferTransport> transport,
+                      FileTransferObserver* observer,
+                      std::filesystem::path receive_directory);
+  // Reports unfinished transfers as failed; partial files are kept.
+  ~FileTransferManager();
+
+  FileTransferManager(const FileTransferManager&) = delete;
+  FileTransferManager& operator=(const FileTransferManager&) = delete;
+
+  // Queues |path| for sending and returns the transfer id. Errors, such as
+  // a file that cannot be opened, are reported through the observer.
+  uint32_t SendFile(const std::filesystem::path& path);
+  void Cancel(uint32_t id, bool outgoing);
+
+  // Data channel events.
+  void OnChannelOpen();
+  void OnChannelClosed();
+  void OnMessage(const webrtc::CopyOnWriteBuffer& message);
+  void OnBufferedAmountChange();
+
+ private:
+  struct Transfer {
+    FileTransferProgress progress;
+    int64_t start_ms = 0;
+    int64_t last_report_ms = 0;
+    uint64_t last_report_bytes = 0;
+  };
+  struct Outgoing : Transfer {
+    std::ifstream file;
+    uint64_t next_offset = 0;  // Next byte to hand to the channel
+  };
+  struct Incoming : Transfer {
+    std::filesystem::path path;          // Final name
+    std::filesystem::path partial_path;  // Written while incomplete
+    std::ofstream file;
+  };
+
+  // The rest runs on |thread_|.
+  void StartSending(uint32_t id, const std::filesystem::path& path);
+  void SendOffer(uint32_t id, Outgoing& transfer);
+  void HandleMessage(const webrtc::CopyOnWriteBuffer& message);
+  void HandleOffer(uint32_t id, uint64_t size, const std::string& name);
+  void HandleAccept(uint32_t id, uint64_t offset);
+  void HandleData(uint32_t id, uint64_t offset, const uint8_t* data, size_t size);
+  void HandleComplete(uint32_t id);
+  void FinishIncoming(uint32_t id, Incoming& transfer);
+  void CancelTransfer(uint32_t id, bool outgoing, bool notify_peer);
+  void FailOutgoing(Outgoing& transfer, const std::string& error);
+  void FailIncoming(Incoming& transfer, const std::string& error);
+  void Pump();
+  Outgoing* NextToSend(uint32_t* id);
+  void Report(Transfer& transfer, bool force);
+
+  const std::unique_ptr<FileTransferTransport> transport_;
+  FileTransferObserver* const observer_;
+  const std::filesystem::path receive_directory_;
+  std::unique_ptr<webrtc::Thread> thread_;
+  std::atomic<uint32_t> next_id_{1};
+  std::atomic<bool> pump_scheduled_{false};
+
+  bool channel_open_ = false;
+  std::map<uint32_t, Outgoing> outgoing_;
+  std::map<uint32_t, Incoming> incoming_;
+  uint32_t last_sent_id_ = 0;  // Round-robin position among outgoing files
+};
+
+// UTF-8 text to a path, for names that come from the UI or from the peer.
+std::filesystem::path PathFromUtf8(const std::string& text);
+
+#endif  // FILE_TRANSFER_H_GUARD
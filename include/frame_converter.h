@@ -0,0 +1,125 @@
+#ifndef FRAME_CONVERTER_H_GUARD
+#define FRAME_CONVERTER_H_GUARD
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "api/function_view.h"
+#include "api/scoped_refptr.h"
+#include "api/video/i010_buffer.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video/video_rotation.h"
+#include "common_video/include/video_frame_buffer_pool.h"
+#include "slice_worker_pool.h"
+
+// FrameConverter - turns a webrtc::VideoFrame into an ARGB image of an
+// arbitrary size. Scaling is done in YUV space before the colour conversion,
+// so the expensive per-pixel work runs at the output resolution. I420, NV12,
+// I422, I444 and 10-bit I010 buffers (and native buffers that map to I420
+// or NV12) are converted in their own layout without an intermediate I420
+// copy. Rotated frames are scaled, then rotated into a pooled buffer, never
+// reallocated.
+//
+// Not thread-safe; intended to be owned and used by a single renderer on
+// its UI thread. Scratch buffers are pooled and reused between frames. With
+// SetWorkerThreads() the final ARGB conversion of large outputs is split
+// into horizontal stripes that run on a persistent worker pool.
+class FrameConverter {
+ public:
+  FrameConverter();
+  ~FrameConverter();
+
+  FrameConverter(const FrameConverter&) = delete;
+  FrameConverter& operator=(const FrameConverter&) = delete;
+
+  // Width/height of |frame| after its rotation has been applied.
+  static int RotatedWidth(const webrtc::VideoFrame& frame);
+  static int RotatedHeight(const webrtc::VideoFrame& frame);
+
+  // Number of extra threads used for striped conversion; 0 (the default)
+  // converts on the calling thread only. Outputs smaller than 720p are
+  // always converted single-threaded.
+  void SetWorkerThreads(int num_threads);
+
+  // Converts |frame| into |dst_argb|, scaled to |dst_width| x |dst_height|.
+  // Returns false if the frame could not be converted.
+  bool ConvertToArgb(const webrtc::VideoFrame& frame,
+                     uint8_t* dst_argb,
+                     int dst_stride,
+                     int dst_width,
+                     int dst_height);
+
+  // Re-converts only |region| (in frame pixels) of an unrotated frame into
+  // |dst_argb|, which must already hold the previous frame at the same
+  // size. Rows and columns are rounded outwards to even positions. For
+  // scaled output the region is patched into a source-resolution ARGB copy
+  // of the frame, and only the output pixels it maps to are rescaled from
+  // that copy; the first call after a full conversion builds the copy and
+  // rescales the whole output once. Returns false for layouts this path
+  // does not handle (anything but I420, NV12 and native buffers that map
+  // to them); convert the whole frame then.
+  bool ConvertRegionToArgb(const webrtc::VideoFrame& frame,
+                           const webrtc::VideoFrame::UpdateRect& region,
+                           uint8_t* dst_argb,
+                           int dst_stride,
+                           int dst_width,
+                           int dst_height);
+
+ private:
+  // Runs |convert| over horizontal stripes of |height| rows, in parallel
+  // when a worker pool is configured and the output is large enough.
+  void ForEachStripe(int width, int height,
+                     webrtc::FunctionView<void(int first_row, int num_rows)>
+                         convert);
+  void I420ToArgbStriped(const webrtc::I420BufferInterface& src,
+                         uint8_t* dst_argb, int dst_stride);
+  bool ConvertRotated(
+      const webrtc::scoped_refptr<webrtc::VideoFrameBuffer>& buffer,
+      webrtc::VideoRotation rotation,
+      uint8_t* dst_argb, int dst_stride,
+      int dst_width, int dst_height);
+  // Return |src| itself if it already has the requested size, otherwise a
+  // pooled buffer (kept alive by |holder|) with the scaled picture.
+  const webrtc::I420BufferInterface* ScaleI420(
+      const webrtc::I420BufferInterface& src, int width, int height,
+      webrtc::scoped_refptr<webrtc::I420Buffer>* holder);
+  const webrtc::NV12BufferInterface* ScaleNV12(
+      const webrtc::NV12BufferInterface& src, int width, int height,
+      webrtc::scoped_refptr<webrtc::NV12Buffer>* holder);
+  bool ConvertI420(const webrtc::I420BufferInterface& src,
+                   uint8_t* dst_argb, int dst_stride,
+                   int dst_width, int dst_height);
+  bool ConvertNV12(const webrtc::NV12BufferInterface& src,
+                   uint8_t* dst_argb, int dst_stride,
+                   int dst_width, int dst_height);
+  bool ConvertI422(const webrtc::I422BufferInterface& src,
+                   uint8_t* dst_argb, int dst_stride,
+                   int dst_width, int dst_height);
+  bool ConvertI444(const webrtc::I444BufferInterface& src,
+                   uint8_t* dst_argb, int dst_stride,
+                   int dst_width, int dst_height);
+  bool ConvertI010(const webrtc::I010BufferInterface& src,
+                   uint8_t* dst_argb, int dst_stride,
+                   int dst_width, int dst_height);
+
+  // Separate pools so buffers of different sizes do not evict each other.
+  webrtc::VideoFrameBufferPool scale_pool_;
+  webrtc::VideoFrameBufferPool rotate_pool_;
+  std::unique_ptr<SliceWorkerPool> workers_;
+
+  // Source-resolution ARGB copy of the last frame, kept by
+  // ConvertRegionToArgb() for scaled output. Only valid while the output
+  // was last written from it, at |scaled_width_| x |scaled_height_|.
+  std::vector<uint8_t> source_argb_;
+  int source_width_ = 0;
+  int source_height_ = 0;
+  int scaled_width_ = 0;
+  int scaled_height_ = 0;
+  bool source_argb_valid_ = false;
+};
+
+#endif  // FRAME_CONVERTER_H_GUARD
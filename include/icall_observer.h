@@ -3,8 +3,12 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 #include "api/media_stream_interface.h"
 #include "callmanager.h"
+#include "file_transfer.h"
+#include "render_stats.h"
+#include "stats_history.h"
 #include <QJsonArray>
 
 // UI观察者接口 - 定义UI层需要实现的回调方法
@@ -35,10 +39,56 @@ class ICallUIObserver {
   // 呼叫状态回调
   virtual void OnCallStateChanged(CallState state, const std::string& peer_id) = 0;
   virtual void OnIncomingCall(const std::string& caller_id) = 0;
+  
+  // 文件传输进度，在传输线程调用
+  virtual void OnFileTransferProgress(const FileTransferProgress& progress) = 0;
 };
 
 // 业务控制接口 - 定义UI层可以调用的业务方法
 // UI层通过这个接口与业务层交互，而不是直接调用内部组件
+// 呼叫建立耗时：从开始建连到 ICE 连通，按是否取自预热连接池分别统计
+struct CallSetupStats {
+  double last_ms = 0.0;
+  bool last_pooled = false;
+  int pooled_count = 0;
+  double pooled_avg_ms = 0.0;
+  int fresh_count = 0;
+  double fresh_avg_ms = 0.0;
+  int idle_pooled_connections = 0;  // 当前池中可用的预热连接
+};
+
+// ICE 中断恢复：从 disconnected/failed 到重新连通的耗时，跨呼叫累计
+struct IceRecoveryStats {
+  bool recovering = false;  // 当前通话的 ICE 正处于中断中
+  int count = 0;            // 已恢复的中断次数
+  int restarts = 0;         // 累计发起的 ICE 重启次数
+  double last_ms = 0.0;
+  double avg_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+// 视频降级方式：带宽或 CPU 不足时优先保住什么
+enum class VideoDegradationMode {
+  kBalanced,            // WebRTC 默认
+  kMaintainFramerate,   // 保帧率、降分辨率，适合人像
+  kMaintainResolution,  // 保分辨率、降帧率，适合屏幕内容
+};
+
+// 视频发送约束，数值为 0 表示不限制
+struct VideoSendConstraints {
+  int max_bitrate_kbps = 0;
+  int min_bitrate_kbps = 0;
+  double max_framerate = 0.0;
+  VideoDegradationMode degradation = VideoDegradationMode::kBalanced;
+};
+
+// 引擎线程在两次查询之间的 CPU 占用，用来核对线程放置是否生效
+struct ThreadCpuStats {
+  std::string name;
+  std::string placement;  // 配置的 CPU 与优先级
+  double cpu_percent = 0.0;
+};
+
 struct RtcStatsSnapshot {
   bool valid = false;
   std::string ice_state;
@@ -53,7 +103,25 @@ struct RtcStatsSnapshot {
   double inbound_video_fps = 0.0;
   int inbound_video_width = 0;
   int inbound_video_height = 0;
+  // 协商后实际使用的视频编解码器，如 "H264"；未知时为空
+  std::string outbound_video_codec;
+  std::string inbound_video_codec;
+  // 视频 sender 上实际生效的限制，以及编码器当前受限的原因
+  // (WebRTC 的 qualityLimitationReason：none/cpu/bandwidth/other)
+  bool video_send_constraints_valid = false;
+  VideoSendConstraints video_send_constraints;
+  std::string quality_limitation_reason;
   uint64_t timestamp_ms = 0;
+  // 本地预览与远端视频的渲染统计（与RTC统计独立，valid各自判断）；
+  // 由界面从渲染器取得后填入，GetLatestRtcStats 不填
+  RenderStatsSnapshot local_render;
+  RenderStatsSnapshot remote_render;
+  CallSetupStats call_setup;
+  IceRecoveryStats ice_recovery;
+  // 进程 CPU 占用（两次采样之间，按单核折算，可超过 100%）与活跃会话数
+  double process_cpu_percent = 0.0;
+  int active_peer_connections = 0;
+  std::vector<ThreadCpuStats> thread_cpu;
 };
 
 class ICallController {
@@ -81,8 +149,26 @@ class ICallController {
   virtual std::string GetCurrentPeerId() const = 0;
   virtual std::string GetClientId() const = 0;
   
-  // WebRTC实时数据
-  virtual RtcStatsSnapshot GetLatestRtcStats() = 0;
+  // WebRTC实时数据和 CPU 占用，需在UI线程调用。都来自后台采样的最近
+  // 一次结果，调用本身不发起 GetStats，也没有副作用；渲染统计由界面
+  // 自己从渲染器取得
+  virtual RtcStatsSnapshot GetLatestRtcStats() const = 0;
+  
+  // 通话期间后台按此间隔采样统计(毫秒)，下一次采样起生效
+  virtual void SetStatsSampleInterval(int interval_ms) = 0;
+  // 当前(或刚结束的)通话最近 |window_seconds| 秒内某项指标的分布，
+  // <= 0 表示整个通话；可在任意线程调用
+  virtual StatsSummary GetStatsSummary(StatsMetric metric, int window_seconds) const = 0;
+  // 同一窗口内的原始采样，按时间先后
+  virtual std::vector<StatsSample> GetStatsHistory(int window_seconds) const = 0;
+  
+  // 视频发送约束：通话中立即生效，之后的通话也沿用
+  virtual void SetVideoSendConstraints(const VideoSendConstraints& constraints) = 0;
+  
+  // 文件传输，仅在通话中可用：|path_utf8| 为本地文件路径，失败返回 false；
+  // 进度和结果经 OnFileTransferProgress 通知
+  virtual bool SendFile(const std::string& path_utf8) = 0;
+  virtual void CancelFileTransfer(uint32_t id, bool outgoing) = 0;
 };
 
 #endif  // ICALL_OBSERVER_H_GUARD
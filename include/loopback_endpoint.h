@@ -0,0 +1,122 @@
+#ifndef LOOPBACK_ENDPOINT_H_GUARD
+#define LOOPBACK_ENDPOINT_H_GUARD
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/thread_annotations.h"
+#include "webrtcengine.h"
+
+namespace webrtc {
+class Environment;
+}
+
+class LoopbackEndpoint;
+
+// In-process signaling for the benchmarks: hands SDP and candidates from one
+// endpoint to another in memory. Every engine call is made on the relay
+// thread, which keeps each engine's single-caller contract; the engines call
+// back on their own signaling threads.
+class LoopbackRelay {
+ public:
+  // Starts the relay thread under |thread_name|.
+  explicit LoopbackRelay(const char* thread_name);
+
+  LoopbackRelay(const LoopbackRelay&) = delete;
+  LoopbackRelay& operator=(const LoopbackRelay&) = delete;
+
+  webrtc::Thread* thread() const { return thread_.get(); }
+
+  // Registers |endpoint| and initializes its engine on the relay thread.
+  // The endpoint must stay alive until Shutdown().
+  bool Add(LoopbackEndpoint* endpoint);
+  // Shuts down every registered engine on the relay thread, then stops it.
+  void Shutdown();
+
+  // Relay thread only.
+  LoopbackEndpoint* Find(const std::string& id) const;
+
+ private:
+  const std::unique_ptr<webrtc::Thread> thread_;
+  std::map<std::string, LoopbackEndpoint*> endpoints_;
+};
+
+// One engine plus the observer that forwards its signaling through the
+// relay. Tracks the sessions whose ICE is connected and the data channels
+// that are open; every other callback is a no-op hook that a benchmark
+// overrides as needed. Subclasses that override a tracking callback call
+// the base version too.
+class LoopbackEndpoint : public WebRTCEngineObserver {
+ public:
+  LoopbackEndpoint(const std::string& id,
+                   const webrtc::Environment& env,
+                   LoopbackRelay* relay);
+
+  LoopbackEndpoint(const LoopbackEndpoint&) = delete;
+  LoopbackEndpoint& operator=(const LoopbackEndpoint&) = delete;
+
+  const std::string& id() const { return id_; }
+  WebRTCEngine& engine() { return engine_; }
+
+  int connected_peers() const;
+  bool is_open(const std::string& label) const;
+
+  // Polls until |count| sessions are connected; false after |timeout_ms|.
+  bool WaitForConnectedPeers(int count, int timeout_ms) const;
+
+  void OnLocalVideoTrackAdded(webrtc::VideoTrackInterface* track) override {}
+  void OnRemoteVideoTrackAdded(const std::string& peer_id,
+                               webrtc::VideoTrackInterface* track) override {}
+  void OnRemoteVideoTrackRemoved(const std::string& peer_id) override {}
+
+  void OnIceConnectionStateChanged(
+      const std::string& peer_id,
+      webrtc::PeerConnectionInterface::IceConnectionState state) override;
+
+  // Signaling goes to the endpoint registered under |peer_id|
+  void OnOfferCreated(const std::string& peer_id,
+                      const std::string& sdp) final;
+  void OnAnswerCreated(const std::string& peer_id,
+                       const std::string& sdp) final;
+  void OnIceCandidateGenerated(const std::string& peer_id,
+                               const std::string& sdp_mid,
+                               int sdp_mline_index,
+                               const std::string& candidate) final;
+
+  void OnIceGatheringComplete(const std::string& peer_id) override {}
+  void OnIceRestarting(const std::string& peer_id, int attempt) override {}
+  void OnIceRecovered(const std::string& peer_id, int64_t recovery_ms,
+                      int restarts) override {}
+
+  void OnDataChannelStateChanged(
+      const std::string& peer_id,
+      const std::string& label,
+      webrtc::DataChannelInterface::DataState state) override;
+  void OnDataChannelMessage(const std::string& peer_id,
+                            const std::string& label,
+                            const webrtc::CopyOnWriteBuffer& data,
+                            bool binary) override {}
+  void OnDataChannelBufferedAmountChange(const std::string& peer_id,
+                                         const std::string& label,
+                                         uint64_t sent_data_size) override {}
+
+  void OnError(const std::string& peer_id, const std::string& error) override;
+
+ private:
+  const std::string id_;
+  LoopbackRelay* const relay_;
+  WebRTCEngine engine_;
+  mutable webrtc::Mutex mutex_;
+  std::set<std::string> connected_ RTC_GUARDED_BY(mutex_);
+  std::set<std::string> open_ RTC_GUARDED_BY(mutex_);
+};
+
+// Prints one result line to stdout and the WebRTC log.
+void ReportBenchmarkLine(const std::string& line);
+
+#endif  // LOOPBACK_ENDPOINT_H_GUARD
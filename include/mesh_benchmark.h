@@ -0,0 +1,20 @@
+#ifndef MESH_BENCHMARK_H_GUARD
+#define MESH_BENCHMARK_H_GUARD
+
+namespace webrtc {
+class Environment;
+}
+
+// Command line switch that runs RunMeshBenchmark() instead of the UI.
+extern const char kMeshBenchmarkSwitch[];
+
+// Measures what each extra peer costs a multi-peer WebRTCEngine. A hub
+// engine sends its shared capture source to 1..5 leaf engines in the same
+// process, connected over loopback with SDP and candidates relayed in
+// memory. After each peer connects, process CPU is sampled over a fixed
+// window; the per-peer increment includes the leaf's decoding as well as
+// the hub's extra encoder. Results are printed to stdout and the WebRTC
+// log. Needs sockets and SSL initialised. Returns the process exit code.
+int RunMeshBenchmark(const webrtc::Environment& env);
+
+#endif  // MESH_BENCHMARK_H_GUARD
@@ -0,0 +1,13 @@
+#ifndef RENDER_BENCHMARK_H_GUARD
+#define RENDER_BENCHMARK_H_GUARD
+
+// Command line switch that runs RunRenderBenchmark() instead of the UI.
+extern const char kRenderBenchmarkSwitch[];
+
+// Times FrameConverter on 10-bit I010 frames at 1080p and 4K: the direct
+// I010 -> ARGB path against the old ToI420() + I420 -> ARGB path, both at
+// the source size and scaled to a 720p view. Results are printed to stdout
+// and the WebRTC log. Returns the process exit code.
+int RunRenderBenchmark();
+
+#endif  // RENDER_BENCHMARK_H_GUARD
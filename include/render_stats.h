@@ -0,0 +1,76 @@
+#ifndef RENDER_STATS_H_GUARD
+#define RENDER_STATS_H_GUARD
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Distribution of one render-path duration over a stats window.
+struct RenderLatencyStats {
+  int count = 0;
+  double avg_ms = 0.0;
+  double p50_ms = 0.0;
+  double p95_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+// Render-side health of one VideoRenderer. Counters are cumulative for the
+// renderer's lifetime; rates and latencies cover the window since the
+// previous snapshot.
+struct RenderStatsSnapshot {
+  bool valid = false;
+  uint64_t frames_received = 0;
+  uint64_t frames_painted = 0;
+  // Replaced by a newer frame before they could be painted.
+  uint64_t frames_skipped = 0;
+  double painted_fps = 0.0;
+  // YUV -> ARGB conversion, including re-conversions after a resize.
+  RenderLatencyStats convert;
+  // From OnFrame to the paintEvent that drew the frame.
+  RenderLatencyStats queue_to_paint;
+  // From VideoFrame::timestamp_us to paint. For received video this is the
+  // jitter buffer's render time, so it shows how late frames are drawn.
+  RenderLatencyStats capture_to_paint;
+  // ARGB image pool reuse across resolution changes, cumulative.
+  uint64_t image_pool_hits = 0;
+  uint64_t image_pool_misses = 0;
+  uint64_t image_pool_evictions = 0;
+  uint64_t image_pool_idle_bytes = 0;
+};
+
+std::string RenderStatsToString(const RenderStatsSnapshot& stats);
+
+// RenderStatsCollector - accumulates the UI-thread side of
+// RenderStatsSnapshot. Not thread-safe; the renderer owns it and only
+// touches it from paintEvent and TakeSnapshot().
+class RenderStatsCollector {
+ public:
+  RenderStatsCollector();
+  ~RenderStatsCollector();
+
+  RenderStatsCollector(const RenderStatsCollector&) = delete;
+  RenderStatsCollector& operator=(const RenderStatsCollector&) = delete;
+
+  void AddConversion(int64_t duration_us);
+  // |capture_us| may be 0 when the frame carries no timestamp.
+  void AddPaintedFrame(int64_t arrival_us, int64_t capture_us,
+                       int64_t paint_us);
+
+  // Builds a snapshot and starts a new window. |frames_received| and
+  // |frames_skipped| come from the producer-side counters.
+  RenderStatsSnapshot TakeSnapshot(uint64_t frames_received,
+                                   uint64_t frames_skipped,
+                                   int64_t now_us);
+
+ private:
+  class Window;
+
+  std::unique_ptr<Window> convert_;
+  std::unique_ptr<Window> queue_to_paint_;
+  std::unique_ptr<Window> capture_to_paint_;
+  uint64_t frames_painted_ = 0;
+  uint64_t window_start_painted_ = 0;
+  int64_t window_start_us_ = 0;
+};
+
+#endif  // RENDER_STATS_H_GUARD
@@ -30,6 +30,7 @@ enum class SignalMessageType {
     Offer,              // SDP Offer
     Answer,             // SDP Answer
     IceCandidate,       // ICE候选
+    IceCandidates,      // 一批ICE候选
     Unknown
 };
 
@@ -52,7 +53,8 @@ class SignalClientObserver {
   
   // 呼叫相关
   virtual void OnCallRequest(const std::string& from, const QJsonObject& payload) = 0;
-  virtual void OnCallResponse(const std::string& from, bool accepted, const std::string& reason) = 0;
+  virtual void OnCallResponse(const std::string& from, bool accepted, const std::string& reason,
+                              const QJsonObject& payload) = 0;
   virtual void OnCallCancel(const std::string& from, const std::string& reason) = 0;
   virtual void OnCallEnd(const std::string& from, const std::string& reason) = 0;
   
@@ -60,6 +62,7 @@ class SignalClientObserver {
   virtual void OnOffer(const std::string& from, const QJsonObject& sdp) = 0;
   virtual void OnAnswer(const std::string& from, const QJsonObject& sdp) = 0;
   virtual void OnIceCandidate(const std::string& from, const QJsonObject& candidate) = 0;
+  virtual void OnIceCandidates(const std::string& from, const QJsonArray& candidates) = 0;
 };
 
 // WebSocket信令客户端
@@ -85,13 +88,18 @@ class SignalClient : public QObject {
   void RegisterObserver(SignalClientObserver* observer);
   
   // 发送消息
-  void SendCallRequest(const QString& to);
-  void SendCallResponse(const QString& to, bool accepted, const QString& reason = QString());
+  // |offer|/|answer| 非空时随呼叫请求/响应一起发送(快速建连)，
+  // 不支持的对端会忽略这两个字段，仍走单独的 offer/answer 流程
+  void SendCallRequest(const QString& to, const QJsonObject& offer = QJsonObject());
+  void SendCallResponse(const QString& to, bool accepted, const QString& reason = QString(),
+                        const QJsonObject& answer = QJsonObject());
   void SendCallCancel(const QString& to, const QString& reason = QString());
   void SendCallEnd(const QString& to, const QString& reason = QString());
   void SendOffer(const QString& to, const QJsonObject& sdp);
   void SendAnswer(const QString& to, const QJsonObject& sdp);
   void SendIceCandidate(const QString& to, const QJsonObject& candidate);
+  // 一条 ice-candidates 消息携带多个候选，元素格式与 SendIceCandidate 相同
+  void SendIceCandidates(const QString& to, const QJsonArray& candidates);
   void RequestClientList();
 
  signals:
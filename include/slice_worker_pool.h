@@ -0,0 +1,50 @@
+#ifndef SLICE_WORKER_POOL_H_GUARD
+#define SLICE_WORKER_POOL_H_GUARD
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "api/function_view.h"
+
+// SliceWorkerPool - a small set of persistent threads that run one job split
+// into slices. The calling thread works on slices as well and ParallelFor()
+// only returns once every slice has finished, so callers can hand out
+// pointers into their own buffers without further synchronisation. Jobs are
+// passed as FunctionView, so dispatching a job never allocates.
+class SliceWorkerPool {
+ public:
+  explicit SliceWorkerPool(int num_workers);
+  ~SliceWorkerPool();
+
+  SliceWorkerPool(const SliceWorkerPool&) = delete;
+  SliceWorkerPool& operator=(const SliceWorkerPool&) = delete;
+
+  int num_workers() const { return static_cast<int>(workers_.size()); }
+
+  // Runs job(i) for every i in [0, num_slices) and blocks until all are done.
+  // Must not be called concurrently from several threads.
+  void ParallelFor(int num_slices, webrtc::FunctionView<void(int)> job);
+
+ private:
+  void WorkerLoop();
+  // Claims and runs slices of the current job. Called with |lock| held,
+  // returns with it held.
+  void RunSlices(std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  webrtc::FunctionView<void(int)>* job_ = nullptr;
+  int num_slices_ = 0;
+  int next_slice_ = 0;
+  int pending_slices_ = 0;
+  int active_workers_ = 0;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+#endif  // SLICE_WORKER_POOL_H_GUARD
@@ -0,0 +1,91 @@
+#ifndef STATS_HISTORY_H_GUARD
+#define STATS_HISTORY_H_GUARD
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rtc_base/synchronization/mutex.h"
+
+// Metrics kept per stats sample; indexes into StatsSample::values.
+enum class StatsMetric {
+  kOutboundBitrateKbps,
+  kInboundBitrateKbps,
+  kRttMs,
+  kAudioJitterMs,
+  kAudioPacketLossPercent,
+  kVideoPacketLossPercent,
+  kVideoFps,
+};
+inline constexpr size_t kStatsMetricCount = 7;
+
+// One sample, fixed size so the whole history can be allocated up front.
+// A NaN value means the metric was not available in that sample.
+struct StatsSample {
+  int64_t time_ms = 0;  // webrtc::TimeMillis() when it was recorded
+  std::array<float, kStatsMetricCount> values{};
+
+  float& operator[](StatsMetric metric) {
+    return values[static_cast<size_t>(metric)];
+  }
+  float operator[](StatsMetric metric) const {
+    return values[static_cast<size_t>(metric)];
+  }
+};
+
+// Distribution of one metric over a window; all zero when |count| is 0.
+struct StatsSummary {
+  int count = 0;
+  double min = 0.0;
+  double avg = 0.0;
+  double p95 = 0.0;
+  double max = 0.0;
+};
+
+// StatsHistory - ring buffer of StatsSample. Reset() sizes it for the
+// longest call expected; after that Add() and Summarize() never allocate,
+// and once full the oldest samples are overwritten. Thread-safe.
+class StatsHistory {
+ public:
+  StatsHistory();
+  ~StatsHistory();
+
+  StatsHistory(const StatsHistory&) = delete;
+  StatsHistory& operator=(const StatsHistory&) = delete;
+
+  // Drops every sample and makes room for |capacity| of them. Allocates
+  // only when |capacity| exceeds what was reserved before.
+  void Reset(size_t capacity);
+  void Add(const StatsSample& sample);
+
+  size_t size() const;
+  size_t capacity() const;
+
+  // Over samples newer than |now_ms| - |window_ms|, or over all of them
+  // when |window_ms| <= 0. NaN values are skipped.
+  StatsSummary Summarize(StatsMetric metric,
+                         int64_t window_ms,
+                         int64_t now_ms) const;
+  // The same window, oldest first. Replaces the contents of |samples|.
+  void GetSamples(int64_t window_ms,
+                  int64_t now_ms,
+                  std::vector<StatsSample>* samples) const;
+
+ private:
+  // Number of newest samples inside the window.
+  size_t CountInWindow(int64_t window_ms, int64_t now_ms) const
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // The |age|-th newest sample, 0 being the latest.
+  const StatsSample& Newest(size_t age) const
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable webrtc::Mutex mutex_;
+  std::vector<StatsSample> ring_ RTC_GUARDED_BY(mutex_);
+  size_t next_ RTC_GUARDED_BY(mutex_) = 0;  // Slot the next sample goes to
+  size_t size_ RTC_GUARDED_BY(mutex_) = 0;
+  // Sorted in place for the percentile, same capacity as |ring_|.
+  mutable std::vector<float> scratch_ RTC_GUARDED_BY(mutex_);
+};
+
+#endif  // STATS_HISTORY_H_GUARD
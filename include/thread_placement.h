@@ -0,0 +1,85 @@
+#ifndef THREAD_PLACEMENT_H_GUARD
+#define THREAD_PLACEMENT_H_GUARD
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "api/task_queue/task_queue_factory.h"
+#include "rtc_base/platform_thread.h"
+
+// Where a thread may run and at what scheduling priority. An empty
+// placement leaves the thread as the OS created it.
+struct ThreadPlacement {
+  std::vector<int> cpus;  // Allowed CPU indices; empty means any CPU.
+  std::optional<webrtc::ThreadPriority> priority;
+
+  bool empty() const { return cpus.empty() && !priority; }
+};
+
+// Thread layout of a WebRTCEngine. Without dedicated threads the
+// PeerConnectionFactory creates its own network and worker threads, which
+// can be neither placed nor measured.
+struct EngineThreadConfig {
+  bool dedicated_network_thread = false;
+  bool dedicated_worker_thread = false;
+  ThreadPlacement signaling;
+  ThreadPlacement network;
+  ThreadPlacement worker;
+  // Applies to task queues created for the local capture source, i.e. the
+  // frame generator fallback. A real camera delivers frames on a thread
+  // owned by the OS capture stack, which this does not reach.
+  ThreadPlacement capture;
+};
+
+// Pins the calling thread to |placement.cpus| and sets its priority. On
+// Windows this maps to SetThreadAffinityMask/SetThreadPriority, on Linux to
+// pthread_setaffinity_np and nice values (SCHED_FIFO for kRealtime, which
+// needs CAP_SYS_NICE, as does raising priority above normal). Returns false
+// and logs if any part could not be applied.
+bool ApplyThreadPlacement(const ThreadPlacement& placement);
+
+// Parses a spec such as "network=2,3:high;worker=4-5;capture=1:low" into
+// |config|. Names are signaling, network, worker and capture; the CPU list
+// may be empty ("worker=:high"), priorities are low, normal, high and
+// realtime. Naming network or worker also makes that thread dedicated.
+// Returns false on a malformed spec, leaving |config| unchanged.
+bool ParseEngineThreadConfig(const std::string& spec,
+                             EngineThreadConfig* config);
+
+// "2,3 high"-style description for logs.
+std::string ThreadPlacementToString(const ThreadPlacement& placement);
+
+// Wraps |base| so that every task queue it creates applies |placement| to
+// its thread before running anything else. |base| must outlive the result.
+std::unique_ptr<webrtc::TaskQueueFactory> CreatePlacedTaskQueueFactory(
+    const webrtc::TaskQueueFactory& base,
+    const ThreadPlacement& placement);
+
+// CPU time consumed by one thread, readable from any other thread without
+// running anything on it. BindToCurrentThread() must be called on the
+// measured thread, once, before the first read. Uses a duplicated thread
+// handle and GetThreadTimes on Windows, pthread_getcpuclockid on Linux.
+class ThreadCpuClock {
+ public:
+  ThreadCpuClock() = default;
+  ~ThreadCpuClock();
+  ThreadCpuClock(const ThreadCpuClock&) = delete;
+  ThreadCpuClock& operator=(const ThreadCpuClock&) = delete;
+
+  // Returns false where the platform has no per-thread clock.
+  bool BindToCurrentThread();
+  // Total user and kernel time in nanoseconds, or -1 if unbound or the
+  // thread can no longer be queried.
+  int64_t CpuTimeNanos() const;
+
+ private:
+  void Release();
+
+  bool bound_ = false;
+  intptr_t native_ = 0;  // HANDLE on Windows, clockid_t on Linux.
+};
+
+#endif  // THREAD_PLACEMENT_H_GUARD
@@ -0,0 +1,77 @@
+#ifndef TRIPLE_BUFFER_H_GUARD
+#define TRIPLE_BUFFER_H_GUARD
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single-producer / single-consumer triple buffer.
+//
+// The producer always owns one slot (back), the consumer always owns one slot
+// (front), and the third slot (ready) is handed over through a single atomic
+// index swap. Neither side ever waits for the other: the producer overwrites
+// the ready slot if the consumer has not picked it up yet, and the consumer
+// always sees the newest complete value.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Producer side. The returned slot is exclusively owned by the producer
+  // until the next Publish().
+  T& back() { return slots_[back_index_]; }
+
+  // Hands the back slot to the consumer. Returns true if this overwrote a
+  // value the consumer never picked up.
+  bool Publish() {
+    const int previous = ready_.exchange(back_index_ | kFreshBit,
+                                         std::memory_order_acq_rel);
+    back_index_ = previous & kIndexMask;
+    const bool overwritten = (previous & kFreshBit) != 0;
+    if (overwritten) {
+      overwritten_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return overwritten;
+  }
+
+  // Consumer side. Swaps in the newest published value if there is one.
+  // Returns true if front() changed.
+  bool Consume() {
+    if ((ready_.load(std::memory_order_acquire) & kFreshBit) == 0) {
+      return false;
+    }
+    const int previous = ready_.exchange(front_index_,
+                                         std::memory_order_acq_rel);
+    front_index_ = previous & kIndexMask;
+    return true;
+  }
+
+  // Consumer side. Valid until the next Consume().
+  T& front() { return slots_[front_index_]; }
+  const T& front() const { return slots_[front_index_]; }
+
+  // True if a value has been published that the consumer has not taken.
+  bool HasPending() const {
+    return (ready_.load(std::memory_order_acquire) & kFreshBit) != 0;
+  }
+
+  // Number of published values that were replaced before being consumed.
+  uint64_t overwritten_count() const {
+    return overwritten_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int kIndexMask = 0x3;
+  static constexpr int kFreshBit = 0x4;
+
+  std::array<T, 3> slots_;
+  int back_index_ = 0;                // producer only
+  std::atomic<int> ready_{1};         // shared, index | kFreshBit
+  int front_index_ = 2;               // consumer only
+  std::atomic<uint64_t> overwritten_count_{0};
+};
+
+#endif  // TRIPLE_BUFFER_H_GUARD
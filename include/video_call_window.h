@@ -1,8 +1,10 @@
 #ifndef VIDEO_CALL_WINDOW_H_GUARD
 #define VIDEO_CALL_WINDOW_H_GUARD
 
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 // Fix Qt emit macro conflict with WebRTC sigslot
 #ifdef emit
@@ -60,6 +62,7 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
   void OnClientListUpdate(const QJsonArray& clients) override;
   void OnCallStateChanged(CallState state, const std::string& peer_id) override;
   void OnIncomingCall(const std::string& caller_id) override;
+  void OnFileTransferProgress(const FileTransferProgress& progress) override;
 
  private slots:
   // 连接相关
@@ -72,6 +75,7 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
   // 呼叫控制
   void OnCallButtonClicked();
   void OnHangupButtonClicked();
+  void OnSendFileButtonClicked();
   
   // 定时更新
   void OnUpdateStatsTimer();
@@ -79,6 +83,10 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
  protected:
   void closeEvent(QCloseEvent* event) override;
   void resizeEvent(QResizeEvent* event) override;
+  void changeEvent(QEvent* event) override;
+  void showEvent(QShowEvent* event) override;
+  void hideEvent(QHideEvent* event) override;
+  bool eventFilter(QObject* watched, QEvent* event) override;
 
  private:
   void CreateUI();
@@ -92,12 +100,19 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
   void UpdateUIState();
   void UpdateCallButtonState();
   void LayoutLocalVideo();
+  void UpdateRendererOcclusion();
   void UpdateStatsUI(const RtcStatsSnapshot& stats);
   QString FormatBitrate(double kbps) const;
   QString FormatPercentage(double value) const;
   QString FormatDouble(double value, int precision) const;
   QString FormatResolution(int width, int height) const;
   QString FormatTimestamp(uint64_t timestamp_ms) const;
+  QString FormatLatency(const RenderLatencyStats& latency) const;
+  void UpdateRenderStatsUI(const RtcStatsSnapshot& stats);
+  void UpdateCallSetupStatsUI(const CallSetupStats& setup);
+  void UpdateFileTransferLabel();
+  void UpdateStatsHistoryUI();
+  QString FormatFileSize(uint64_t bytes) const;
   
   QString GetCallStateString(CallState state) const;
   void AppendLogInternal(const QString& message, const QString& level);
@@ -135,16 +150,37 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
   QLabel* stats_outbound_bitrate_value_;
   QLabel* stats_inbound_bitrate_value_;
   QLabel* stats_rtt_value_;
+  QLabel* stats_rtt_window_value_;
+  QLabel* stats_outbound_window_value_;
   QLabel* stats_audio_jitter_value_;
   QLabel* stats_audio_loss_value_;
   QLabel* stats_video_loss_value_;
   QLabel* stats_video_fps_value_;
   QLabel* stats_video_resolution_value_;
+  QLabel* stats_video_codec_value_;
+  QLabel* stats_video_limits_value_;
+  QLabel* stats_render_fps_value_;
+  QLabel* stats_render_skipped_value_;
+  QLabel* stats_render_convert_value_;
+  QLabel* stats_render_queue_value_;
+  QLabel* stats_render_capture_value_;
+  QLabel* stats_render_pool_value_;
+  QLabel* stats_local_render_value_;
+  QLabel* stats_call_setup_value_;
+  QLabel* stats_call_setup_compare_value_;
+  QLabel* stats_ice_recovery_value_;
+  QLabel* stats_cpu_value_;
+  QLabel* stats_thread_cpu_value_;
   
   QWidget* control_panel_;
   QPushButton* call_button_;
   QPushButton* hangup_button_;
+  QPushButton* send_file_button_;
   QLabel* call_info_label_;
+  QLabel* file_transfer_label_;
+  
+  // 进行中的文件传输，按 (是否发送, ID) 索引；结束后移除
+  std::map<std::pair<bool, uint32_t>, FileTransferProgress> file_transfers_;
   
   QSplitter* main_splitter_;
   QSplitter* right_splitter_;
@@ -155,6 +191,9 @@ class VideoCallWindow : public QMainWindow, public ICallUIObserver {
   
   // 定时器
   std::unique_ptr<QTimer> stats_timer_;
+
+  // 是否已监听窗口句柄的Expose事件
+  bool watching_expose_ = false;
 };
 
 #endif  // VIDEO_CALL_WINDOW_H_GUARD
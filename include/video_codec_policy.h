@@ -0,0 +1,40 @@
+#ifndef VIDEO_CODEC_POLICY_H_GUARD
+#define VIDEO_CODEC_POLICY_H_GUARD
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "api/rtp_parameters.h"
+
+// Which video codecs a call should prefer. Codec names are matched case
+// insensitively against RtpCodecCapability::name (VP8, VP9, H264, AV1).
+struct VideoCodecPolicy {
+  // Codecs listed here go first, in this order; codecs not listed follow
+  // in the order the factory reports them.
+  std::vector<std::string> preferred_order = {"H264", "VP8", "VP9", "AV1"};
+  // Process CPU (percent of one core) the client may use once the new
+  // encoder runs. Codecs whose estimated cost does not fit in what the
+  // current load leaves are left out; if none fits, only the cheapest one
+  // is kept. 0 disables the budget.
+  double cpu_budget_percent = 0.0;
+};
+
+// Rough cost of one software encoder at 720p30, in percent of one core.
+// Unknown codecs are treated like the most expensive known one.
+double EstimatedEncoderCpuPercent(const std::string& codec_name);
+
+// Upper-case names of the codecs offered in the video m-sections of |sdp|.
+std::set<std::string> ParseVideoCodecNames(const std::string& sdp);
+
+// Orders |capabilities| according to |policy|, the current process load
+// and, if known, the codecs the remote side supports. Retransmission and
+// FEC entries are kept at the end. Returns an empty list when no media
+// codec would remain, in which case the preferences should not be set.
+std::vector<webrtc::RtpCodecCapability> SelectVideoCodecs(
+    const std::vector<webrtc::RtpCodecCapability>& capabilities,
+    const VideoCodecPolicy& policy,
+    double current_cpu_percent,
+    const std::set<std::string>* remote_codecs);
+
+#endif  // VIDEO_CODEC_POLICY_H_GUARD
@@ -1,13 +1,19 @@
 #ifndef EXAMPLES_PEERCONNECTION_CLIENT_VIDEORENDERER_H_
 #define EXAMPLES_PEERCONNECTION_CLIENT_VIDEORENDERER_H_
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 #include "api/media_stream_interface.h"
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
+#include "argb_image_pool.h"
+#include "frame_converter.h"
+#include "render_stats.h"
+#include "triple_buffer.h"
 
 #include <QWidget>
 #include <QImage>
@@ -24,26 +30,98 @@ class VideoRenderer : public QWidget,
   void SetVideoTrack(webrtc::VideoTrackInterface* track_to_render);
   void Stop();
 
+  // Opt-in: ask the track's source for frames no larger than this widget
+  // in device pixels and no faster than the screen refreshes, updated on
+  // resize. Meant for the local preview, whose capturer can then adapt
+  // the preview sink without touching the encoder's stream.
+  void SetAdaptiveSinkWants(bool enabled);
+
+  // While occluded the renderer stays detached from its track, so neither
+  // the source nor this renderer spends time on frames nobody can see. On
+  // becoming visible again it re-attaches and asks the source for a
+  // refresh frame.
+  void SetOccluded(bool occluded);
+
   // webrtc::VideoSinkInterface implementation
   void OnFrame(const webrtc::VideoFrame& frame) override;
 
+  // Frames that were replaced by a newer one before they were painted.
+  // These are never converted.
+  uint64_t frames_dropped() const { return frames_.overwritten_count(); }
+
+  // Extra threads used to convert large frames in stripes. Call from the
+  // UI thread; 0 converts on the UI thread only.
+  void SetConversionThreads(int num_threads) {
+    converter_.SetWorkerThreads(num_threads);
+  }
+
+  // Render-path counters and latencies since the previous call. UI thread
+  // only; each call starts a new measurement window.
+  RenderStatsSnapshot TakeRenderStats();
+
  signals:
   void FrameReceived();
 
  protected:
   void paintEvent(QPaintEvent* event) override;
+  void resizeEvent(QResizeEvent* event) override;
 
  private slots:
   void OnFrameReceived();
 
  private:
   void SetSize(int width, int height);
+  QRect LetterboxRect(int frame_width, int frame_height) const;
+  webrtc::VideoSinkWants DesiredSinkWants() const;
+  void UpdateSinkWants();
+  void ConvertFrame(const webrtc::VideoFrame& video_frame, const QSize& size);
+  void ConvertRegion(const webrtc::VideoFrame& video_frame,
+                     const webrtc::VideoFrame::UpdateRect& region);
+
+  struct QueuedFrame {
+    std::optional<webrtc::VideoFrame> frame;
+    // webrtc::TimeMicros() when OnFrame received it.
+    int64_t arrival_us = 0;
+    // Consecutive per OnFrame call, so the UI thread can tell whether the
+    // triple buffer skipped a frame.
+    uint64_t sequence = 0;
+    // Frames were missed before this one (new track, or re-attached after
+    // being occluded), so its update rect can't be trusted.
+    bool discontinuity = false;
+  };
 
+  // Guards rendered_track_, sink_wants_ and occluded_ only; the frame
+  // path is lock-free.
   QMutex mutex_;
+  // Latest frames by reference. The back slot is written by OnFrame on the
+  // WebRTC thread, the front slot is converted by paintEvent on the UI
+  // thread, so only frames that are actually painted get converted.
+  TripleBuffer<QueuedFrame> frames_;
+  std::atomic<uint64_t> frames_received_{0};
+  uint64_t next_sequence_ = 0;  // OnFrame only
+  std::atomic<bool> discontinuity_{true};
+  // Set while a FrameReceived signal is queued, so a burst of frames
+  // results in a single repaint request.
+  std::atomic<bool> repaint_pending_{false};
+  // UI thread only. image_ holds the latest frame already scaled to
+  // draw_rect_ in device pixels, so painting is a plain blit. Its backing
+  // store comes from image_pool_ and goes back there on a size change.
+  FrameConverter converter_;
+  ArgbImagePool image_pool_;
   QImage image_;
+  QRect draw_rect_;
+  // Dirty-rect bookkeeping between OnFrameReceived and paintEvent. The
+  // union of update rects of consumed frames not yet converted into image_.
+  webrtc::VideoFrame::UpdateRect dirty_region_{0, 0, 0, 0};
+  bool full_conversion_pending_ = true;
+  bool frame_unpainted_ = false;
+  uint64_t last_sequence_ = 0;
+  QSize converted_frame_size_;
+  RenderStatsCollector stats_;
+  bool adaptive_sink_wants_ = false;
+  bool occluded_ = false;
+  webrtc::VideoSinkWants sink_wants_;
   webrtc::scoped_refptr<webrtc::VideoTrackInterface> rendered_track_;
-  int width_;
-  int height_;
 };
 
 #endif  // EXAMPLES_PEERCONNECTION_CLIENT_VIDEORENDERER_H_
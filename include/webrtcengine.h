@@ -1,41 +1,139 @@
 #ifndef WEBRTCENGINE_H_GUARD
 #define WEBRTCENGINE_H_GUARD
 
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include <deque>
 #include <functional>
+#include <optional>
+#include "api/data_channel_interface.h"
 #include "api/environment/environment.h"
+#include "api/media_types.h"
 #include "api/peer_connection_interface.h"
 #include "api/peer_connection_interface.h"
+#include "api/rtc_error.h"
+#include "api/rtp_parameters.h"
 #include "api/scoped_refptr.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "rtc_base/synchronization/mutex.h"
 #include "rtc_base/thread.h"
+#include "rtc_base/thread_annotations.h"
 #include "signalclient.h"  // 包含 IceServerConfig 定义
+#include "thread_placement.h"
+#include "video_codec_policy.h"
+
+// 视频分层发送配置。主叫建视频收发器时带上同播编码(VP8/H264 时生效)，
+// 协商出 VP9/AV1 时改为只用第一路编码并设置可伸缩模式(SVC)。
+// 被叫不能发起同播，只在 VP9/AV1 下使用 SVC。
+struct VideoSendLayersConfig {
+  bool enabled = false;
+  struct Layer {
+    std::string rid;
+    double scale_resolution_down_by = 1.0;
+    int max_bitrate_bps = 0;
+  };
+  // 同播各层，由低到高
+  std::vector<Layer> simulcast_layers = {
+      {"q", 4.0, 150000}, {"h", 2.0, 500000}, {"f", 1.0, 1500000}};
+  std::string svc_scalability_mode = "L3T3";
+};
+
+// 运行时调整某一路编码的参数，未设置的字段保持不变
+struct VideoLayerSettings {
+  std::optional<bool> active;
+  std::optional<int> max_bitrate_bps;
+  std::optional<double> scale_resolution_down_by;
+  std::optional<double> max_framerate;
+};
+
+// 视频发送限制，整体替换；数值为 0 表示不限制。同播时码率上限按各层
+// 配置的比例分摊，下限只作用于最低层，帧率上限作用于每一层
+struct VideoSendLimits {
+  int max_bitrate_bps = 0;
+  int min_bitrate_bps = 0;
+  double max_framerate = 0.0;
+  // 带宽或 CPU 不足时降帧率还是降分辨率；空表示 WebRTC 默认(均衡)
+  std::optional<webrtc::DegradationPreference> degradation_preference;
+};
+
+// ICE 中断后的自动重启。只由发起协商的一方(主叫)重启，避免双方同时发
+// offer；另一方按正常流程应答。重启只换 ICE 凭据，收发器、轨道和编码器不动
+struct IceRestartConfig {
+  bool enabled = true;
+  // disconnected 持续这么久仍未自行恢复才重启；failed 立即重启
+  int grace_period_ms = 2000;
+  // 一次中断内最多重启的次数，两次重启之间至少间隔 |retry_interval_ms|。
+  // 重启后这么久仍未连通算一次失败，answer 没到时回滚本端 offer 再试
+  int max_attempts = 3;
+  int retry_interval_ms = 5000;
+};
+
+// 数据通道参数。两个部分可靠参数至多设置一个，都不设置时完全可靠
+struct DataChannelOptions {
+  bool ordered = true;
+  std::optional<int> max_retransmit_time_ms;  // 超过这么久仍未送达就放弃
+  std::optional<int> max_retransmits;         // 最多重传次数
+  std::string protocol;                        // 应用层子协议名，对端可见
+};
+
+// 对端发来的一个ICE候选(candidate 为 SDP 属性行 "candidate:...")
+struct RemoteIceCandidate {
+  std::string sdp_mid;
+  int sdp_mline_index = -1;
+  std::string candidate;
+};
 
 // WebRTC引擎观察者接口 - 业务层只需实现这个接口即可
+// 除本地轨道外，所有事件都带上所属会话的对端ID；可能在 WebRTC 信令线程回调
 class WebRTCEngineObserver {
  public:
   virtual ~WebRTCEngineObserver() = default;
   
-  // 轨道事件
+  // 轨道事件（本地采集源由所有会话共享，只通知一次）
   virtual void OnLocalVideoTrackAdded(webrtc::VideoTrackInterface* track) = 0;
-  virtual void OnRemoteVideoTrackAdded(webrtc::VideoTrackInterface* track) = 0;
-  virtual void OnRemoteVideoTrackRemoved() = 0;
+  virtual void OnRemoteVideoTrackAdded(const std::string& peer_id, webrtc::VideoTrackInterface* track) = 0;
+  virtual void OnRemoteVideoTrackRemoved(const std::string& peer_id) = 0;
   
   // 连接状态
-  virtual void OnIceConnectionStateChanged(webrtc::PeerConnectionInterface::IceConnectionState state) = 0;
+  virtual void OnIceConnectionStateChanged(const std::string& peer_id,
+                                           webrtc::PeerConnectionInterface::IceConnectionState state) = 0;
   
   // SDP和ICE候选
-  virtual void OnOfferCreated(const std::string& sdp) = 0;
-  virtual void OnAnswerCreated(const std::string& sdp) = 0;
-  virtual void OnIceCandidateGenerated(const std::string& sdp_mid, int sdp_mline_index, const std::string& candidate) = 0;
+  virtual void OnOfferCreated(const std::string& peer_id, const std::string& sdp) = 0;
+  virtual void OnAnswerCreated(const std::string& peer_id, const std::string& sdp) = 0;
+  virtual void OnIceCandidateGenerated(const std::string& peer_id, const std::string& sdp_mid,
+                                       int sdp_mline_index, const std::string& candidate) = 0;
+  // 本轮候选收集完毕；持续收集(GATHER_CONTINUALLY)时网络变化后可能再次收集
+  virtual void OnIceGatheringComplete(const std::string& peer_id) = 0;
   
-  // 错误处理
-  virtual void OnError(const std::string& error) = 0;
+  // ICE 中断恢复：发出第 |attempt| 次重启 offer 时通知；重新连通时报告从
+  // 中断到恢复的耗时及期间的重启次数(0 表示在宽限期内自行恢复)
+  virtual void OnIceRestarting(const std::string& peer_id, int attempt) = 0;
+  virtual void OnIceRecovered(const std::string& peer_id, int64_t recovery_ms, int restarts) = 0;
+  
+  // 数据通道，按 (对端ID, 标签) 区分；本端创建和对端创建的通道都会通知
+  virtual void OnDataChannelStateChanged(const std::string& peer_id, const std::string& label,
+                                         webrtc::DataChannelInterface::DataState state) = 0;
+  // |data| 直接引用 WebRTC 的接收缓冲；拷贝 CopyOnWriteBuffer 只增加引用计数，
+  // 需要留到回调之后的数据这样保存即可，不必逐字节复制
+  virtual void OnDataChannelMessage(const std::string& peer_id, const std::string& label,
+                                    const webrtc::CopyOnWriteBuffer& data, bool binary) = 0;
+  // 通道每发出一批数据后调用，可据 GetDataChannelBufferedAmount 续发
+  virtual void OnDataChannelBufferedAmountChange(const std::string& peer_id,
+                                                 const std::string& label,
+                                                 uint64_t sent_data_size) = 0;
+  
+  // 错误处理（|peer_id| 为空表示与具体会话无关）
+  virtual void OnError(const std::string& peer_id, const std::string& error) = 0;
 };
 
 // WebRTC引擎 - 封装所有WebRTC相关逻辑，与UI完全解耦
+// 每个对端一个会话(PeerConnection)，按对端ID索引；所有会话共享工厂、线程
+// 和同一个本地采集源，每个会话的 sender 各自编码。公共方法须在同一线程调用。
 class WebRTCEngine {
  public:
   explicit WebRTCEngine(const webrtc::Environment& env);
@@ -51,29 +149,115 @@ class WebRTCEngine {
   // 设置 ICE 服务器配置
   void SetIceServers(const std::vector<IceServerConfig>& ice_servers);
   
+  // 线程布局：是否自建网络/工作线程，以及各线程的 CPU 亲和性和优先级。
+  // 须在 Initialize() 之前调用
+  void SetThreadConfig(const EngineThreadConfig& config);
+  
   // 初始化
   bool Initialize();
   
-  // 创建/关闭对等连接
-  bool CreatePeerConnection();
-  void ClosePeerConnection();
+  // 引擎自有线程（信令、网络、工作）各自累计的 CPU 时间。线程启动时
+  // 取得各自的 CPU 时钟，读取时不切到这些线程，不会被其上的任务阻塞；
+  // 未自建或平台不支持的线程不在列表中
+  struct ThreadCpuTime {
+    std::string name;
+    std::string placement;
+    int64_t cpu_time_ns = 0;
+  };
+  std::vector<ThreadCpuTime> GetThreadCpuTimes() const;
   
-  // 添加媒体轨道
-  bool AddTracks();
+  // 预热连接池：在后台线程预先创建 |size| 个 PeerConnection(已生成 DTLS
+  // 证书并建好音视频收发器)，CreatePeerConnection() 优先从池中取用，
+  // 每次通话结束后自动补齐。0 表示关闭连接池。
+  void SetPeerConnectionPoolSize(int size);
+  int GetPooledPeerConnectionCount() const;
+  
+  // 创建/关闭与 |peer_id| 的对等连接。|will_offer| 为 false 表示本端将应用
+  // 远端 offer(被叫)，此时不使用预热连接自带的收发器，由远端 offer 决定 m-line。
+  // 创建后即开始预收集 ICE 候选(ice_candidate_pool_size)，可在响铃期间调用。
+  // 最后一个会话关闭时停止本地采集。
+  bool CreatePeerConnection(const std::string& peer_id, bool will_offer = true);
+  void ClosePeerConnection(const std::string& peer_id);
+  void CloseAllPeerConnections();
+  // 该会话的连接是否取自预热池
+  bool IsPooledPeerConnection(const std::string& peer_id) const;
+  
+  // 视频编解码器偏好：主叫在 CreateOffer() 前、被叫在应用远端 offer 后
+  // (结合对端支持的编解码器)设置到视频收发器上。默认策略作用于所有会话，
+  // 按对端设置的策略优先，会话关闭时清除。可在任意线程调用
+  void SetVideoCodecPolicy(const VideoCodecPolicy& policy);
+  void SetVideoCodecPolicy(const std::string& peer_id, const VideoCodecPolicy& policy);
+  // 当前进程 CPU 占用(单核百分比)，供策略的 CPU 预算使用
+  void UpdateCpuLoad(double process_cpu_percent);
+  
+  // 视频分层发送。影响之后新建的连接(预热池会按新配置重建)，
+  // 须在调用线程调用
+  void SetVideoSendLayers(const VideoSendLayersConfig& config);
+  // 通过 RtpSender::SetParameters 调整第 |layer_index| 路编码：同播时为
+  // 各层(由低到高)，SVC 和单层时只有第 0 路
+  bool SetVideoLayerSettings(const std::string& peer_id, size_t layer_index,
+                             const VideoLayerSettings& settings);
+  // 当前视频发送编码参数，没有视频 sender 时为空
+  std::vector<webrtc::RtpEncodingParameters> GetVideoEncodings(const std::string& peer_id) const;
+  
+  // 通话中通过 RtpSender::SetParameters 修改视频发送限制；在协商前调用时
+  // 参数会缓存到协商完成。会话记住该限制，切换同播/SVC 后重新应用
+  bool SetVideoSendLimits(const std::string& peer_id, const VideoSendLimits& limits);
+  // 从 sender 当前参数读回的实际限制，没有视频 sender 时为空
+  std::optional<VideoSendLimits> GetVideoSendLimits(const std::string& peer_id) const;
+  
+  // 添加媒体轨道（首次调用时创建共享的本地采集源）
+  bool AddTracks(const std::string& peer_id);
+  // 只建好没有轨道的音视频收发器，不打开采集；offer 可以先发出，
+  // 之后 AddTracks() 把轨道挂上去，不需要重新协商
+  bool AddSendTransceivers(const std::string& peer_id);
   
   // SDP操作
-  void CreateOffer();
-  void CreateAnswer();
-  void SetRemoteOffer(const std::string& sdp);
-  void SetRemoteAnswer(const std::string& sdp);
+  void CreateOffer(const std::string& peer_id);
+  void CreateAnswer(const std::string& peer_id);
+  void SetRemoteOffer(const std::string& peer_id, const std::string& sdp);
+  void SetRemoteAnswer(const std::string& peer_id, const std::string& sdp);
+  // 当前本地描述(含已收集到的候选)，没有时返回空串
+  std::string GetLocalDescriptionSdp(const std::string& peer_id) const;
+  
+  // ICE 中断后的自动重启策略，对之后的中断生效
+  void SetIceRestartConfig(const IceRestartConfig& config);
   
   // ICE候选操作
-  void AddIceCandidate(const std::string& sdp_mid, int sdp_mline_index, const std::string& candidate);
+  void AddIceCandidate(const std::string& peer_id, const std::string& sdp_mid,
+                       int sdp_mline_index, const std::string& candidate);
+  // 一次加入一批候选：只查找一次会话、只加一次锁，解析失败的单个候选被跳过
+  void AddIceCandidates(const std::string& peer_id,
+                        const std::vector<RemoteIceCandidate>& candidates);
+  
+  // 数据通道。主叫的第一个通道须在 CreateOffer() 之前创建，SDP 里才有
+  // SCTP 的 m-line；协商之后双方都可再建通道，无需重新协商。对端创建的
+  // 通道自动接受。CreateDataChannel 须在调用线程调用，其余可在任意线程调用
+  bool CreateDataChannel(const std::string& peer_id, const std::string& label,
+                         const DataChannelOptions& options = DataChannelOptions());
+  // 接管 |data| 发送二进制消息，引擎不复制负载。通道未打开，或发送缓冲
+  // 放不下(WebRTC 会因此关闭通道)时返回 false 且不发送
+  bool SendData(const std::string& peer_id, const std::string& label,
+                webrtc::CopyOnWriteBuffer data);
+  // 已交给通道但尚未发出的字节数；没有该通道时为 0
+  uint64_t GetDataChannelBufferedAmount(const std::string& peer_id,
+                                        const std::string& label) const;
+  // 没有该通道时为空
+  std::optional<webrtc::DataChannelInterface::DataState> GetDataChannelState(
+      const std::string& peer_id, const std::string& label) const;
+  void CloseDataChannel(const std::string& peer_id, const std::string& label);
   
   // 查询状态
-  bool IsConnected() const;
-  bool HasPeerConnection() const { return peer_connection_ != nullptr; }
-  void CollectStats(std::function<void(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>&)> callback);
+  bool IsConnected(const std::string& peer_id) const;
+  bool HasPeerConnection(const std::string& peer_id) const;
+  size_t GetPeerConnectionCount() const { return sessions_.size(); }
+  std::vector<std::string> GetPeerIds() const;
+  void CollectStats(const std::string& peer_id,
+                    std::function<void(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>&)> callback);
+  // 会话的 PeerConnection 代理，可在任意线程调用(如后台定时取统计)；
+  // 须在调用线程获取，没有会话时为空
+  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> GetPeerConnection(
+      const std::string& peer_id) const;
   
   // 生命周期
   void Shutdown();
@@ -83,34 +267,132 @@ class WebRTCEngine {
   class PeerConnectionObserverImpl;
   class CreateSessionDescriptionObserverImpl;
   class StatsCollectorCallback;
+  class DataChannelObserverImpl;
+  struct PeerSession;
+  
+  // 一个数据通道及其观察者；观察者须在通道注销它之后才能销毁
+  struct DataChannelEntry {
+    webrtc::scoped_refptr<webrtc::DataChannelInterface> channel;
+    std::unique_ptr<DataChannelObserverImpl> observer;
+  };
   
-  void SetRemoteDescription(const std::string& type, const std::string& sdp);
-  void ProcessPendingIceCandidates();
-  void OnPeerConnectionIceCandidate(const webrtc::IceCandidate* candidate);
-  void OnPeerConnectionIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState state);
-  void OnPeerConnectionAddTrack(webrtc::RtpReceiverInterface* receiver);
-  void OnPeerConnectionRemoveTrack(webrtc::RtpReceiverInterface* receiver);
-  void OnSessionDescriptionSuccess(webrtc::SessionDescriptionInterface* desc, bool is_offer);
-  void OnSessionDescriptionFailure(const std::string& error);
+  // 预热好的连接及其观察者；观察者在被取用前不转发任何事件
+  struct PooledPeerConnection {
+    webrtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection;
+    std::unique_ptr<PeerConnectionObserverImpl> observer;
+  };
+  
+  webrtc::PeerConnectionInterface::RTCConfiguration BuildRtcConfiguration() const;
+  // 按目标数量投递预热任务；在调用线程读取配置，在 pool_thread_ 上建连
+  void RefillPeerConnectionPool();
+  void WarmPeerConnection(webrtc::PeerConnectionInterface::RTCConfiguration config,
+                          std::vector<webrtc::RtpEncodingParameters> video_encodings,
+                          uint64_t generation);
+  // 关闭并丢弃池中所有连接，正在进行的预热结果也会被丢弃
+  void DrainPeerConnectionPool();
+  // 优先挂到预热连接中空闲的收发器上；没有则 |send_encodings| 非空时
+  // AddTransceiver 带上分层编码，否则 AddTrack
+  webrtc::RTCError AttachLocalTrack(
+      const webrtc::scoped_refptr<webrtc::PeerConnectionInterface>& peer_connection,
+      webrtc::scoped_refptr<webrtc::MediaStreamTrackInterface> track,
+      webrtc::MediaType media_type,
+      const std::vector<webrtc::RtpEncodingParameters>& send_encodings = {});
+  // 同播编码；未启用分层时为空
+  std::vector<webrtc::RtpEncodingParameters> BuildVideoSendEncodings() const;
+  webrtc::scoped_refptr<webrtc::RtpSenderInterface> FindVideoSender(const PeerSession& session) const;
+  // 按协商出的发送编解码器切换同播/SVC；协商完成后在信令线程调用
+  void ApplyVideoSendLayers(PeerSession& session);
+  // 把 |limits| 写进 |parameters|，同播各层的码率以 |layers| 配置为基准
+  static void ApplyVideoSendLimits(const VideoSendLimits& limits,
+                                   const VideoSendLayersConfig& layers,
+                                   webrtc::RtpParameters& parameters);
+  
+  std::shared_ptr<PeerSession> FindSession(const std::string& peer_id) const;
+  // 没有会话再使用时停止采集并释放本地轨道
+  void ReleaseLocalMediaIfUnused();
+  void SetRemoteDescription(const std::string& peer_id, const std::string& type, const std::string& sdp);
+  // |remote_codecs| 为空指针表示尚不知道对端支持哪些编解码器
+  void ApplyVideoCodecPolicy(PeerSession& session, const std::set<std::string>* remote_codecs);
+  void ProcessPendingIceCandidates(PeerSession& session);
+  void OnPeerConnectionIceCandidate(const std::string& peer_id, const webrtc::IceCandidate* candidate);
+  void OnPeerConnectionIceGatheringChange(const std::string& peer_id,
+                                          webrtc::PeerConnectionInterface::IceGatheringState state);
+  void OnPeerConnectionIceConnectionChange(const std::string& peer_id,
+                                           const std::shared_ptr<PeerSession>& session,
+                                           webrtc::PeerConnectionInterface::IceConnectionState state);
+  // 以下三个只在信令线程调用
+  void UpdateIceRecovery(const std::shared_ptr<PeerSession>& session,
+                         webrtc::PeerConnectionInterface::IceConnectionState state);
+  void ScheduleIceRestart(const std::shared_ptr<PeerSession>& session, int delay_ms);
+  void RestartIce(const std::shared_ptr<PeerSession>& session);
+  // 撤回未得到应答的本地 offer，完成后立即再次尝试重启
+  void RollbackLocalOffer(const std::shared_ptr<PeerSession>& session);
+  // 登记通道并注册观察者；本端和对端创建的通道都经过这里。对端通道交到
+  // 本端时可能已经打开，不会再有状态变化，|notify_if_open| 为 true 时补发
+  void AddDataChannel(const std::string& peer_id,
+                      webrtc::scoped_refptr<webrtc::DataChannelInterface> channel,
+                      bool notify_if_open);
+  // 注销并关闭 |peer_id| 的全部通道
+  void CloseDataChannels(const std::string& peer_id);
+  webrtc::scoped_refptr<webrtc::DataChannelInterface> FindDataChannel(
+      const std::string& peer_id, const std::string& label) const;
+  void OnPeerConnectionDataChannel(const std::string& peer_id,
+                                   webrtc::scoped_refptr<webrtc::DataChannelInterface> channel);
+  void OnPeerConnectionAddTrack(const std::string& peer_id, webrtc::RtpReceiverInterface* receiver);
+  void OnPeerConnectionRemoveTrack(const std::string& peer_id, webrtc::RtpReceiverInterface* receiver);
+  void OnSessionDescriptionSuccess(const std::shared_ptr<PeerSession>& session,
+                                   webrtc::SessionDescriptionInterface* desc, bool is_offer);
+  void OnSessionDescriptionFailure(const std::string& peer_id, const std::string& error);
   
   const webrtc::Environment env_;
   std::unique_ptr<webrtc::Thread> signaling_thread_;
-  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection_;
+  std::unique_ptr<webrtc::Thread> network_thread_;
+  std::unique_ptr<webrtc::Thread> worker_thread_;
+  // 线程启动时在各自线程上绑定，之后只读
+  ThreadCpuClock signaling_cpu_clock_;
+  ThreadCpuClock network_cpu_clock_;
+  ThreadCpuClock worker_cpu_clock_;
+  EngineThreadConfig thread_config_;
+  // 采集源的任务队列经此创建以应用 capture 放置；须比采集源活得久
+  std::unique_ptr<webrtc::TaskQueueFactory> capture_task_queue_factory_;
   webrtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> peer_connection_factory_;
   
-  // 媒体轨道和源引用 - 用于显式停止
+  // 对端ID -> 会话；只在调用线程访问，异步回调各自持有会话引用
+  std::map<std::string, std::shared_ptr<PeerSession>> sessions_;
+  
+  // 共享的本地媒体轨道和源引用 - 用于显式停止
   webrtc::scoped_refptr<webrtc::VideoTrackSourceInterface> video_source_;
   webrtc::scoped_refptr<webrtc::VideoTrackInterface> local_video_track_;
   webrtc::scoped_refptr<webrtc::AudioTrackInterface> local_audio_track_;
   
-  // 内部观察者对象 - 必须保持存活
-  std::unique_ptr<PeerConnectionObserverImpl> pc_observer_;
-  
   WebRTCEngineObserver* observer_;
-  std::deque<webrtc::IceCandidate*> pending_ice_candidates_;
   std::vector<IceServerConfig> ice_servers_;  // ICE 服务器配置
   
-  bool is_creating_offer_;
+  // 编解码器策略与分层配置；ApplyVideoCodecPolicy/ApplyVideoSendLayers
+  // 也会在信令线程读取
+  mutable webrtc::Mutex codec_policy_mutex_;
+  VideoSendLayersConfig send_layers_ RTC_GUARDED_BY(codec_policy_mutex_);
+  VideoCodecPolicy video_codec_policy_ RTC_GUARDED_BY(codec_policy_mutex_);
+  std::map<std::string, VideoCodecPolicy> peer_codec_policies_ RTC_GUARDED_BY(codec_policy_mutex_);
+  double cpu_load_percent_ RTC_GUARDED_BY(codec_policy_mutex_) = 0.0;
+  
+  // 对端ID -> 标签 -> 数据通道；发送可在任意线程，对端通道在信令线程加入
+  mutable webrtc::Mutex data_channels_mutex_;
+  std::map<std::string, std::map<std::string, DataChannelEntry>> data_channels_
+      RTC_GUARDED_BY(data_channels_mutex_);
+  
+  // 调用线程写，信令线程读
+  mutable webrtc::Mutex ice_restart_mutex_;
+  IceRestartConfig ice_restart_config_ RTC_GUARDED_BY(ice_restart_mutex_);
+  
+  // 预热连接池
+  std::unique_ptr<webrtc::Thread> pool_thread_;
+  int pool_target_size_ = 0;  // 仅在调用线程访问
+  mutable webrtc::Mutex pool_mutex_;
+  std::deque<PooledPeerConnection> pc_pool_ RTC_GUARDED_BY(pool_mutex_);
+  int pool_pending_ RTC_GUARDED_BY(pool_mutex_) = 0;  // 已投递未完成的预热任务
+  // ICE 配置变化或关闭时递增，使旧配置的预热结果作废
+  uint64_t pool_generation_ RTC_GUARDED_BY(pool_mutex_) = 0;
 };
 
 #endif  // WEBRTCENGINE_H_GUARD
@@ -0,0 +1,50 @@
+#include "argb_image_pool.h"
+
+#include <utility>
+
+ArgbImagePool::ArgbImagePool(size_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+QImage ArgbImagePool::Acquire(const QSize& size) {
+  if (size.isEmpty()) {
+    return QImage();
+  }
+
+  for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+    if (it->size() == size) {
+      QImage image = std::move(*it);
+      idle_bytes_ -= static_cast<size_t>(image.sizeInBytes());
+      idle_.erase(it);
+      ++hits_;
+      return image;
+    }
+  }
+
+  ++misses_;
+  return QImage(size, QImage::Format_ARGB32);
+}
+
+void ArgbImagePool::Release(QImage image) {
+  if (image.isNull() || image.format() != QImage::Format_ARGB32) {
+    return;
+  }
+
+  // An image bigger than the whole budget would only evict everything else
+  const size_t bytes = static_cast<size_t>(image.sizeInBytes());
+  if (bytes > budget_bytes_) {
+    ++evictions_;
+    return;
+  }
+
+  idle_bytes_ += bytes;
+  idle_.push_front(std::move(image));
+  EvictToBudget();
+}
+
+void ArgbImagePool::EvictToBudget() {
+  while (idle_bytes_ > budget_bytes_ && !idle_.empty()) {
+    idle_bytes_ -= static_cast<size_t>(idle_.back().sizeInBytes());
+    idle_.pop_back();
+    ++evictions_;
+  }
+}
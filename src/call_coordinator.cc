@@ -5,15 +5,133 @@
  */
 
 #include "call_coordinator.h"
+#include "api/make_ref_counted.h"
+#include "api/stats/rtc_stats_collector_callback.h"
+#include "api/units/time_delta.h"
+#include "rtc_base/cpu_time.h"
 #include "rtc_base/logging.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <QMetaObject>
+#include <QStandardPaths>
+#include <QTimer>
 #include <QJsonDocument>
 
 #include "api/stats/rtcstats_objects.h"
 
 namespace {
 
+// 空闲时保持的预热 PeerConnection 数量
+constexpr int kPeerConnectionPoolSize = 1;
+
+// 发起呼叫时把 offer 放进 call-request，省去 call-response 之后的一轮信令
+constexpr bool kBundleOfferWithCallRequest = true;
+
+// 网络和工作线程默认自建，以便统计各自的 CPU 时间；CPU 亲和性和优先级
+// 由该环境变量配置，例如 "network=2:high;worker=3-5;capture=1"
+constexpr char kThreadPlacementEnvVar[] = "WEBRTC_THREAD_PLACEMENT";
+
+// 视频编码可用的进程 CPU 预算(单核百分比)：负载高时放弃 VP9/AV1 这类
+// 较贵的软件编码器；偏好顺序用 VideoCodecPolicy 的默认值(H264 优先)
+constexpr double kVideoEncoderCpuBudgetPercent = 150.0;
+
+// 同播/SVC 分层发送。点对点通话里对端只解码一层，多发的层只会占用上行
+// 和编码 CPU，所以默认关闭；经 SFU 或多方通话时打开
+constexpr bool kEnableVideoSendLayers = false;
+
+// 本地 ICE 候选的攒批窗口：第一个候选到达后等这么久再发，期间的候选合并
+// 成一条 ice-candidates 消息；收集完成时提前发出
+constexpr int kIceCandidateBatchWindowMs = 30;
+
+// ICE 断开后等待自行恢复的时间，超过后主叫发起 ICE 重启；failed 立即重启
+constexpr int kIceRestartGracePeriodMs = 2000;
+
+// 通话期间后台统计采样的默认间隔，以及统计历史按多长的通话预先分配；
+// 超过这个时长后最早的采样被覆盖
+constexpr int kStatsSampleIntervalMs = 1000;
+constexpr int kMinStatsSampleIntervalMs = 100;
+constexpr int kStatsHistoryMaxCallSeconds = 4 * 3600;
+
+// 文件传输用的数据通道(可靠、有序)，由主叫随 offer 创建
+constexpr char kFileTransferLabel[] = "file-transfer";
+
+// 通话中文件通道意外关闭后主叫重建的次数上限，通道打开后重新计数
+constexpr int kMaxFileChannelReopenAttempts = 3;
+
+// 文件传输管理器经引擎收发，通道按 (对端, 标签) 查找，关闭后发送自然失败
+class EngineFileTransport : public FileTransferTransport {
+ public:
+  EngineFileTransport(WebRTCEngine* engine, const std::string& peer_id)
+      : engine_(engine), peer_id_(peer_id) {}
+  
+  bool Send(webrtc::CopyOnWriteBuffer message) override {
+    return engine_->SendData(peer_id_, kFileTransferLabel, std::move(message));
+  }
+  uint64_t BufferedAmount() const override {
+    return engine_->GetDataChannelBufferedAmount(peer_id_, kFileTransferLabel);
+  }
+  
+ private:
+  WebRTCEngine* const engine_;
+  const std::string peer_id_;
+};
+
+VideoSendLimits ToVideoSendLimits(const VideoSendConstraints& constraints) {
+  VideoSendLimits limits;
+  limits.max_bitrate_bps = constraints.max_bitrate_kbps * 1000;
+  limits.min_bitrate_bps = constraints.min_bitrate_kbps * 1000;
+  limits.max_framerate = constraints.max_framerate;
+  switch (constraints.degradation) {
+    case VideoDegradationMode::kBalanced:
+      break;
+    case VideoDegradationMode::kMaintainFramerate:
+      limits.degradation_preference = webrtc::DegradationPreference::MAINTAIN_FRAMERATE;
+      break;
+    case VideoDegradationMode::kMaintainResolution:
+      limits.degradation_preference = webrtc::DegradationPreference::MAINTAIN_RESOLUTION;
+      break;
+  }
+  return limits;
+}
+
+VideoSendConstraints ToVideoSendConstraints(const VideoSendLimits& limits) {
+  VideoSendConstraints constraints;
+  constraints.max_bitrate_kbps = limits.max_bitrate_bps / 1000;
+  constraints.min_bitrate_kbps = limits.min_bitrate_bps / 1000;
+  constraints.max_framerate = limits.max_framerate;
+  if (limits.degradation_preference == webrtc::DegradationPreference::MAINTAIN_FRAMERATE) {
+    constraints.degradation = VideoDegradationMode::kMaintainFramerate;
+  } else if (limits.degradation_preference == webrtc::DegradationPreference::MAINTAIN_RESOLUTION) {
+    constraints.degradation = VideoDegradationMode::kMaintainResolution;
+  }
+  return constraints;
+}
+
+// RTCCodecStats::mime_type 形如 "video/VP8"，取斜杠后的部分
+std::string_view CodecNameFromStats(const webrtc::RTCStatsReport& report,
+                                    const std::optional<std::string>& codec_id) {
+  if (!codec_id) {
+    return std::string_view();
+  }
+  const auto* codec = report.GetAs<webrtc::RTCCodecStats>(*codec_id);
+  if (!codec || !codec->mime_type) {
+    return std::string_view();
+  }
+  const std::string_view mime_type = *codec->mime_type;
+  const size_t slash = mime_type.find('/');
+  return slash == std::string_view::npos ? mime_type : mime_type.substr(slash + 1);
+}
+
 QJsonObject ExtractSdpPayload(const QJsonObject& payload) {
   if (payload.contains("sdp")) {
     const auto sdp_value = payload.value("sdp");
@@ -63,8 +181,67 @@ int ExtractMLineIndex(const QJsonObject& candidate) {
   return -1;
 }
 
+// 单个候选消息的 payload 或批量消息中的一个元素；字段不全时返回 false
+bool ParseRemoteIceCandidate(const QJsonObject& payload, RemoteIceCandidate* result) {
+  const QJsonObject candidate_payload = ExtractCandidatePayload(payload);
+  const QString sdp_mid_value = candidate_payload.value("sdpMid").toString();
+  const int sdp_mline_index = ExtractMLineIndex(candidate_payload);
+  const QString candidate_text = candidate_payload.value("candidate").toString();
+
+  if (sdp_mid_value.isEmpty() || sdp_mline_index < 0 || candidate_text.isEmpty()) {
+    RTC_LOG(LS_ERROR) << "ICE candidate payload incomplete";
+    qDebug() << "ERROR: ICE candidate payload incomplete"
+             << "sdpMid:" << sdp_mid_value
+             << "mline:" << sdp_mline_index
+             << "candidate:" << candidate_text.left(32);
+    return false;
+  }
+
+  result->sdp_mid = sdp_mid_value.toStdString();
+  result->sdp_mline_index = sdp_mline_index;
+  result->candidate = candidate_text.toStdString();
+  return true;
+}
+
 }  // namespace
 
+// 后台采样复用同一个回调对象，每次采样不再分配。同一时刻只有一个请求
+// 在途，发起时的采样代数记在这里随结果带回；Detach 之后的结果丢弃
+class CallCoordinator::StatsSamplerCallback : public webrtc::RTCStatsCollectorCallback {
+ public:
+  explicit StatsSamplerCallback(CallCoordinator* coordinator) : coordinator_(coordinator) {}
+  
+  // 上一个请求的结果还没到时返回 false，这次不发起
+  bool BeginRequest(uint64_t generation) {
+    webrtc::MutexLock lock(&mutex_);
+    if (in_flight_) {
+      return false;
+    }
+    in_flight_ = true;
+    generation_ = generation;
+    return true;
+  }
+  
+  void OnStatsDelivered(
+      const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override {
+    webrtc::MutexLock lock(&mutex_);
+    in_flight_ = false;
+    if (coordinator_) {
+      coordinator_->OnSampledStats(report, generation_);
+    }
+  }
+  void Detach() {
+    webrtc::MutexLock lock(&mutex_);
+    coordinator_ = nullptr;
+  }
+  
+ private:
+  webrtc::Mutex mutex_;
+  CallCoordinator* coordinator_;
+  bool in_flight_ = false;
+  uint64_t generation_ = 0;
+};
+
 // ============================================================================
 // 构造和析构
 // ============================================================================
@@ -73,7 +250,8 @@ CallCoordinator::CallCoordinator(const webrtc::Environment& env)
     : env_(env),
       ui_observer_(nullptr),
       is_caller_(false),
-      last_ice_state_("未连接") {
+      last_ice_state_("未连接"),
+      stats_sample_interval_ms_(kStatsSampleIntervalMs) {
   // 创建WebRTC引擎
   webrtc_engine_ = std::make_unique<WebRTCEngine>(env);
   webrtc_engine_->SetObserver(this);
@@ -121,17 +299,70 @@ bool CallCoordinator::Initialize() {
   // 注意：不需要连接IncomingCall信号，因为已经通过observer回调处理
   // CallManager会调用observer_->OnIncomingCall()
   
-  return webrtc_engine_->Initialize();
+  EngineThreadConfig thread_config;
+  thread_config.dedicated_network_thread = true;
+  thread_config.dedicated_worker_thread = true;
+  if (const char* spec = std::getenv(kThreadPlacementEnvVar)) {
+    if (!ParseEngineThreadConfig(spec, &thread_config)) {
+      RTC_LOG(LS_WARNING) << "Ignoring invalid " << kThreadPlacementEnvVar
+                          << ": " << spec;
+    }
+  }
+  webrtc_engine_->SetThreadConfig(thread_config);
+  
+  VideoCodecPolicy codec_policy;
+  codec_policy.cpu_budget_percent = kVideoEncoderCpuBudgetPercent;
+  webrtc_engine_->SetVideoCodecPolicy(codec_policy);
+  
+  VideoSendLayersConfig send_layers;
+  send_layers.enabled = kEnableVideoSendLayers;
+  webrtc_engine_->SetVideoSendLayers(send_layers);
+  
+  IceRestartConfig ice_restart;
+  ice_restart.grace_period_ms = kIceRestartGracePeriodMs;
+  webrtc_engine_->SetIceRestartConfig(ice_restart);
+  
+  if (!webrtc_engine_->Initialize()) {
+    return false;
+  }
+  webrtc_engine_->SetPeerConnectionPoolSize(kPeerConnectionPoolSize);
+  
+  // 统计采样线程常驻，只在通话期间(StartStatsSampling 之后)真正取统计
+  stats_callback_ = webrtc::make_ref_counted<StatsSamplerCallback>(this);
+  stats_thread_ = webrtc::Thread::Create();
+  stats_thread_->SetName("stats_sampler", nullptr);
+  stats_thread_->Start();
+  stats_thread_->PostTask([this]() { SampleStats(); });
+  return true;
 }
 
 void CallCoordinator::Shutdown() {
+  std::unique_ptr<FileTransferManager> file_transfer;
+  {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    file_transfer = std::move(file_transfer_);
+    file_transfer_peer_id_.clear();
+  }
+  file_transfer.reset();
+  if (stats_thread_) {
+    stats_thread_->Stop();
+    stats_thread_.reset();
+  }
+  if (stats_callback_) {
+    stats_callback_->Detach();
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+    stats_peer_connection_ = nullptr;
+    stats_peer_id_.clear();
+  }
   if (webrtc_engine_) {
     webrtc_engine_->Shutdown();
   }
   if (signal_client_) {
     signal_client_->Disconnect();
   }
-  current_peer_id_.clear();
+  SetCurrentPeer(std::string(), false);
 }
 
 void CallCoordinator::ConnectToSignalServer(const std::string& url, const std::string& client_id) {
@@ -148,7 +379,7 @@ void CallCoordinator::DisconnectFromSignalServer() {
 
 void CallCoordinator::StartCall(const std::string& peer_id) {
   if (call_manager_) {
-    call_manager_->InitiateCall(QString::fromStdString(peer_id));
+    call_manager_->InitiateCall(QString::fromStdString(peer_id), kBundleOfferWithCallRequest);
   }
 }
 
@@ -183,6 +414,7 @@ CallState CallCoordinator::GetCallState() const {
 }
 
 std::string CallCoordinator::GetCurrentPeerId() const {
+  std::lock_guard<std::mutex> lock(peer_mutex_);
   return current_peer_id_;
 }
 
@@ -190,20 +422,305 @@ std::string CallCoordinator::GetClientId() const {
   return signal_client_ ? signal_client_->GetClientId().toStdString() : "";
 }
 
-RtcStatsSnapshot CallCoordinator::GetLatestRtcStats() {
-  if (webrtc_engine_ && webrtc_engine_->HasPeerConnection()) {
-    webrtc_engine_->CollectStats([this](const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
-      ExtractAndStoreRtcStats(report);
-    });
+RtcStatsSnapshot CallCoordinator::GetLatestRtcStats() const {
+  // RTC 统计和 CPU 占用都由后台采样更新，这里只取最近一次的结果
+  RtcStatsSnapshot snapshot;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    snapshot = last_stats_;
+    snapshot.valid = has_stats_;
+  }
+  if (webrtc_engine_) {
+    snapshot.call_setup.idle_pooled_connections =
+        webrtc_engine_->GetPooledPeerConnectionCount();
+    snapshot.active_peer_connections =
+        static_cast<int>(webrtc_engine_->GetPeerConnectionCount());
+    if (auto limits = webrtc_engine_->GetVideoSendLimits(GetCurrentPeerId())) {
+      snapshot.video_send_constraints_valid = true;
+      snapshot.video_send_constraints = ToVideoSendConstraints(*limits);
+    }
+  }
+  return snapshot;
+}
+
+void CallCoordinator::SetVideoSendConstraints(const VideoSendConstraints& constraints) {
+  video_send_constraints_ = constraints;
+  const std::string peer_id = GetCurrentPeerId();
+  if (webrtc_engine_ && webrtc_engine_->HasPeerConnection(peer_id)) {
+    ApplyVideoSendConstraints(peer_id);
+  }
+}
+
+void CallCoordinator::SetStatsSampleInterval(int interval_ms) {
+  stats_sample_interval_ms_ = std::max(interval_ms, kMinStatsSampleIntervalMs);
+}
+
+StatsSummary CallCoordinator::GetStatsSummary(StatsMetric metric, int window_seconds) const {
+  return stats_history_.Summarize(metric, int64_t{window_seconds} * 1000, webrtc::TimeMillis());
+}
+
+std::vector<StatsSample> CallCoordinator::GetStatsHistory(int window_seconds) const {
+  std::vector<StatsSample> samples;
+  stats_history_.GetSamples(int64_t{window_seconds} * 1000, webrtc::TimeMillis(), &samples);
+  return samples;
+}
+
+void CallCoordinator::StartStatsSampling(const std::string& peer_id) {
+  // 按当前间隔覆盖最长通话；容量不变时沿用上次通话的内存
+  const size_t capacity =
+      static_cast<size_t>(kStatsHistoryMaxCallSeconds) * 1000 / stats_sample_interval_ms_ + 1;
+  stats_history_.Reset(capacity);
+  
+  auto peer_connection = webrtc_engine_->GetPeerConnection(peer_id);
+  std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+  stats_peer_connection_ = std::move(peer_connection);
+  stats_peer_id_ = peer_id;
+  ++stats_generation_;
+}
+
+void CallCoordinator::StopStatsSampling(const std::string& peer_id) {
+  // 历史保留到下次通话开始，通话结束后仍可查询
+  std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+  if (stats_peer_id_ != peer_id) {
+    return;
+  }
+  stats_peer_connection_ = nullptr;
+  stats_peer_id_.clear();
+  ++stats_generation_;
+}
+
+void CallCoordinator::SampleStats() {
+  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection;
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+    peer_connection = stats_peer_connection_;
+    generation = stats_generation_;
+  }
+  // 代理把 GetStats 转到信令线程，结果异步送回；上一次的还没送回就跳过。
+  // 本端不再分配，但 WebRTC 每次仍会新建统计报告和转发任务
+  if (peer_connection && stats_callback_->BeginRequest(generation)) {
+    peer_connection->GetStats(stats_callback_.get());
+  }
+  SampleCpuLoad();
+  stats_thread_->PostDelayedTask([this]() { SampleStats(); },
+                                 webrtc::TimeDelta::Millis(stats_sample_interval_ms_));
+}
+
+void CallCoordinator::OnSampledStats(
+    const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report,
+    uint64_t generation) {
+  {
+    // 采样发出后通话已切换，结果不属于当前历史
+    std::lock_guard<std::mutex> lock(stats_sampler_mutex_);
+    if (generation != stats_generation_ || stats_peer_id_.empty()) {
+      return;
+    }
+  }
+  if (!ExtractAndStoreRtcStats(report)) {
+    return;
   }
   
+  // 没有选中候选对时 RTT 为 0，记为缺失，不拉低窗口统计
+  StatsSample sample;
+  sample.time_ms = webrtc::TimeMillis();
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    sample[StatsMetric::kOutboundBitrateKbps] = static_cast<float>(last_stats_.outbound_bitrate_kbps);
+    sample[StatsMetric::kInboundBitrateKbps] = static_cast<float>(last_stats_.inbound_bitrate_kbps);
+    sample[StatsMetric::kRttMs] = last_stats_.current_rtt_ms > 0.0
+                                      ? static_cast<float>(last_stats_.current_rtt_ms)
+                                      : std::numeric_limits<float>::quiet_NaN();
+    sample[StatsMetric::kAudioJitterMs] = static_cast<float>(last_stats_.inbound_audio_jitter_ms);
+    sample[StatsMetric::kAudioPacketLossPercent] =
+        static_cast<float>(last_stats_.inbound_audio_packet_loss_percent);
+    sample[StatsMetric::kVideoPacketLossPercent] =
+        static_cast<float>(last_stats_.inbound_video_packet_loss_percent);
+    sample[StatsMetric::kVideoFps] = static_cast<float>(last_stats_.inbound_video_fps);
+  }
+  stats_history_.Add(sample);
+}
+
+bool CallCoordinator::SendFile(const std::string& path_utf8) {
+  std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+  if (!file_transfer_) {
+    return false;
+  }
+  file_transfer_->SendFile(PathFromUtf8(path_utf8));
+  return true;
+}
+
+void CallCoordinator::CancelFileTransfer(uint32_t id, bool outgoing) {
+  std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+  if (file_transfer_) {
+    file_transfer_->Cancel(id, outgoing);
+  }
+}
+
+void CallCoordinator::CreateFileChannel(const std::string& peer_id) {
+  webrtc_engine_->CreateDataChannel(peer_id, kFileTransferLabel);
+}
+
+void CallCoordinator::StartFileTransfer(const std::string& peer_id) {
+  QString directory = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+  if (directory.isEmpty()) {
+    directory = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+  }
+  auto manager = std::make_unique<FileTransferManager>(
+      std::make_unique<EngineFileTransport>(webrtc_engine_.get(), peer_id), this,
+      std::filesystem::path(directory.toStdU16String()));
+  
+  std::unique_ptr<FileTransferManager> replaced;
+  {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    replaced = std::move(file_transfer_);
+    file_transfer_ = std::move(manager);
+    file_transfer_peer_id_ = peer_id;
+  }
+  file_channel_reopen_attempts_ = 0;
+  
+  // 通道可能在管理器就位前已打开(被叫收到对端通道时)
+  const auto state = webrtc_engine_->GetDataChannelState(peer_id, kFileTransferLabel);
+  if (state == webrtc::DataChannelInterface::kOpen) {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    if (file_transfer_ && file_transfer_peer_id_ == peer_id) {
+      file_transfer_->OnChannelOpen();
+    }
+  }
+}
+
+void CallCoordinator::ReopenFileChannel(const std::string& peer_id) {
+  {
+    std::lock_guard<std::mutex> lock(peer_mutex_);
+    if (peer_id != current_peer_id_ || !is_caller_) {
+      return;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    if (!file_transfer_ || file_transfer_peer_id_ != peer_id) {
+      return;
+    }
+  }
+  // ICE 未连通时建通道也打不开，等 OnIceRecovered 再来
+  if (!webrtc_engine_->IsConnected(peer_id)) {
+    return;
+  }
+  const auto state = webrtc_engine_->GetDataChannelState(peer_id, kFileTransferLabel);
+  if (state == webrtc::DataChannelInterface::kOpen ||
+      state == webrtc::DataChannelInterface::kConnecting) {
+    return;
+  }
+  const int attempt = ++file_channel_reopen_attempts_;
+  if (attempt > kMaxFileChannelReopenAttempts) {
+    if (attempt == kMaxFileChannelReopenAttempts + 1 && ui_observer_) {
+      ui_observer_->OnLogMessage("文件传输通道无法恢复，未完成的传输已暂停", "warning");
+    }
+    return;
+  }
+  RTC_LOG(LS_INFO) << "Reopening file transfer channel with " << peer_id
+                   << " (attempt " << attempt << ")";
+  CreateFileChannel(peer_id);
+}
+
+void CallCoordinator::ClosePeerConnection(const std::string& peer_id) {
+  // 管理器析构时在自己的线程里收尾，要在通道和引擎会话仍在时进行
+  std::unique_ptr<FileTransferManager> file_transfer;
+  {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    if (file_transfer_peer_id_ == peer_id) {
+      file_transfer = std::move(file_transfer_);
+      file_transfer_peer_id_.clear();
+    }
+  }
+  file_transfer.reset();
+  StopStatsSampling(peer_id);
+  if (webrtc_engine_) {
+    webrtc_engine_->ClosePeerConnection(peer_id);
+  }
+}
+
+void CallCoordinator::SetCurrentPeer(const std::string& peer_id, bool is_caller) {
+  std::lock_guard<std::mutex> lock(peer_mutex_);
+  current_peer_id_ = peer_id;
+  is_caller_ = is_caller;
+}
+
+bool CallCoordinator::IsCurrentPeer(const std::string& peer_id) const {
+  std::lock_guard<std::mutex> lock(peer_mutex_);
+  return peer_id == current_peer_id_;
+}
+
+void CallCoordinator::ArmFastPath(bool& flag, const std::string& peer_id) {
+  std::lock_guard<std::mutex> lock(fast_path_mutex_);
+  fast_path_peer_id_ = peer_id;
+  flag = true;
+}
+
+bool CallCoordinator::TakeFastPath(bool& flag, const std::string& peer_id) {
+  std::lock_guard<std::mutex> lock(fast_path_mutex_);
+  if (!flag || peer_id != fast_path_peer_id_) {
+    return false;
+  }
+  flag = false;
+  return true;
+}
+
+bool CallCoordinator::ApplyVideoSendConstraints(const std::string& peer_id) {
+  const bool ok = webrtc_engine_->SetVideoSendLimits(
+      peer_id, ToVideoSendLimits(video_send_constraints_));
+  if (!ok && ui_observer_) {
+    ui_observer_->OnLogMessage("设置视频发送限制失败", "warning");
+  }
+  return ok;
+}
+
+void CallCoordinator::SampleCpuLoad() {
+  const double process_cpu_percent = SampleProcessCpuPercent();
+  // 线程列表只有几项，每次重建
+  std::vector<ThreadCpuStats> thread_cpu = SampleThreadCpu();
+  if (webrtc_engine_) {
+    webrtc_engine_->UpdateCpuLoad(process_cpu_percent);
+  }
   std::lock_guard<std::mutex> lock(stats_mutex_);
-  if (!has_stats_) {
-    RtcStatsSnapshot snapshot = last_stats_;
-    snapshot.valid = false;
-    return snapshot;
+  last_stats_.process_cpu_percent = process_cpu_percent;
+  last_stats_.thread_cpu = std::move(thread_cpu);
+}
+
+double CallCoordinator::SampleProcessCpuPercent() {
+  const int64_t cpu_ns = webrtc::GetProcessCpuTimeNanos();
+  const int64_t wall_ns = webrtc::TimeNanos();
+  double percent = 0.0;
+  if (last_cpu_wall_ns_ > 0 && wall_ns > last_cpu_wall_ns_) {
+    percent = 100.0 * static_cast<double>(cpu_ns - last_cpu_time_ns_) /
+              static_cast<double>(wall_ns - last_cpu_wall_ns_);
   }
-  return last_stats_;
+  last_cpu_time_ns_ = cpu_ns;
+  last_cpu_wall_ns_ = wall_ns;
+  return percent;
+}
+
+std::vector<ThreadCpuStats> CallCoordinator::SampleThreadCpu() {
+  std::vector<ThreadCpuStats> stats;
+  if (!webrtc_engine_) {
+    return stats;
+  }
+  const int64_t wall_ns = webrtc::TimeNanos();
+  const int64_t elapsed_ns = wall_ns - last_thread_cpu_wall_ns_;
+  for (const auto& time : webrtc_engine_->GetThreadCpuTimes()) {
+    ThreadCpuStats thread;
+    thread.name = time.name;
+    thread.placement = time.placement;
+    auto it = last_thread_cpu_ns_.find(time.name);
+    if (it != last_thread_cpu_ns_.end() && last_thread_cpu_wall_ns_ > 0 && elapsed_ns > 0) {
+      thread.cpu_percent =
+          100.0 * static_cast<double>(time.cpu_time_ns - it->second) / elapsed_ns;
+    }
+    last_thread_cpu_ns_[time.name] = time.cpu_time_ns;
+    stats.push_back(std::move(thread));
+  }
+  last_thread_cpu_wall_ns_ = wall_ns;
+  return stats;
 }
 
 // ============================================================================
@@ -217,86 +734,199 @@ void CallCoordinator::OnLocalVideoTrackAdded(webrtc::VideoTrackInterface* track)
   }
 }
 
-void CallCoordinator::OnRemoteVideoTrackAdded(webrtc::VideoTrackInterface* track) {
-  RTC_LOG(LS_INFO) << "Remote video track added";
-  if (ui_observer_) {
+void CallCoordinator::OnRemoteVideoTrackAdded(const std::string& peer_id,
+                                              webrtc::VideoTrackInterface* track) {
+  RTC_LOG(LS_INFO) << "Remote video track added from " << peer_id;
+  // 界面只有一个远端窗口，只显示当前通话对端
+  if (ui_observer_ && IsCurrentPeer(peer_id)) {
     ui_observer_->OnStartRemoteRenderer(track);
   }
 }
 
-void CallCoordinator::OnRemoteVideoTrackRemoved() {
-  RTC_LOG(LS_INFO) << "Remote video track removed";
-  if (ui_observer_) {
+void CallCoordinator::OnRemoteVideoTrackRemoved(const std::string& peer_id) {
+  RTC_LOG(LS_INFO) << "Remote video track removed from " << peer_id;
+  if (ui_observer_ && IsCurrentPeer(peer_id)) {
     ui_observer_->OnStopRemoteRenderer();
   }
 }
 
-void CallCoordinator::OnIceConnectionStateChanged(webrtc::PeerConnectionInterface::IceConnectionState state) {
-  RTC_LOG(LS_INFO) << "ICE connection state changed: " << state;
+void CallCoordinator::OnIceConnectionStateChanged(const std::string& peer_id,
+                                                  webrtc::PeerConnectionInterface::IceConnectionState state) {
+  RTC_LOG(LS_INFO) << "ICE connection state changed for " << peer_id << ": " << state;
+  if (!IsCurrentPeer(peer_id)) {
+    // 呼叫状态机只跟踪当前通话对端
+    return;
+  }
   std::string state_text = IceStateToString(state);
+  const bool connected =
+      state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
+      state == webrtc::PeerConnectionInterface::kIceConnectionCompleted;
+  const bool interrupted =
+      state == webrtc::PeerConnectionInterface::kIceConnectionDisconnected ||
+      state == webrtc::PeerConnectionInterface::kIceConnectionFailed;
+  int64_t setup_ms = -1;
+  bool setup_pooled = false;
   {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     last_ice_state_ = state_text;
     last_stats_.ice_state = state_text;
+    // checking 是重启进行中，仍算中断
+    if (connected || interrupted ||
+        state == webrtc::PeerConnectionInterface::kIceConnectionClosed) {
+      last_stats_.ice_recovery.recovering = interrupted;
+    }
+    
+    // 首次连通时结算本次呼叫的建立耗时
+    if (connected && call_setup_start_ms_ > 0) {
+      setup_ms = webrtc::TimeMillis() - call_setup_start_ms_;
+      setup_pooled = call_setup_pooled_;
+      call_setup_start_ms_ = 0;
+      
+      CallSetupStats& setup = last_stats_.call_setup;
+      setup.last_ms = static_cast<double>(setup_ms);
+      setup.last_pooled = setup_pooled;
+      int& count = setup_pooled ? setup.pooled_count : setup.fresh_count;
+      double& avg_ms = setup_pooled ? setup.pooled_avg_ms : setup.fresh_avg_ms;
+      ++count;
+      avg_ms += (setup.last_ms - avg_ms) / count;
+    }
+  }
+  
+  if (setup_ms >= 0) {
+    RTC_LOG(LS_INFO) << "Call setup took " << setup_ms << " ms ("
+                     << (setup_pooled ? "pre-warmed" : "new") << " PeerConnection)";
+    if (ui_observer_) {
+      ui_observer_->OnLogMessage(
+          "呼叫建立耗时 " + std::to_string(setup_ms) + " ms" +
+              (setup_pooled ? "（预热连接）" : "（新建连接）"),
+          "info");
+    }
   }
   
-  if (state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
-      state == webrtc::PeerConnectionInterface::kIceConnectionCompleted) {
+  if (connected) {
     if (call_manager_) {
       call_manager_->NotifyPeerConnectionEstablished();
     }
-  } else if (state == webrtc::PeerConnectionInterface::kIceConnectionFailed ||
-             state == webrtc::PeerConnectionInterface::kIceConnectionDisconnected ||
-             state == webrtc::PeerConnectionInterface::kIceConnectionClosed) {
+  } else if (interrupted) {
+    // 不挂断：引擎在宽限期后自动重启 ICE，媒体轨道和编码器保持不动
+    if (ui_observer_) {
+      ui_observer_->OnLogMessage("ICE连接已断开，等待恢复", "warning");
+    }
+  } else if (state == webrtc::PeerConnectionInterface::kIceConnectionClosed) {
     if (ui_observer_) {
       ui_observer_->OnLogMessage("ICE连接已断开", "warning");
     }
   }
 }
 
-void CallCoordinator::OnOfferCreated(const std::string& sdp) {
-  RTC_LOG(LS_INFO) << "Offer created, sending to peer...";
-  qDebug() << "=== OnOfferCreated called ===" << "current_peer:" << QString::fromStdString(current_peer_id_);
+void CallCoordinator::OnIceRestarting(const std::string& peer_id, int attempt) {
+  RTC_LOG(LS_INFO) << "ICE restart " << attempt << " with " << peer_id;
+  if (!IsCurrentPeer(peer_id)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    ++last_stats_.ice_recovery.restarts;
+  }
+  if (ui_observer_) {
+    ui_observer_->OnLogMessage("正在重启ICE（第 " + std::to_string(attempt) + " 次）", "info");
+  }
+}
+
+void CallCoordinator::OnIceRecovered(const std::string& peer_id, int64_t recovery_ms,
+                                     int restarts) {
+  RTC_LOG(LS_INFO) << "ICE with " << peer_id << " recovered in " << recovery_ms << " ms";
+  if (!IsCurrentPeer(peer_id)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    IceRecoveryStats& recovery = last_stats_.ice_recovery;
+    recovery.recovering = false;
+    recovery.last_ms = static_cast<double>(recovery_ms);
+    recovery.max_ms = std::max(recovery.max_ms, recovery.last_ms);
+    ++recovery.count;
+    recovery.avg_ms += (recovery.last_ms - recovery.avg_ms) / recovery.count;
+  }
+  // 中断期间文件通道若已关闭，现在可以重建
+  QMetaObject::invokeMethod(call_manager_.get(), [this, peer_id]() {
+    ReopenFileChannel(peer_id);
+  }, Qt::QueuedConnection);
+  if (ui_observer_) {
+    ui_observer_->OnLogMessage(
+        "ICE连接已恢复，耗时 " + std::to_string(recovery_ms) + " ms" +
+            (restarts > 0 ? "（重启 " + std::to_string(restarts) + " 次）" : "（未重启）"),
+        "success");
+  }
+}
+
+void CallCoordinator::OnOfferCreated(const std::string& peer_id, const std::string& sdp) {
+  RTC_LOG(LS_INFO) << "Offer created, sending to " << peer_id;
+  qDebug() << "=== OnOfferCreated called ===" << "peer:" << QString::fromStdString(peer_id);
   
   QJsonObject json_sdp;
   json_sdp["type"] = "offer";
   json_sdp["sdp"] = QString::fromStdString(sdp);
   
+  // 快速路径：offer 随呼叫请求一起发出，已收集的候选用本地描述带上；
+  // 其余候选扣到呼叫请求发出之后，免得先于请求到达而被对端丢弃。
+  // 会话表只能在 UI 线程访问，本地描述切过去再取
+  if (TakeFastPath(offer_for_call_request_, peer_id)) {
+    QMetaObject::invokeMethod(call_manager_.get(), [this, peer_id, json_sdp]() mutable {
+      const std::string local_sdp = webrtc_engine_->GetLocalDescriptionSdp(peer_id);
+      if (!local_sdp.empty()) {
+        json_sdp["sdp"] = QString::fromStdString(local_sdp);
+      }
+      offer_sent_in_request_ = call_manager_->SendPendingCallRequest(json_sdp);
+      ReleaseLocalIceCandidates(peer_id);
+    }, Qt::QueuedConnection);
+    return;
+  }
+  
   if (signal_client_) {
-    qDebug() << "Calling SendOffer to" << QString::fromStdString(current_peer_id_);
+    qDebug() << "Calling SendOffer to" << QString::fromStdString(peer_id);
     
     // 注意：此回调可能在WebRTC线程中调用，需要切换到主线程发送WebSocket消息
-    QString peer_id = QString::fromStdString(current_peer_id_);
-    QMetaObject::invokeMethod(signal_client_.get(), [this, peer_id, json_sdp]() {
-      signal_client_->SendOffer(peer_id, json_sdp);
+    QString to = QString::fromStdString(peer_id);
+    QMetaObject::invokeMethod(signal_client_.get(), [this, to, json_sdp]() {
+      signal_client_->SendOffer(to, json_sdp);
     }, Qt::QueuedConnection);
   } else {
     qDebug() << "ERROR: signal_client_ is null!";
   }
 }
 
-void CallCoordinator::OnAnswerCreated(const std::string& sdp) {
-  RTC_LOG(LS_INFO) << "Answer created, sending to peer...";
-  qDebug() << "=== OnAnswerCreated called ===" << "current_peer:" << QString::fromStdString(current_peer_id_);
+void CallCoordinator::OnAnswerCreated(const std::string& peer_id, const std::string& sdp) {
+  RTC_LOG(LS_INFO) << "Answer created, sending to " << peer_id;
+  qDebug() << "=== OnAnswerCreated called ===" << "peer:" << QString::fromStdString(peer_id);
   
   QJsonObject json_sdp;
   json_sdp["type"] = "answer";
   json_sdp["sdp"] = QString::fromStdString(sdp);
   
+  // 快速路径：answer 随接受响应一起发出
+  if (TakeFastPath(answer_for_call_response_, peer_id)) {
+    QMetaObject::invokeMethod(call_manager_.get(), [this, json_sdp]() {
+      call_manager_->SendAcceptWithAnswer(json_sdp);
+    }, Qt::QueuedConnection);
+    return;
+  }
+  
   if (signal_client_) {
-    qDebug() << "Calling SendAnswer to" << QString::fromStdString(current_peer_id_);
+    qDebug() << "Calling SendAnswer to" << QString::fromStdString(peer_id);
     
     // 注意：此回调可能在WebRTC线程中调用，需要切换到主线程发送WebSocket消息
-    QString peer_id = QString::fromStdString(current_peer_id_);
-    QMetaObject::invokeMethod(signal_client_.get(), [this, peer_id, json_sdp]() {
-      signal_client_->SendAnswer(peer_id, json_sdp);
+    QString to = QString::fromStdString(peer_id);
+    QMetaObject::invokeMethod(signal_client_.get(), [this, to, json_sdp]() {
+      signal_client_->SendAnswer(to, json_sdp);
     }, Qt::QueuedConnection);
   } else {
     qDebug() << "ERROR: signal_client_ is null!";
   }
 }
 
-void CallCoordinator::OnIceCandidateGenerated(const std::string& sdp_mid, 
+void CallCoordinator::OnIceCandidateGenerated(const std::string& peer_id,
+                                               const std::string& sdp_mid, 
                                                int sdp_mline_index, 
                                                const std::string& candidate) {
   RTC_LOG(LS_INFO) << "ICE candidate generated: " << sdp_mline_index;
@@ -306,17 +936,162 @@ void CallCoordinator::OnIceCandidateGenerated(const std::string& sdp_mid,
   json_candidate["sdpMLineIndex"] = sdp_mline_index;
   json_candidate["candidate"] = QString::fromStdString(candidate);
   
+  if (!signal_client_) {
+    return;
+  }
+  
+  bool first_in_batch = false;
+  {
+    std::lock_guard<std::mutex> lock(ice_batch_mutex_);
+    QJsonArray& batch = pending_local_candidates_[peer_id];
+    first_in_batch = batch.isEmpty();
+    batch.append(json_candidate);
+  }
+  
+  // 注意：此回调可能在WebRTC线程中调用，需要切换到主线程发送WebSocket消息。
+  // 每批只切换一次线程：批里第一个候选启动窗口定时器，后续候选只追加
+  if (first_in_batch) {
+    QMetaObject::invokeMethod(signal_client_.get(), [this, peer_id]() {
+      QTimer::singleShot(kIceCandidateBatchWindowMs, signal_client_.get(), [this, peer_id]() {
+        FlushLocalIceCandidates(peer_id);
+      });
+    }, Qt::QueuedConnection);
+  }
+}
+
+void CallCoordinator::OnIceGatheringComplete(const std::string& peer_id) {
+  RTC_LOG(LS_INFO) << "ICE gathering complete for " << peer_id;
+  
   if (signal_client_) {
-    // 注意：此回调可能在WebRTC线程中调用，需要切换到主线程发送WebSocket消息
-    QString peer_id = QString::fromStdString(current_peer_id_);
-    QMetaObject::invokeMethod(signal_client_.get(), [this, peer_id, json_candidate]() {
-      signal_client_->SendIceCandidate(peer_id, json_candidate);
+    // 不必等窗口结束；窗口定时器随后触发时批已清空
+    QMetaObject::invokeMethod(signal_client_.get(), [this, peer_id]() {
+      FlushLocalIceCandidates(peer_id);
     }, Qt::QueuedConnection);
   }
 }
 
-void CallCoordinator::OnError(const std::string& error) {
-  RTC_LOG(LS_ERROR) << "WebRTC Engine error: " << error;
+void CallCoordinator::FlushLocalIceCandidates(const std::string& peer_id) {
+  QJsonArray batch;
+  {
+    std::lock_guard<std::mutex> lock(ice_batch_mutex_);
+    if (peer_id == held_candidates_peer_id_) {
+      return;
+    }
+    auto it = pending_local_candidates_.find(peer_id);
+    if (it == pending_local_candidates_.end()) {
+      return;
+    }
+    batch = it->second;
+    pending_local_candidates_.erase(it);
+  }
+  
+  const QString to = QString::fromStdString(peer_id);
+  if (batch.size() == 1) {
+    // 只有一个时仍用 ice-candidate，不认识批量消息的对端也能收到
+    signal_client_->SendIceCandidate(to, batch.first().toObject());
+  } else if (!batch.isEmpty()) {
+    RTC_LOG(LS_INFO) << "Sending " << batch.size() << " ICE candidates to " << peer_id;
+    signal_client_->SendIceCandidates(to, batch);
+  }
+}
+
+void CallCoordinator::HoldLocalIceCandidates(const std::string& peer_id) {
+  std::lock_guard<std::mutex> lock(ice_batch_mutex_);
+  held_candidates_peer_id_ = peer_id;
+}
+
+void CallCoordinator::ReleaseLocalIceCandidates(const std::string& peer_id) {
+  {
+    std::lock_guard<std::mutex> lock(ice_batch_mutex_);
+    if (held_candidates_peer_id_ != peer_id) {
+      return;
+    }
+    held_candidates_peer_id_.clear();
+  }
+  // 扣住期间窗口定时器没有取走这批，这里补发
+  FlushLocalIceCandidates(peer_id);
+}
+
+void CallCoordinator::OnDataChannelStateChanged(const std::string& peer_id,
+                                                const std::string& label,
+                                                webrtc::DataChannelInterface::DataState state) {
+  RTC_LOG(LS_INFO) << "Data channel " << label << " with " << peer_id << ": "
+                   << webrtc::DataChannelInterface::DataStateString(state);
+  if (label == kFileTransferLabel) {
+    bool reopen = false;
+    {
+      std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+      if (file_transfer_ && file_transfer_peer_id_ == peer_id) {
+        if (state == webrtc::DataChannelInterface::kOpen) {
+          file_channel_reopen_attempts_ = 0;
+          file_transfer_->OnChannelOpen();
+        } else if (state == webrtc::DataChannelInterface::kClosed) {
+          file_transfer_->OnChannelClosed();
+          reopen = true;
+        }
+      }
+    }
+    if (reopen) {
+      QMetaObject::invokeMethod(call_manager_.get(), [this, peer_id]() {
+        ReopenFileChannel(peer_id);
+      }, Qt::QueuedConnection);
+    }
+  }
+  if (!ui_observer_ || !IsCurrentPeer(peer_id)) {
+    return;
+  }
+  if (state == webrtc::DataChannelInterface::kOpen) {
+    ui_observer_->OnLogMessage("数据通道 " + label + " 已打开", "info");
+  } else if (state == webrtc::DataChannelInterface::kClosed) {
+    ui_observer_->OnLogMessage("数据通道 " + label + " 已关闭", "info");
+  }
+}
+
+void CallCoordinator::OnDataChannelMessage(const std::string& peer_id,
+                                           const std::string& label,
+                                           const webrtc::CopyOnWriteBuffer& data,
+                                           bool binary) {
+  if (label == kFileTransferLabel && binary) {
+    std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+    if (file_transfer_ && file_transfer_peer_id_ == peer_id) {
+      file_transfer_->OnMessage(data);
+      return;
+    }
+  }
+  // 其他通道只记录流量
+  RTC_LOG(LS_VERBOSE) << "Data channel " << label << " from " << peer_id << ": "
+                      << data.size() << " bytes" << (binary ? "" : " (text)");
+}
+
+void CallCoordinator::OnDataChannelBufferedAmountChange(const std::string& peer_id,
+                                                        const std::string& label,
+                                                        uint64_t sent_data_size) {
+  if (label != kFileTransferLabel) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(file_transfer_mutex_);
+  if (file_transfer_ && file_transfer_peer_id_ == peer_id) {
+    file_transfer_->OnBufferedAmountChange();
+  }
+}
+
+void CallCoordinator::OnError(const std::string& peer_id, const std::string& error) {
+  RTC_LOG(LS_ERROR) << "WebRTC Engine error (" << peer_id << "): " << error;
+  
+  // 快速路径中途失败时不要让对端空等：退回不带 SDP 的请求/响应，
+  // 对端随后按原流程单独交换 offer/answer。其他会话的错误不影响快速路径
+  if (TakeFastPath(offer_for_call_request_, peer_id)) {
+    QMetaObject::invokeMethod(call_manager_.get(), [this, peer_id]() {
+      call_manager_->SendPendingCallRequest(QJsonObject());
+      ReleaseLocalIceCandidates(peer_id);
+    }, Qt::QueuedConnection);
+  }
+  if (TakeFastPath(answer_for_call_response_, peer_id)) {
+    QMetaObject::invokeMethod(call_manager_.get(), [this]() {
+      call_manager_->SendAcceptWithAnswer(QJsonObject());
+    }, Qt::QueuedConnection);
+  }
+  
   if (ui_observer_) {
     ui_observer_->OnShowError("WebRTC错误", error);
   }
@@ -379,7 +1154,7 @@ void CallCoordinator::OnClientListUpdate(const QJsonArray& clients) {
 
 void CallCoordinator::OnUserOffline(const std::string& client_id) {
   RTC_LOG(LS_INFO) << "User offline: " << client_id;
-  if (client_id == current_peer_id_ && call_manager_) {
+  if (IsCurrentPeer(client_id) && call_manager_) {
     call_manager_->EndCall();
   }
 }
@@ -387,12 +1162,24 @@ void CallCoordinator::OnUserOffline(const std::string& client_id) {
 void CallCoordinator::OnCallRequest(const std::string& from, const QJsonObject& payload) {
   RTC_LOG(LS_INFO) << "Call request from: " << from;
   if (call_manager_) {
-    call_manager_->HandleCallRequest(QString::fromStdString(from));
+    const QJsonObject offer = payload.value("offer").toObject();
+    call_manager_->HandleCallRequest(QString::fromStdString(from), !offer.isEmpty());
+    
+    // 忙线时请求已被直接拒绝，只为真正进入响铃的来电保存 offer
+    if (!offer.isEmpty() && call_manager_->GetCallState() == CallState::Receiving &&
+        call_manager_->GetCurrentPeer() == QString::fromStdString(from)) {
+      RTC_LOG(LS_INFO) << "Call request carries an offer, answer will be bundled with acceptance";
+      bundled_remote_offer_ = offer;
+    }
   }
 }
 
-void CallCoordinator::OnCallResponse(const std::string& from, bool accepted, const std::string& reason) {
+void CallCoordinator::OnCallResponse(const std::string& from, bool accepted, const std::string& reason,
+                                     const QJsonObject& payload) {
   RTC_LOG(LS_INFO) << "Call response from: " << from << " accepted: " << accepted;
+  if (accepted && offer_sent_in_request_) {
+    bundled_remote_answer_ = payload.value("answer").toObject();
+  }
   if (call_manager_) {
     call_manager_->HandleCallResponse(
         QString::fromStdString(from), 
@@ -434,12 +1221,34 @@ void CallCoordinator::OnIceCandidate(const std::string& from, const QJsonObject&
   ProcessIceCandidate(from, candidate);
 }
 
+void CallCoordinator::OnIceCandidates(const std::string& from, const QJsonArray& candidates) {
+  RTC_LOG(LS_INFO) << "Received " << candidates.size() << " ICE candidates from: " << from;
+  ProcessIceCandidates(from, candidates);
+}
+
 // ============================================================================
 // CallManagerObserver 实现 - 处理呼叫流程
 // ============================================================================
 
 void CallCoordinator::OnCallStateChanged(CallState state, const std::string& peer_id) {
   RTC_LOG(LS_INFO) << "Call state changed: " << static_cast<int>(state);
+  
+  // 呼叫结束后丢弃快速建连的中间状态
+  if (state == CallState::Idle) {
+    {
+      std::lock_guard<std::mutex> lock(fast_path_mutex_);
+      offer_for_call_request_ = false;
+      answer_for_call_response_ = false;
+      fast_path_peer_id_.clear();
+    }
+    {
+      std::lock_guard<std::mutex> lock(ice_batch_mutex_);
+      held_candidates_peer_id_.clear();
+    }
+    offer_sent_in_request_ = false;
+    bundled_remote_offer_ = QJsonObject();
+    bundled_remote_answer_ = QJsonObject();
+  }
   if (ui_observer_) {
     ui_observer_->OnCallStateChanged(state, peer_id);
   }
@@ -464,9 +1273,7 @@ void CallCoordinator::OnCallRejected(const std::string& peer_id, const std::stri
     ui_observer_->OnStopRemoteRenderer();
   }
   
-  if (webrtc_engine_) {
-    webrtc_engine_->ClosePeerConnection();
-  }
+  ClosePeerConnection(peer_id);
 }
 
 void CallCoordinator::OnCallCancelled(const std::string& peer_id, const std::string& reason) {
@@ -477,9 +1284,7 @@ void CallCoordinator::OnCallCancelled(const std::string& peer_id, const std::str
     ui_observer_->OnStopRemoteRenderer();
   }
   
-  if (webrtc_engine_) {
-    webrtc_engine_->ClosePeerConnection();
-  }
+  ClosePeerConnection(peer_id);
 }
 
 void CallCoordinator::OnCallEnded(const std::string& peer_id, const std::string& reason) {
@@ -490,9 +1295,7 @@ void CallCoordinator::OnCallEnded(const std::string& peer_id, const std::string&
     ui_observer_->OnStopRemoteRenderer();
   }
   
-  if (webrtc_engine_) {
-    webrtc_engine_->ClosePeerConnection();
-  }
+  ClosePeerConnection(peer_id);
 }
 
 void CallCoordinator::OnCallTimeout() {
@@ -503,40 +1306,123 @@ void CallCoordinator::OnCallTimeout() {
     ui_observer_->OnStopRemoteRenderer();
   }
   
-  if (webrtc_engine_) {
-    webrtc_engine_->ClosePeerConnection();
-  }
+  ClosePeerConnection(GetCurrentPeerId());
 }
 
 void CallCoordinator::OnNeedCreatePeerConnection(const std::string& peer_id, bool is_caller) {
   RTC_LOG(LS_INFO) << "Need create peer connection with: " << peer_id << " is_caller: " << is_caller;
   qDebug() << "=== OnNeedCreatePeerConnection ===" << "peer:" << QString::fromStdString(peer_id) << "is_caller:" << is_caller;
   
-  current_peer_id_ = peer_id;
-  is_caller_ = is_caller;
+  SetCurrentPeer(peer_id, is_caller);
   
-  if (!webrtc_engine_->HasPeerConnection()) {
+  const int64_t start_ms = webrtc::TimeMillis();
+  if (webrtc_engine_->HasPeerConnection(peer_id)) {
+    // 响铃期间已经预创建，ICE 候选也已在收集
+    qDebug() << "Using speculative PeerConnection created while ringing";
+  } else {
     qDebug() << "Creating PeerConnection...";
-    if (webrtc_engine_->CreatePeerConnection()) {
-      qDebug() << "PeerConnection created successfully, adding tracks...";
-      webrtc_engine_->AddTracks();
-      
-      if (is_caller) {
-        qDebug() << "Caller side - calling CreateOffer()";
-        webrtc_engine_->CreateOffer();
-        qDebug() << "CreateOffer() returned";
-      } else {
-        qDebug() << "Callee side - waiting for offer";
-      }
-    } else {
+    if (!webrtc_engine_->CreatePeerConnection(peer_id, is_caller)) {
       RTC_LOG(LS_ERROR) << "Failed to create peer connection";
       qDebug() << "ERROR: Failed to create peer connection";
       if (ui_observer_) {
         ui_observer_->OnShowError("错误", "创建连接失败");
       }
+      return;
     }
+    qDebug() << "PeerConnection created successfully";
+  }
+  
+  qDebug() << "Adding tracks...";
+  webrtc_engine_->AddTracks(peer_id);
+  ApplyVideoSendConstraints(peer_id);
+  StartFileTransfer(peer_id);
+  StartStatsSampling(peer_id);
+  
+  const bool pooled = webrtc_engine_->IsPooledPeerConnection(peer_id);
+  RTC_LOG(LS_INFO) << "PeerConnection ready in "
+                   << (webrtc::TimeMillis() - start_ms) << " ms"
+                   << (pooled ? " (pre-warmed)" : " (new)");
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    call_setup_start_ms_ = start_ms;
+    call_setup_pooled_ = pooled;
+  }
+  
+  if (is_caller) {
+    if (!bundled_remote_answer_.isEmpty()) {
+      // 快速路径：answer 已随接受响应到达
+      qDebug() << "Caller side - applying answer bundled with call response";
+      const QJsonObject answer = bundled_remote_answer_;
+      bundled_remote_answer_ = QJsonObject();
+      ProcessAnswer(peer_id, answer);
+    } else if (offer_sent_in_request_) {
+      // 对端不支持快速路径，按原流程单独发送 offer；
+      // 用当前本地描述，带上响铃期间已收集的候选
+      qDebug() << "Caller side - peer ignored bundled offer, sending it separately";
+      OnOfferCreated(peer_id, webrtc_engine_->GetLocalDescriptionSdp(peer_id));
+    } else {
+      qDebug() << "Caller side - calling CreateOffer()";
+      if (!webrtc_engine_->GetDataChannelState(peer_id, kFileTransferLabel)) {
+        CreateFileChannel(peer_id);
+      }
+      webrtc_engine_->CreateOffer(peer_id);
+      qDebug() << "CreateOffer() returned";
+    }
+  } else if (!bundled_remote_offer_.isEmpty()) {
+    // 快速路径：直接应用来电自带的 offer，answer 随接受响应发出
+    qDebug() << "Callee side - applying offer bundled with call request";
+    const QJsonObject offer = bundled_remote_offer_;
+    bundled_remote_offer_ = QJsonObject();
+    ArmFastPath(answer_for_call_response_, peer_id);
+    ProcessOffer(peer_id, offer);
+  } else {
+    qDebug() << "Callee side - waiting for offer";
+  }
+}
+
+void CallCoordinator::OnNeedPreparePeerConnection(const std::string& peer_id, bool is_caller) {
+  RTC_LOG(LS_INFO) << "Preparing speculative peer connection with: " << peer_id
+                   << " is_caller: " << is_caller;
+  
+  SetCurrentPeer(peer_id, is_caller);
+  const bool bundle_offer = is_caller && call_manager_->IsCallRequestPending();
+  if (webrtc_engine_->HasPeerConnection(peer_id)) {
+    if (bundle_offer) {
+      call_manager_->SendPendingCallRequest(QJsonObject());
+    }
+    return;
+  }
+  
+  // 只建连接并开始收集 ICE 候选；被叫接听前不加轨道，不打开摄像头
+  if (bundle_offer) {
+    HoldLocalIceCandidates(peer_id);
+  }
+  const int64_t start_ms = webrtc::TimeMillis();
+  if (webrtc_engine_->CreatePeerConnection(peer_id, is_caller)) {
+    RTC_LOG(LS_INFO) << "Speculative PeerConnection ready in "
+                     << (webrtc::TimeMillis() - start_ms) << " ms"
+                     << (webrtc_engine_->IsPooledPeerConnection(peer_id) ? " (pre-warmed)" : " (new)");
   } else {
-    qDebug() << "PeerConnection already exists!";
+    // 失败不影响呼叫，接听后会再尝试创建
+    RTC_LOG(LS_WARNING) << "Speculative PeerConnection creation failed";
+    if (bundle_offer) {
+      call_manager_->SendPendingCallRequest(QJsonObject());
+      ReleaseLocalIceCandidates(peer_id);
+    }
+    return;
+  }
+  
+  // 快速路径：主叫先建好 offer，随呼叫请求一起发出(OnOfferCreated)。
+  // offer 只需要收发器，轨道在接听后才挂上，摄像头同样接听后才打开
+  if (bundle_offer) {
+    if (!webrtc_engine_->AddSendTransceivers(peer_id)) {
+      call_manager_->SendPendingCallRequest(QJsonObject());
+      ReleaseLocalIceCandidates(peer_id);
+      return;
+    }
+    CreateFileChannel(peer_id);
+    ArmFastPath(offer_for_call_request_, peer_id);
+    webrtc_engine_->CreateOffer(peer_id);
   }
 }
 
@@ -548,8 +1434,12 @@ void CallCoordinator::OnNeedClosePeerConnection() {
     ui_observer_->OnStopRemoteRenderer();
   }
   
-  if (webrtc_engine_) {
-    webrtc_engine_->ClosePeerConnection();
+  ClosePeerConnection(GetCurrentPeerId());
+}
+
+void CallCoordinator::OnFileTransferProgress(const FileTransferProgress& progress) {
+  if (ui_observer_) {
+    ui_observer_->OnFileTransferProgress(progress);
   }
 }
 
@@ -561,8 +1451,9 @@ void CallCoordinator::ProcessOffer(const std::string& from, const QJsonObject& s
   RTC_LOG(LS_INFO) << "Processing offer from: " << from;
   qDebug() << "=== ProcessOffer called ===" << "from:" << QString::fromStdString(from);
   
-  if (!webrtc_engine_->HasPeerConnection()) {
-    RTC_LOG(LS_ERROR) << "No peer connection exists when processing offer!";
+  // 按发送方路由到对应会话
+  if (!webrtc_engine_->HasPeerConnection(from)) {
+    RTC_LOG(LS_ERROR) << "No peer connection for " << from << " when processing offer!";
     qDebug() << "ERROR: No peer connection exists!";
     if (ui_observer_) {
       ui_observer_->OnLogMessage("错误: 收到offer但没有PeerConnection", "error");
@@ -571,8 +1462,7 @@ void CallCoordinator::ProcessOffer(const std::string& from, const QJsonObject& s
   }
   
   qDebug() << "PeerConnection exists, setting current_peer and processing offer";
-  current_peer_id_ = from;
-  is_caller_ = false;
+  SetCurrentPeer(from, false);
   
   if (ui_observer_) {
     ui_observer_->OnLogMessage("正在处理来自 " + from + " 的offer", "info");
@@ -588,9 +1478,9 @@ void CallCoordinator::ProcessOffer(const std::string& from, const QJsonObject& s
 
   std::string sdp_str = sdp_text.toStdString();
   qDebug() << "Calling SetRemoteOffer...";
-  webrtc_engine_->SetRemoteOffer(sdp_str);
+  webrtc_engine_->SetRemoteOffer(from, sdp_str);
   qDebug() << "Calling CreateAnswer...";
-  webrtc_engine_->CreateAnswer();
+  webrtc_engine_->CreateAnswer(from);
   qDebug() << "CreateAnswer returned";
 }
 
@@ -606,86 +1496,92 @@ void CallCoordinator::ProcessAnswer(const std::string& from, const QJsonObject&
   }
 
   std::string sdp_str = sdp_text.toStdString();
-  webrtc_engine_->SetRemoteAnswer(sdp_str);
+  webrtc_engine_->SetRemoteAnswer(from, sdp_str);
 }
 
 void CallCoordinator::ProcessIceCandidate(const std::string& from, const QJsonObject& candidate) {
   RTC_LOG(LS_INFO) << "Processing ICE candidate from: " << from;
   
-  const QJsonObject candidate_payload = ExtractCandidatePayload(candidate);
-  const QString sdp_mid_value = candidate_payload.value("sdpMid").toString();
-  const int sdp_mline_index = ExtractMLineIndex(candidate_payload);
-  const QString candidate_text = candidate_payload.value("candidate").toString();
-
-  if (sdp_mid_value.isEmpty() || sdp_mline_index < 0 || candidate_text.isEmpty()) {
-    RTC_LOG(LS_ERROR) << "ICE candidate payload incomplete";
-    qDebug() << "ERROR: ICE candidate payload incomplete"
-             << "sdpMid:" << sdp_mid_value
-             << "mline:" << sdp_mline_index
-             << "candidate:" << candidate_text.left(32);
+  RemoteIceCandidate parsed;
+  if (!ParseRemoteIceCandidate(candidate, &parsed)) {
     return;
   }
   
-  std::string sdp_mid = sdp_mid_value.toStdString();
-  std::string sdp = candidate_text.toStdString();
+  webrtc_engine_->AddIceCandidate(from, parsed.sdp_mid, parsed.sdp_mline_index,
+                                  parsed.candidate);
+}
+
+void CallCoordinator::ProcessIceCandidates(const std::string& from, const QJsonArray& candidates) {
+  RTC_LOG(LS_INFO) << "Processing " << candidates.size() << " ICE candidates from: " << from;
+  
+  std::vector<RemoteIceCandidate> parsed;
+  parsed.reserve(candidates.size());
+  for (const QJsonValue& value : candidates) {
+    RemoteIceCandidate candidate;
+    if (ParseRemoteIceCandidate(value.toObject(), &candidate)) {
+      parsed.push_back(std::move(candidate));
+    }
+  }
   
-  webrtc_engine_->AddIceCandidate(sdp_mid, sdp_mline_index, sdp);
+  if (!parsed.empty()) {
+    webrtc_engine_->AddIceCandidates(from, parsed);
+  }
 }
 
-void CallCoordinator::ExtractAndStoreRtcStats(
+bool CallCoordinator::ExtractAndStoreRtcStats(
     const webrtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
   if (!report) {
-    return;
+    return false;
   }
 
-  RtcStatsSnapshot snapshot;
-  snapshot.valid = true;
-  snapshot.timestamp_ms =
+  // 先只记指针和数值，字符串留到写入 last_stats_ 时复用其已有的缓冲区
+  const uint64_t timestamp_ms =
       static_cast<uint64_t>(report->timestamp().us() / 1000);
-  snapshot.ice_state = last_ice_state_;
-  snapshot.local_candidate_summary = "-";
-  snapshot.remote_candidate_summary = "-";
-
   uint64_t inbound_bytes = 0;
   uint64_t outbound_bytes = 0;
 
   const webrtc::RTCInboundRtpStreamStats* audio_inbound = nullptr;
   const webrtc::RTCInboundRtpStreamStats* video_inbound = nullptr;
+  const webrtc::RTCOutboundRtpStreamStats* video_outbound = nullptr;
 
-  const auto inbound_stats = report->GetStatsOfType<webrtc::RTCInboundRtpStreamStats>();
-  for (const auto* stat : inbound_stats) {
-    inbound_bytes += stat->bytes_received.value_or(0u);
-    const std::string kind = stat->kind.value_or("");
-    if (!audio_inbound && kind == "audio") {
-      audio_inbound = stat;
-    } else if (!video_inbound && kind == "video") {
-      video_inbound = stat;
-    }
-  }
-
-  const auto outbound_stats = report->GetStatsOfType<webrtc::RTCOutboundRtpStreamStats>();
-  for (const auto* stat : outbound_stats) {
-    outbound_bytes += stat->bytes_sent.value_or(0u);
-  }
-
-  const auto candidate_pairs = report->GetStatsOfType<webrtc::RTCIceCandidatePairStats>();
   const webrtc::RTCIceCandidatePairStats* selected_pair = nullptr;
-  for (const auto* pair : candidate_pairs) {
-    // 检查状态是否为 succeeded（选中的候选对）
-    // 在新版本中，使用 nominated 和 state 字段
-    if (pair->nominated.value_or(false) && pair->state.has_value()) {
-      std::string state_str = *pair->state;
-      if (state_str == "succeeded") {
-        selected_pair = pair;
-        break;
+
+  // 一遍遍历报告；GetStatsOfType 每次都会新建一个 vector
+  for (const webrtc::RTCStats& stats : *report) {
+    if (stats.type() == webrtc::RTCInboundRtpStreamStats::kType) {
+      const auto& stat = stats.cast_to<webrtc::RTCInboundRtpStreamStats>();
+      inbound_bytes += stat.bytes_received.value_or(0u);
+      if (!stat.kind) {
+        continue;
+      }
+      if (!audio_inbound && *stat.kind == "audio") {
+        audio_inbound = &stat;
+      } else if (!video_inbound && *stat.kind == "video") {
+        video_inbound = &stat;
+      }
+    } else if (stats.type() == webrtc::RTCOutboundRtpStreamStats::kType) {
+      const auto& stat = stats.cast_to<webrtc::RTCOutboundRtpStreamStats>();
+      outbound_bytes += stat.bytes_sent.value_or(0u);
+      if (!video_outbound && stat.kind && *stat.kind == "video") {
+        video_outbound = &stat;
+      }
+    } else if (!selected_pair && stats.type() == webrtc::RTCIceCandidatePairStats::kType) {
+      // 检查状态是否为 succeeded（选中的候选对）
+      // 在新版本中，使用 nominated 和 state 字段
+      const auto& pair = stats.cast_to<webrtc::RTCIceCandidatePairStats>();
+      if (pair.nominated.value_or(false) && pair.state && *pair.state == "succeeded") {
+        selected_pair = &pair;
       }
     }
   }
 
+  double current_rtt_ms = 0.0;
+  double outbound_bitrate_kbps = 0.0;
+  double inbound_bitrate_kbps = 0.0;
   if (selected_pair) {
     const double rtt_seconds =
         selected_pair->current_round_trip_time.value_or(0.0);
-    snapshot.current_rtt_ms = rtt_seconds * 1000.0;
+    current_rtt_ms = rtt_seconds * 1000.0;
 
     const double outgoing_bps =
         selected_pair->available_outgoing_bitrate.value_or(0.0);
@@ -693,16 +1589,18 @@ void CallCoordinator::ExtractAndStoreRtcStats(
         selected_pair->available_incoming_bitrate.value_or(0.0);
 
     if (outgoing_bps > 0.0) {
-      snapshot.outbound_bitrate_kbps = outgoing_bps / 1000.0;
+      outbound_bitrate_kbps = outgoing_bps / 1000.0;
     }
     if (incoming_bps > 0.0) {
-      snapshot.inbound_bitrate_kbps = incoming_bps / 1000.0;
+      inbound_bitrate_kbps = incoming_bps / 1000.0;
     }
   }
 
+  double audio_jitter_ms = 0.0;
+  double audio_packet_loss_percent = 0.0;
   if (audio_inbound) {
     const double jitter_seconds = audio_inbound->jitter.value_or(0.0);
-    snapshot.inbound_audio_jitter_ms = jitter_seconds * 1000.0;
+    audio_jitter_ms = jitter_seconds * 1000.0;
 
     const double packets_lost =
         static_cast<double>(audio_inbound->packets_lost.value_or(0));
@@ -710,11 +1608,11 @@ void CallCoordinator::ExtractAndStoreRtcStats(
         static_cast<double>(audio_inbound->packets_received.value_or(0u));
     const double total_audio_packets = packets_lost + packets_received;
     if (total_audio_packets > 0.0) {
-      snapshot.inbound_audio_packet_loss_percent =
-          (packets_lost / total_audio_packets) * 100.0;
+      audio_packet_loss_percent = (packets_lost / total_audio_packets) * 100.0;
     }
   }
 
+  double video_packet_loss_percent = 0.0;
   if (video_inbound) {
     const double packets_lost =
         static_cast<double>(video_inbound->packets_lost.value_or(0));
@@ -722,45 +1620,64 @@ void CallCoordinator::ExtractAndStoreRtcStats(
         static_cast<double>(video_inbound->packets_received.value_or(0u));
     const double total_video_packets = packets_lost + packets_received;
     if (total_video_packets > 0.0) {
-      snapshot.inbound_video_packet_loss_percent =
-          (packets_lost / total_video_packets) * 100.0;
+      video_packet_loss_percent = (packets_lost / total_video_packets) * 100.0;
     }
-
-    snapshot.inbound_video_fps =
-        video_inbound->frames_per_second.value_or(0.0);
-    snapshot.inbound_video_width =
-        video_inbound->frame_width.value_or(0);
-    snapshot.inbound_video_height =
-        video_inbound->frame_height.value_or(0);
   }
 
   {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     if (last_rate_sample_.valid) {
-      const uint64_t delta_ms =
-          snapshot.timestamp_ms - last_rate_sample_.timestamp_ms;
+      const uint64_t delta_ms = timestamp_ms - last_rate_sample_.timestamp_ms;
       if (delta_ms > 0) {
         const double inbound_delta =
             static_cast<double>(inbound_bytes - last_rate_sample_.inbound_bytes);
         const double outbound_delta =
             static_cast<double>(outbound_bytes - last_rate_sample_.outbound_bytes);
-        if (snapshot.inbound_bitrate_kbps <= 0.0 && inbound_delta >= 0.0) {
-          snapshot.inbound_bitrate_kbps = (inbound_delta * 8.0) / delta_ms;
+        if (inbound_bitrate_kbps <= 0.0 && inbound_delta >= 0.0) {
+          inbound_bitrate_kbps = (inbound_delta * 8.0) / delta_ms;
         }
-        if (snapshot.outbound_bitrate_kbps <= 0.0 && outbound_delta >= 0.0) {
-          snapshot.outbound_bitrate_kbps = (outbound_delta * 8.0) / delta_ms;
+        if (outbound_bitrate_kbps <= 0.0 && outbound_delta >= 0.0) {
+          outbound_bitrate_kbps = (outbound_delta * 8.0) / delta_ms;
         }
       }
     }
 
     last_rate_sample_.inbound_bytes = inbound_bytes;
     last_rate_sample_.outbound_bytes = outbound_bytes;
-    last_rate_sample_.timestamp_ms = snapshot.timestamp_ms;
+    last_rate_sample_.timestamp_ms = timestamp_ms;
     last_rate_sample_.valid = true;
 
-    last_stats_ = snapshot;
+    // 原地更新：ice_state 由 ICE 回调维护，呼叫建立和 ICE 恢复耗时在 ICE
+    // 回调里累计；字符串 assign 进已有容量，稳定后不再分配
+    RtcStatsSnapshot& stats = last_stats_;
+    stats.valid = true;
+    stats.timestamp_ms = timestamp_ms;
+    stats.current_rtt_ms = current_rtt_ms;
+    stats.outbound_bitrate_kbps = outbound_bitrate_kbps;
+    stats.inbound_bitrate_kbps = inbound_bitrate_kbps;
+    stats.inbound_audio_jitter_ms = audio_jitter_ms;
+    stats.inbound_audio_packet_loss_percent = audio_packet_loss_percent;
+    stats.inbound_video_packet_loss_percent = video_packet_loss_percent;
+    stats.inbound_video_fps =
+        video_inbound ? video_inbound->frames_per_second.value_or(0.0) : 0.0;
+    stats.inbound_video_width =
+        video_inbound ? video_inbound->frame_width.value_or(0) : 0;
+    stats.inbound_video_height =
+        video_inbound ? video_inbound->frame_height.value_or(0) : 0;
+    stats.inbound_video_codec.assign(
+        video_inbound ? CodecNameFromStats(*report, video_inbound->codec_id)
+                      : std::string_view());
+    stats.outbound_video_codec.assign(
+        video_outbound ? CodecNameFromStats(*report, video_outbound->codec_id)
+                       : std::string_view());
+    if (video_outbound && video_outbound->quality_limitation_reason) {
+      stats.quality_limitation_reason.assign(*video_outbound->quality_limitation_reason);
+    } else {
+      stats.quality_limitation_reason.clear();
+    }
     has_stats_ = true;
   }
+  return true;
 }
 
 std::string CallCoordinator::IceStateToString(
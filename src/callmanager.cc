@@ -6,7 +6,9 @@ CallManager::CallManager(QObject* parent)
       signal_client_(nullptr),
       observer_(nullptr),
       call_state_(CallState::Idle),
-      is_caller_(false) {
+      is_caller_(false),
+      call_request_pending_(false),
+      accept_with_answer_(false) {
   call_request_timer_ = std::make_unique<QTimer>(this);
   call_request_timer_->setSingleShot(true);
   connect(call_request_timer_.get(), &QTimer::timeout, this, &CallManager::OnCallRequestTimeout);
@@ -22,7 +24,7 @@ void CallManager::RegisterObserver(CallManagerObserver* observer) {
   observer_ = observer;
 }
 
-bool CallManager::InitiateCall(const QString& target_client_id) {
+bool CallManager::InitiateCall(const QString& target_client_id, bool bundle_offer) {
   if (!signal_client_ || !signal_client_->IsConnected()) {
     qWarning() << "Cannot initiate call: signal client not connected";
     return false;
@@ -37,17 +39,36 @@ bool CallManager::InitiateCall(const QString& target_client_id) {
   
   current_peer_ = target_client_id;
   is_caller_ = true;
+  call_request_pending_ = bundle_offer;
   SetCallState(CallState::Calling);
   
-  // 发送呼叫请求
-  signal_client_->SendCallRequest(target_client_id);
+  // 发送呼叫请求（快速路径下由观察者在 offer 就绪后发送）
+  if (!bundle_offer) {
+    signal_client_->SendCallRequest(target_client_id);
+  }
   
   // 启动超时计时器
   StartCallRequestTimer();
   
+  // 响铃期间预创建连接，提前收集 ICE 候选
+  if (observer_) {
+    observer_->OnNeedPreparePeerConnection(current_peer_.toStdString(), true);
+  }
+  
   return true;
 }
 
+bool CallManager::SendPendingCallRequest(const QJsonObject& offer) {
+  if (!call_request_pending_ || call_state_ != CallState::Calling) {
+    return false;
+  }
+  
+  qDebug() << "Sending call request to:" << current_peer_ << "with offer:" << !offer.isEmpty();
+  call_request_pending_ = false;
+  signal_client_->SendCallRequest(current_peer_, offer);
+  return !offer.isEmpty();
+}
+
 void CallManager::CancelCall() {
   if (call_state_ != CallState::Calling) {
     qWarning() << "Cannot cancel: not in calling state";
@@ -61,6 +82,11 @@ void CallManager::CancelCall() {
     signal_client_->SendCallCancel(current_peer_, "cancelled");
   }
   
+  // 丢弃响铃期间预创建的连接
+  if (observer_) {
+    observer_->OnNeedClosePeerConnection();
+  }
+  
   CleanupCall();
 }
 
@@ -74,8 +100,10 @@ void CallManager::AcceptCall() {
   
   qDebug() << "Accepting call from:" << current_peer_;
   
-  // 发送接受响应
-  signal_client_->SendCallResponse(current_peer_, true);
+  // 发送接受响应；来电带 offer 时等 answer 生成后一起发送
+  if (!accept_with_answer_) {
+    signal_client_->SendCallResponse(current_peer_, true);
+  }
   
   SetCallState(CallState::Connecting);
   
@@ -87,6 +115,17 @@ void CallManager::AcceptCall() {
   qDebug() << "PeerConnection created, waiting for offer from:" << current_peer_;
 }
 
+bool CallManager::SendAcceptWithAnswer(const QJsonObject& answer) {
+  if (!accept_with_answer_ || call_state_ != CallState::Connecting) {
+    return false;
+  }
+  
+  qDebug() << "Sending accept response to:" << current_peer_ << "with answer:" << !answer.isEmpty();
+  accept_with_answer_ = false;
+  signal_client_->SendCallResponse(current_peer_, true, QString(), answer);
+  return !answer.isEmpty();
+}
+
 void CallManager::RejectCall(const QString& reason) {
   if (call_state_ != CallState::Receiving) {
     qWarning() << "Cannot reject: not in receiving state";
@@ -99,6 +138,11 @@ void CallManager::RejectCall(const QString& reason) {
   QString reject_reason = reason.isEmpty() ? "rejected" : reason;
   signal_client_->SendCallResponse(current_peer_, false, reject_reason);
   
+  // 丢弃响铃期间预创建的连接
+  if (observer_) {
+    observer_->OnNeedClosePeerConnection();
+  }
+  
   CleanupCall();
 }
 
@@ -172,6 +216,8 @@ void CallManager::CleanupCall() {
   StopCallRequestTimer();
   current_peer_.clear();
   is_caller_ = false;
+  call_request_pending_ = false;
+  accept_with_answer_ = false;
   SetCallState(CallState::Idle);
 }
 
@@ -185,7 +231,7 @@ void CallManager::StopCallRequestTimer() {
   }
 }
 
-void CallManager::HandleCallRequest(const QString& from) {
+void CallManager::HandleCallRequest(const QString& from, bool offer_included) {
   qDebug() << "HandleCallRequest from:" << from << "current state:" << static_cast<int>(call_state_);
   
   // 如果已经在通话中，自动拒绝
@@ -199,11 +245,13 @@ void CallManager::HandleCallRequest(const QString& from) {
   
   current_peer_ = from;
   is_caller_ = false;
+  accept_with_answer_ = offer_included;
   SetCallState(CallState::Receiving);
   
-  // 通知观察者有来电
+  // 通知观察者有来电，并在响铃期间预创建连接
   if (observer_) {
     observer_->OnIncomingCall(from.toStdString());
+    observer_->OnNeedPreparePeerConnection(from.toStdString(), false);
   }
   
   emit IncomingCall(from);
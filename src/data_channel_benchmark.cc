@@ -0,0 +1,276 @@
+#include "data_channel_benchmark.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "api/environment/environment.h"
+#include "api/units/time_delta.h"
+#include "loopback_endpoint.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "rtc_base/event.h"
+#include "rtc_base/strings/string_builder.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/thread_annotations.h"
+#include "rtc_base/time_utils.h"
+
+const char kDataChannelBenchmarkSwitch[] = "--benchmark-datachannel";
+
+namespace {
+
+constexpr int kConnectTimeoutMs = 15000;
+constexpr int kDrainTimeoutMs = 30000;
+// After the sender's queue is empty, how long an unreliable channel may
+// stay silent before the transfer counts as finished.
+constexpr int kQuietMs = 500;
+constexpr size_t kChunkBytes = 64 * 1024;
+constexpr uint64_t kTransferBytes = 64ull * 1024 * 1024;
+// Queued bytes kept in SCTP; well below the send queue limit and enough to
+// keep a loopback association busy.
+constexpr uint64_t kHighWatermarkBytes = 1024 * 1024;
+constexpr int kPingCount = 200;
+constexpr int kPingTimeoutMs = 1000;
+constexpr char kSenderId[] = "sender";
+constexpr char kReceiverId[] = "receiver";
+constexpr char kEchoLabel[] = "echo";
+
+struct ChannelCase {
+  std::string label;
+  DataChannelOptions options;
+};
+
+std::vector<ChannelCase> BulkChannelCases() {
+  std::vector<ChannelCase> cases(3);
+  cases[0].label = "reliable-ordered";
+  cases[1].label = "reliable-unordered";
+  cases[1].options.ordered = false;
+  cases[2].label = "unreliable-unordered";
+  cases[2].options.ordered = false;
+  cases[2].options.max_retransmits = 0;
+  return cases;
+}
+
+// A loopback endpoint that measures data channels. The receiver echoes
+// messages on the echo channel and counts bytes on the others; the sender
+// records the round trip of each echo.
+class BenchEndpoint : public LoopbackEndpoint {
+ public:
+  using LoopbackEndpoint::LoopbackEndpoint;
+
+  uint64_t received_bytes(const std::string& label) const {
+    webrtc::MutexLock lock(&mutex_);
+    auto it = received_bytes_.find(label);
+    return it != received_bytes_.end() ? it->second : 0;
+  }
+  int64_t last_receive_ns() const {
+    webrtc::MutexLock lock(&mutex_);
+    return last_receive_ns_;
+  }
+  bool WaitForEcho(int64_t* rtt_ns) {
+    if (!echo_event_.Wait(webrtc::TimeDelta::Millis(kPingTimeoutMs))) {
+      return false;
+    }
+    webrtc::MutexLock lock(&mutex_);
+    *rtt_ns = last_rtt_ns_;
+    return true;
+  }
+
+  void OnDataChannelMessage(const std::string& peer_id,
+                            const std::string& label,
+                            const webrtc::CopyOnWriteBuffer& data,
+                            bool binary) override {
+    const int64_t now_ns = webrtc::TimeNanos();
+    if (label != kEchoLabel) {
+      webrtc::MutexLock lock(&mutex_);
+      received_bytes_[label] += data.size();
+      last_receive_ns_ = now_ns;
+      return;
+    }
+    if (id() == kReceiverId) {
+      // Sends the received buffer itself back; nothing is copied
+      engine().SendData(peer_id, label, data);
+      return;
+    }
+    int64_t sent_ns = 0;
+    if (data.size() == sizeof(sent_ns)) {
+      std::memcpy(&sent_ns, data.cdata(), sizeof(sent_ns));
+      {
+        webrtc::MutexLock lock(&mutex_);
+        last_rtt_ns_ = now_ns - sent_ns;
+      }
+      echo_event_.Set();
+    }
+  }
+
+ private:
+  webrtc::Event echo_event_;
+  mutable webrtc::Mutex mutex_;
+  std::map<std::string, uint64_t> received_bytes_ RTC_GUARDED_BY(mutex_);
+  int64_t last_receive_ns_ RTC_GUARDED_BY(mutex_) = 0;
+  int64_t last_rtt_ns_ RTC_GUARDED_BY(mutex_) = 0;
+};
+
+bool WaitForOpen(const BenchEndpoint& endpoint,
+                 const std::vector<std::string>& labels) {
+  const int64_t deadline_ms = webrtc::TimeMillis() + kConnectTimeoutMs;
+  for (const std::string& label : labels) {
+    while (!endpoint.is_open(label)) {
+      if (webrtc::TimeMillis() > deadline_ms) {
+        return false;
+      }
+      webrtc::Thread::SleepMs(10);
+    }
+  }
+  return true;
+}
+
+double PercentileMs(std::vector<int64_t> values_ns, int percentile) {
+  std::sort(values_ns.begin(), values_ns.end());
+  const size_t index =
+      std::min(values_ns.size() - 1, values_ns.size() * percentile / 100);
+  return values_ns[index] / 1e6;
+}
+
+bool MeasureRoundTrip(BenchEndpoint& sender) {
+  std::vector<int64_t> rtts_ns;
+  rtts_ns.reserve(kPingCount);
+  for (int i = 0; i < kPingCount; ++i) {
+    const int64_t now_ns = webrtc::TimeNanos();
+    webrtc::CopyOnWriteBuffer ping(sizeof(now_ns));
+    std::memcpy(ping.MutableData(), &now_ns, sizeof(now_ns));
+    int64_t rtt_ns = 0;
+    if (!sender.engine().SendData(kReceiverId, kEchoLabel, std::move(ping)) ||
+        !sender.WaitForEcho(&rtt_ns)) {
+      ReportBenchmarkLine("Data channel benchmark: echo " +
+                          std::to_string(i) + " was not answered");
+      return false;
+    }
+    rtts_ns.push_back(rtt_ns);
+  }
+  webrtc::StringBuilder sb;
+  sb.AppendFormat("echo round trip over %d messages: p50 %.3f ms, p95 %.3f ms,"
+                  " max %.3f ms",
+                  kPingCount, PercentileMs(rtts_ns, 50),
+                  PercentileMs(rtts_ns, 95), PercentileMs(rtts_ns, 100));
+  ReportBenchmarkLine(sb.str());
+  return true;
+}
+
+bool MeasureThroughput(BenchEndpoint& sender,
+                       const BenchEndpoint& receiver,
+                       const ChannelCase& channel_case) {
+  const std::string& label = channel_case.label;
+  // One payload for every send; each SendData only adds a reference
+  webrtc::CopyOnWriteBuffer chunk(kChunkBytes);
+  std::memset(chunk.MutableData(), 0x5a, kChunkBytes);
+
+  WebRTCEngine& engine = sender.engine();
+  const uint64_t received_before = receiver.received_bytes(label);
+  const int64_t start_ns = webrtc::TimeNanos();
+  const int64_t deadline_ms = webrtc::TimeMillis() + kDrainTimeoutMs;
+  uint64_t sent = 0;
+  while (sent < kTransferBytes) {
+    if (webrtc::TimeMillis() > deadline_ms) {
+      ReportBenchmarkLine("Data channel benchmark: " + label +
+                          " send timed out");
+      return false;
+    }
+    if (engine.GetDataChannelBufferedAmount(kReceiverId, label) >
+            kHighWatermarkBytes ||
+        !engine.SendData(kReceiverId, label, chunk)) {
+      webrtc::Thread::SleepMs(1);
+      continue;
+    }
+    sent += kChunkBytes;
+  }
+
+  // Reliable channels deliver everything; an unreliable one is done once
+  // its queue is empty and nothing has arrived for a while
+  const bool reliable = !channel_case.options.max_retransmits &&
+                        !channel_case.options.max_retransmit_time_ms;
+  uint64_t received = 0;
+  while (true) {
+    received = receiver.received_bytes(label) - received_before;
+    if (received >= sent) {
+      break;
+    }
+    const int64_t quiet_ms =
+        (webrtc::TimeNanos() - receiver.last_receive_ns()) / 1000000;
+    if (!reliable &&
+        engine.GetDataChannelBufferedAmount(kReceiverId, label) == 0 &&
+        quiet_ms > kQuietMs) {
+      break;
+    }
+    if (webrtc::TimeMillis() > deadline_ms) {
+      ReportBenchmarkLine("Data channel benchmark: " + label +
+                          " did not drain");
+      return false;
+    }
+    webrtc::Thread::SleepMs(5);
+  }
+
+  const int64_t elapsed_ns = receiver.last_receive_ns() - start_ns;
+  webrtc::StringBuilder sb;
+  sb.AppendFormat("%s: %.1f MB/s, %.1f%% of %llu MB delivered", label.c_str(),
+                  elapsed_ns > 0 ? received * 1e3 / elapsed_ns : 0.0,
+                  100.0 * received / sent,
+                  static_cast<unsigned long long>(sent >> 20));
+  ReportBenchmarkLine(sb.str());
+  return true;
+}
+
+}  // namespace
+
+int RunDataChannelBenchmark(const webrtc::Environment& env) {
+  // Both endpoints outlive the relay's Shutdown() below
+  LoopbackRelay relay("datachannel_relay");
+  BenchEndpoint sender(kSenderId, env, &relay);
+  BenchEndpoint receiver(kReceiverId, env, &relay);
+  const std::vector<ChannelCase> cases = BulkChannelCases();
+  std::vector<std::string> labels = {kEchoLabel};
+  for (const ChannelCase& channel_case : cases) {
+    labels.push_back(channel_case.label);
+  }
+
+  // Channels exist before the offer so that it carries the SCTP m-line
+  bool started = relay.Add(&sender) && relay.Add(&receiver);
+  started = started && relay.thread()->BlockingCall([&] {
+    if (!receiver.engine().CreatePeerConnection(kSenderId,
+                                                /*will_offer=*/false) ||
+        !sender.engine().CreatePeerConnection(kReceiverId) ||
+        !sender.engine().CreateDataChannel(kReceiverId, kEchoLabel)) {
+      return false;
+    }
+    for (const ChannelCase& channel_case : cases) {
+      if (!sender.engine().CreateDataChannel(kReceiverId, channel_case.label,
+                                             channel_case.options)) {
+        return false;
+      }
+    }
+    sender.engine().CreateOffer(kReceiverId);
+    return true;
+  });
+
+  int result = 0;
+  if (!started || !WaitForOpen(sender, labels) ||
+      !WaitForOpen(receiver, labels)) {
+    ReportBenchmarkLine("Data channel benchmark: channels did not open");
+    result = -1;
+  }
+  if (result == 0 && !MeasureRoundTrip(sender)) {
+    result = -1;
+  }
+  for (size_t i = 0; result == 0 && i < cases.size(); ++i) {
+    if (!MeasureThroughput(sender, receiver, cases[i])) {
+      result = -1;
+    }
+  }
+
+  relay.Shutdown();
+  return result;
+}
@@ -0,0 +1,582 @@
+#include "file_transfer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+namespace {
+
+// Every message starts with a type byte and the transfer id.
+enum MessageType : uint8_t {
+  kOffer = 1,          // Sender: file size, then the name
+  kAccept = 2,         // Receiver: offset to (re)start from
+  kData = 3,           // Sender: offset, then payload
+  kComplete = 4,       // Receiver: every byte is on disk
+  kCancelSend = 5,     // Sender gave up
+  kCancelReceive = 6,  // Receiver gave up
+};
+
+constexpr size_t kHeaderBytes = 1 + 4;
+constexpr size_t kOffsetBytes = 8;
+// Well below the 256 KiB message size WebRTC's SCTP negotiates
+constexpr size_t kChunkBytes = 64 * 1024 - kHeaderBytes - kOffsetBytes;
+constexpr uint64_t kHighWatermarkBytes = 1024 * 1024;
+constexpr uint64_t kLowWatermarkBytes = 256 * 1024;
+constexpr int64_t kProgressIntervalMs = 250;
+constexpr char kPartialSuffix[] = ".part";
+
+void PutU32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+void PutU64(uint8_t* out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t GetU32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+uint64_t GetU64(const uint8_t* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+// A message of |body_bytes| after the header, with the header filled in.
+webrtc::CopyOnWriteBuffer MakeMessage(MessageType type,
+                                      uint32_t id,
+                                      size_t body_bytes) {
+  webrtc::CopyOnWriteBuffer message(kHeaderBytes + body_bytes);
+  uint8_t* data = message.MutableData();
+  data[0] = type;
+  PutU32(data + 1, id);
+  return message;
+}
+
+webrtc::CopyOnWriteBuffer MakeOffsetMessage(MessageType type,
+                                            uint32_t id,
+                                            uint64_t offset) {
+  webrtc::CopyOnWriteBuffer message = MakeMessage(type, id, kOffsetBytes);
+  PutU64(message.MutableData() + kHeaderBytes, offset);
+  return message;
+}
+
+std::string PathToUtf8(const std::filesystem::path& path) {
+  const std::u8string text = path.u8string();
+  return std::string(text.begin(), text.end());
+}
+
+// Only the last component of a name the peer sent, so that it cannot write
+// outside the receive directory.
+std::string SanitizeFileName(const std::string& name) {
+  const size_t slash = name.find_last_of("/\\");
+  std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+  base.erase(std::remove_if(base.begin(), base.end(),
+                            [](char c) {
+                              return c == ':' ||
+                                     static_cast<unsigned char>(c) < 0x20;
+                            }),
+             base.end());
+  if (base.empty() || base == "." || base == "..") {
+    base = "received";
+  }
+  return base;
+}
+
+// |directory|/|name|, or "name (n).ext" if that or its partial file exists.
+std::filesystem::path UniquePath(const std::filesystem::path& directory,
+                                 const std::string& name) {
+  const std::filesystem::path wanted = directory / PathFromUtf8(name);
+  auto taken = [](const std::filesystem::path& path) {
+    std::error_code error;
+    std::filesystem::path partial = path;
+    partial += kPartialSuffix;
+    return std::filesystem::exists(path, error) ||
+           std::filesystem::exists(partial, error);
+  };
+  if (!taken(wanted)) {
+    return wanted;
+  }
+  const std::filesystem::path stem = wanted.stem();
+  const std::filesystem::path extension = wanted.extension();
+  for (int n = 1;; ++n) {
+    std::filesystem::path candidate = directory / stem;
+    candidate += " (" + std::to_string(n) + ")";
+    candidate += extension;
+    if (!taken(candidate)) {
+      return candidate;
+    }
+  }
+}
+
+bool IsFinished(FileTransferState state) {
+  return state == FileTransferState::kCompleted ||
+         state == FileTransferState::kFailed ||
+         state == FileTransferState::kCancelled;
+}
+
+}  // namespace
+
+std::filesystem::path PathFromUtf8(const std::string& text) {
+  return std::filesystem::path(std::u8string(text.begin(), text.end()));
+}
+
+FileTransferManager::FileTransferManager(
+    std::unique_ptr<FileTransferTransport> transport,
+    FileTransferObserver* observer,
+    std::filesystem::path receive_directory)
+    : transport_(std::move(transport)),
+      observer_(observer),
+      receive_directory_(std::move(receive_directory)),
+      thread_(webrtc::Thread::Create()) {
+  thread_->SetName("file_transfer", nullptr);
+  thread_->Start();
+}
+
+FileTransferManager::~FileTransferManager() {
+  thread_->BlockingCall([this] {
+    for (auto& [id, transfer] : outgoing_) {
+      if (!IsFinished(transfer.progress.state)) {
+        FailOutgoing(transfer, "call ended");
+      }
+    }
+    for (auto& [id, transfer] : incoming_) {
+      if (!IsFinished(transfer.progress.state)) {
+        FailIncoming(transfer, "call ended");
+      }
+    }
+  });
+  thread_->Stop();
+}
+
+uint32_t FileTransferManager::SendFile(const std::filesystem::path& path) {
+  const uint32_t id = next_id_.fetch_add(1);
+  thread_->PostTask([this, id, path] { StartSending(id, path); });
+  return id;
+}
+
+void FileTransferManager::Cancel(uint32_t id, bool outgoing) {
+  thread_->PostTask([this, id, outgoing] {
+    CancelTransfer(id, outgoing, /*notify_peer=*/true);
+  });
+}
+
+void FileTransferManager::OnChannelOpen() {
+  thread_->PostTask([this] {
+    if (channel_open_) {
+      return;
+    }
+    channel_open_ = true;
+    // The receiver answers each offer with the bytes it already has
+    for (auto& [id, transfer] : outgoing_) {
+      if (!IsFinished(transfer.progress.state)) {
+        SendOffer(id, transfer);
+      }
+    }
+  });
+}
+
+void FileTransferManager::OnChannelClosed() {
+  thread_->PostTask([this] {
+    channel_open_ = false;
+    for (auto& [id, transfer] : outgoing_) {
+      if (!IsFinished(transfer.progress.state)) {
+        transfer.progress.state = FileTransferState::kPaused;
+        Report(transfer, /*force=*/true);
+      }
+    }
+    for (auto& [id, transfer] : incoming_) {
+      if (!IsFinished(transfer.progress.state)) {
+        transfer.progress.state = FileTransferState::kPaused;
+        transfer.file.flush();
+        Report(transfer, /*force=*/true);
+      }
+    }
+  });
+}
+
+void FileTransferManager::OnMessage(const webrtc::CopyOnWriteBuffer& message) {
+  // Shares the buffer; the payload is written to disk straight from it
+  thread_->PostTask([this, message] { HandleMessage(message); });
+}
+
+void FileTransferManager::OnBufferedAmountChange() {
+  if (transport_->BufferedAmount() > kLowWatermarkBytes ||
+      pump_scheduled_.exchange(true)) {
+    return;
+  }
+  thread_->PostTask([this] { Pump(); });
+}
+
+void FileTransferManager::StartSending(uint32_t id,
+                                       const std::filesystem::path& path) {
+  Outgoing& transfer = outgoing_[id];
+  transfer.progress.id = id;
+  transfer.progress.outgoing = true;
+  transfer.progress.name = PathToUtf8(path.filename());
+
+  std::error_code error;
+  const uintmax_t size = std::filesystem::file_size(path, error);
+  transfer.file.open(path, std::ios::binary);
+  if (error || !transfer.file) {
+    FailOutgoing(transfer, "cannot open " + PathToUtf8(path));
+    return;
+  }
+  transfer.progress.size = size;
+  transfer.progress.state = FileTransferState::kWaiting;
+  if (channel_open_) {
+    SendOffer(id, transfer);
+  } else {
+    Report(transfer, /*force=*/true);
+  }
+}
+
+void FileTransferManager::SendOffer(uint32_t id, Outgoing& transfer) {
+  const std::string& name = transfer.progress.name;
+  webrtc::CopyOnWriteBuffer message =
+      MakeMessage(kOffer, id, kOffsetBytes + name.size());
+  uint8_t* body = message.MutableData() + kHeaderBytes;
+  PutU64(body, transfer.progress.size);
+  std::memcpy(body + kOffsetBytes, name.data(), name.size());
+  // Stays paused if this fails; the next open offers it again
+  if (transport_->Send(std::move(message))) {
+    transfer.progress.state = FileTransferState::kWaiting;
+  }
+  Report(transfer, /*force=*/true);
+}
+
+void FileTransferManager::HandleMessage(
+    const webrtc::CopyOnWriteBuffer& message) {
+  if (message.size() < kHeaderBytes) {
+    RTC_LOG(LS_WARNING) << "File transfer message too short: "
+                        << message.size();
+    return;
+  }
+  const uint8_t* data = message.cdata();
+  const uint8_t type = data[0];
+  const uint32_t id = GetU32(data + 1);
+  const uint8_t* body = data + kHeaderBytes;
+  const size_t body_size = message.size() - kHeaderBytes;
+  const bool has_offset = body_size >= kOffsetBytes;
+
+  switch (type) {
+    case kOffer:
+      if (has_offset) {
+        HandleOffer(id, GetU64(body),
+                    std::string(reinterpret_cast<const char*>(body) +
+                                    kOffsetBytes,
+                                body_size - kOffsetBytes));
+        return;
+      }
+      break;
+    case kAccept:
+      if (has_offset) {
+        HandleAccept(id, GetU64(body));
+        return;
+      }
+      break;
+    case kData:
+      if (has_offset) {
+        HandleData(id, GetU64(body), body + kOffsetBytes,
+                   body_size - kOffsetBytes);
+        return;
+      }
+      break;
+    case kComplete:
+      HandleComplete(id);
+      return;
+    case kCancelSend:
+      CancelTransfer(id, /*outgoing=*/false, /*notify_peer=*/false);
+      return;
+    case kCancelReceive:
+      CancelTransfer(id, /*outgoing=*/true, /*notify_peer=*/false);
+      return;
+  }
+  RTC_LOG(LS_WARNING) << "Malformed file transfer message, type "
+                      << static_cast<int>(type);
+}
+
+void FileTransferManager::HandleOffer(uint32_t id,
+                                      uint64_t size,
+                                      const std::string& name) {
+  auto it = incoming_.find(id);
+  if (it != incoming_.end()) {
+    Incoming& transfer = it->second;
+    if (IsFinished(transfer.progress.state)) {
+      // Completed before the channel closed; the sender missed kComplete
+      if (transfer.progress.state == FileTransferState::kCompleted) {
+        transport_->Send(MakeMessage(kComplete, id, 0));
+      } else {
+        transport_->Send(MakeMessage(kCancelReceive, id, 0));
+      }
+      return;
+    }
+    if (transfer.progress.size == size) {
+      transfer.progress.state = FileTransferState::kActive;
+      Report(transfer, /*force=*/true);
+      transport_->Send(
+          MakeOffsetMessage(kAccept, id, transfer.progress.transferred));
+      return;
+    }
+    // Same id, different file: the sender restarted; start over
+    FailIncoming(transfer, "file changed");
+    incoming_.erase(it);
+  }
+
+  Incoming& transfer = incoming_[id];
+  transfer.progress.id = id;
+  transfer.progress.outgoing = false;
+  transfer.progress.name = SanitizeFileName(name);
+  transfer.progress.size = size;
+
+  std::error_code error;
+  std::filesystem::create_directories(receive_directory_, error);
+  transfer.path = UniquePath(receive_directory_, transfer.progress.name);
+  transfer.partial_path = transfer.path;
+  transfer.partial_path += kPartialSuffix;
+  transfer.file.open(transfer.partial_path,
+                     std::ios::binary | std::ios::trunc);
+  if (!transfer.file) {
+    FailIncoming(transfer, "cannot write " + PathToUtf8(transfer.partial_path));
+    transport_->Send(MakeMessage(kCancelReceive, id, 0));
+    return;
+  }
+
+  transfer.progress.state = FileTransferState::kActive;
+  transfer.start_ms = webrtc::TimeMillis();
+  Report(transfer, /*force=*/true);
+  transport_->Send(MakeOffsetMessage(kAccept, id, 0));
+  if (size == 0) {
+    FinishIncoming(id, transfer);
+  }
+}
+
+void FileTransferManager::HandleAccept(uint32_t id, uint64_t offset) {
+  auto it = outgoing_.find(id);
+  if (it == outgoing_.end() || IsFinished(it->second.progress.state)) {
+    return;
+  }
+  Outgoing& transfer = it->second;
+  if (offset > transfer.progress.size) {
+    FailOutgoing(transfer, "receiver reported a bad offset");
+    transport_->Send(MakeMessage(kCancelSend, id, 0));
+    return;
+  }
+  transfer.next_offset = offset;
+  transfer.progress.transferred = offset;
+  transfer.progress.state = FileTransferState::kActive;
+  if (transfer.start_ms == 0) {
+    transfer.start_ms = webrtc::TimeMillis();
+  }
+  Report(transfer, /*force=*/true);
+  Pump();
+}
+
+void FileTransferManager::HandleData(uint32_t id,
+                                     uint64_t offset,
+                                     const uint8_t* data,
+                                     size_t size) {
+  auto it = incoming_.find(id);
+  if (it == incoming_.end() ||
+      it->second.progress.state != FileTransferState::kActive) {
+    return;
+  }
+  Incoming& transfer = it->second;
+  // Chunks queued before a pause can arrive after the resume point
+  if (offset != transfer.progress.transferred ||
+      offset + size > transfer.progress.size) {
+    RTC_LOG(LS_VERBOSE) << "Dropping file chunk at " << offset << ", expected "
+                        << transfer.progress.transferred;
+    return;
+  }
+  transfer.file.write(reinterpret_cast<const char*>(data),
+                      static_cast<std::streamsize>(size));
+  if (!transfer.file) {
+    FailIncoming(transfer, "write failed");
+    transport_->Send(MakeMessage(kCancelReceive, id, 0));
+    return;
+  }
+  transfer.progress.transferred += size;
+  if (transfer.progress.transferred == transfer.progress.size) {
+    FinishIncoming(id, transfer);
+  } else {
+    Report(transfer, /*force=*/false);
+  }
+}
+
+void FileTransferManager::HandleComplete(uint32_t id) {
+  auto it = outgoing_.find(id);
+  if (it == outgoing_.end() || IsFinished(it->second.progress.state)) {
+    return;
+  }
+  Outgoing& transfer = it->second;
+  transfer.file.close();
+  transfer.progress.transferred = transfer.progress.size;
+  transfer.progress.state = FileTransferState::kCompleted;
+  Report(transfer, /*force=*/true);
+}
+
+void FileTransferManager::FinishIncoming(uint32_t id, Incoming& transfer) {
+  transfer.file.close();
+  std::error_code error;
+  std::filesystem::rename(transfer.partial_path, transfer.path, error);
+  if (error) {
+    FailIncoming(transfer, "rename failed: " + error.message());
+    transport_->Send(MakeMessage(kCancelReceive, id, 0));
+    return;
+  }
+  transfer.progress.state = FileTransferState::kCompleted;
+  Report(transfer, /*force=*/true);
+  transport_->Send(MakeMessage(kComplete, id, 0));
+}
+
+void FileTransferManager::CancelTransfer(uint32_t id,
+                                         bool outgoing,
+                                         bool notify_peer) {
+  Transfer* transfer = nullptr;
+  if (outgoing) {
+    auto it = outgoing_.find(id);
+    if (it == outgoing_.end() || IsFinished(it->second.progress.state)) {
+      return;
+    }
+    it->second.file.close();
+    transfer = &it->second;
+  } else {
+    auto it = incoming_.find(id);
+    if (it == incoming_.end() || IsFinished(it->second.progress.state)) {
+      return;
+    }
+    it->second.file.close();
+    std::error_code error;
+    std::filesystem::remove(it->second.partial_path, error);
+    transfer = &it->second;
+  }
+  if (notify_peer) {
+    transport_->Send(
+        MakeMessage(outgoing ? kCancelSend : kCancelReceive, id, 0));
+  } else {
+    transfer->progress.error = "cancelled by peer";
+  }
+  transfer->progress.state = FileTransferState::kCancelled;
+  Report(*transfer, /*force=*/true);
+}
+
+void FileTransferManager::FailOutgoing(Outgoing& transfer,
+                                       const std::string& error) {
+  RTC_LOG(LS_WARNING) << "Sending " << transfer.progress.name
+                      << " failed: " << error;
+  transfer.file.close();
+  transfer.progress.state = FileTransferState::kFailed;
+  transfer.progress.error = error;
+  Report(transfer, /*force=*/true);
+}
+
+void FileTransferManager::FailIncoming(Incoming& transfer,
+                                       const std::string& error) {
+  RTC_LOG(LS_WARNING) << "Receiving " << transfer.progress.name
+                      << " failed: " << error;
+  // The partial file stays for inspection
+  transfer.file.close();
+  transfer.progress.state = FileTransferState::kFailed;
+  transfer.progress.error = error;
+  Report(transfer, /*force=*/true);
+}
+
+void FileTransferManager::Pump() {
+  pump_scheduled_ = false;
+  while (channel_open_ && transport_->BufferedAmount() < kHighWatermarkBytes) {
+    uint32_t id = 0;
+    Outgoing* transfer = NextToSend(&id);
+    if (!transfer) {
+      return;
+    }
+
+    // Read straight into the message that goes to the channel
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(
+        kChunkBytes, transfer->progress.size - transfer->next_offset));
+    webrtc::CopyOnWriteBuffer message =
+        MakeMessage(kData, id, kOffsetBytes + size);
+    uint8_t* body = message.MutableData() + kHeaderBytes;
+    PutU64(body, transfer->next_offset);
+    transfer->file.seekg(static_cast<std::streamoff>(transfer->next_offset));
+    transfer->file.read(reinterpret_cast<char*>(body + kOffsetBytes),
+                        static_cast<std::streamsize>(size));
+    if (transfer->file.gcount() != static_cast<std::streamsize>(size)) {
+      FailOutgoing(*transfer, "read failed");
+      transport_->Send(MakeMessage(kCancelSend, id, 0));
+      continue;
+    }
+
+    // Refused when the channel closed or is full; the next open or
+    // buffered amount change picks it up again
+    if (!transport_->Send(std::move(message))) {
+      return;
+    }
+    transfer->next_offset += size;
+    transfer->progress.transferred = transfer->next_offset;
+    Report(*transfer, /*force=*/false);
+  }
+}
+
+FileTransferManager::Outgoing* FileTransferManager::NextToSend(uint32_t* id) {
+  auto has_data = [](const Outgoing& transfer) {
+    return transfer.progress.state == FileTransferState::kActive &&
+           transfer.next_offset < transfer.progress.size;
+  };
+  // First eligible transfer after the one served last, wrapping around
+  auto it = outgoing_.upper_bound(last_sent_id_);
+  for (size_t i = 0; i < outgoing_.size(); ++i, ++it) {
+    if (it == outgoing_.end()) {
+      it = outgoing_.begin();
+    }
+    if (has_data(it->second)) {
+      last_sent_id_ = it->first;
+      *id = it->first;
+      return &it->second;
+    }
+  }
+  return nullptr;
+}
+
+void FileTransferManager::Report(Transfer& transfer, bool force) {
+  const int64_t now_ms = webrtc::TimeMillis();
+  const int64_t elapsed_ms = now_ms - transfer.last_report_ms;
+  if (!force && elapsed_ms < kProgressIntervalMs) {
+    return;
+  }
+
+  FileTransferProgress& progress = transfer.progress;
+  if (progress.state == FileTransferState::kCompleted && transfer.start_ms > 0) {
+    const int64_t total_ms = std::max<int64_t>(1, now_ms - transfer.start_ms);
+    progress.bytes_per_second = progress.transferred * 1000.0 / total_ms;
+  } else if (progress.state != FileTransferState::kActive) {
+    progress.bytes_per_second = 0.0;
+  } else if (transfer.last_report_ms > 0 && elapsed_ms > 0 &&
+             progress.transferred >= transfer.last_report_bytes) {
+    progress.bytes_per_second =
+        (progress.transferred - transfer.last_report_bytes) * 1000.0 /
+        elapsed_ms;
+  }
+  transfer.last_report_ms = now_ms;
+  transfer.last_report_bytes = progress.transferred;
+
+  if (observer_) {
+    observer_->OnFileTransferProgress(progress);
+  }
+}
@@ -0,0 +1,614 @@
+#include "frame_converter.h"
+
+#include <algorithm>
+
+#include "api/scoped_refptr.h"
+#include "api/video/i010_buffer.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/i422_buffer.h"
+#include "api/video/i444_buffer.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video/video_rotation.h"
+#include "rtc_base/logging.h"
+#include "third_party/libyuv/include/libyuv/convert.h"
+#include "third_party/libyuv/include/libyuv/convert_argb.h"
+#include "third_party/libyuv/include/libyuv/rotate.h"
+#include "third_party/libyuv/include/libyuv/scale.h"
+#include "third_party/libyuv/include/libyuv/scale_argb.h"
+
+namespace {
+
+// Two buffers per pool are enough: one being written, one possibly still
+// referenced by the previous conversion. Each pool only ever sees one size
+// and layout in steady state, so it never reallocates.
+constexpr size_t kMaxPooledBuffers = 2;
+
+// Below this output size the thread hand-off costs more than it saves.
+constexpr int kMinPixelsForStripes = 1280 * 720;
+// Keep each stripe tall enough to amortise the row setup in libyuv.
+constexpr int kMinRowsPerStripe = 64;
+
+// Native buffers (e.g. from a hardware decoder or capturer) can often be
+// mapped to a CPU layout directly, which avoids the ToI420() copy.
+webrtc::scoped_refptr<webrtc::VideoFrameBuffer> MapNativeBuffer(
+    webrtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer) {
+  if (buffer && buffer->type() == webrtc::VideoFrameBuffer::Type::kNative) {
+    webrtc::VideoFrameBuffer::Type mappable_types[] = {
+        webrtc::VideoFrameBuffer::Type::kI420,
+        webrtc::VideoFrameBuffer::Type::kNV12,
+    };
+    webrtc::scoped_refptr<webrtc::VideoFrameBuffer> mapped =
+        buffer->GetMappedFrameBuffer(mappable_types);
+    if (mapped) {
+      return mapped;
+    }
+  }
+  return buffer;
+}
+
+// Rounds |rect| outwards to even coordinates within a |width| x |height|
+// picture, so 4:2:0 chroma samples are never split.
+webrtc::VideoFrame::UpdateRect AlignRectToEven(
+    const webrtc::VideoFrame::UpdateRect& rect,
+    int width,
+    int height) {
+  webrtc::VideoFrame::UpdateRect aligned;
+  aligned.offset_x = std::max(0, rect.offset_x) & ~1;
+  aligned.offset_y = std::max(0, rect.offset_y) & ~1;
+  aligned.width =
+      std::min(width, (rect.offset_x + rect.width + 1) & ~1) - aligned.offset_x;
+  aligned.height =
+      std::min(height, (rect.offset_y + rect.height + 1) & ~1) -
+      aligned.offset_y;
+  return aligned;
+}
+
+// Output pixels of a |from_width| x |from_height| to |to_width| x
+// |to_height| scale that read from |rect|. The rect is widened by one
+// source pixel on each side for the filter taps, then mapped outwards.
+webrtc::VideoFrame::UpdateRect MapRectThroughScale(
+    const webrtc::VideoFrame::UpdateRect& rect,
+    int from_width,
+    int from_height,
+    int to_width,
+    int to_height) {
+  const int64_t left = std::max(0, rect.offset_x - 1);
+  const int64_t top = std::max(0, rect.offset_y - 1);
+  const int64_t right = std::min(from_width, rect.offset_x + rect.width + 1);
+  const int64_t bottom =
+      std::min(from_height, rect.offset_y + rect.height + 1);
+
+  webrtc::VideoFrame::UpdateRect mapped;
+  mapped.offset_x = static_cast<int>(left * to_width / from_width);
+  mapped.offset_y = static_cast<int>(top * to_height / from_height);
+  mapped.width = static_cast<int>((right * to_width + from_width - 1) /
+                                  from_width) -
+                 mapped.offset_x;
+  mapped.height = static_cast<int>((bottom * to_height + from_height - 1) /
+                                   from_height) -
+                  mapped.offset_y;
+  return mapped;
+}
+
+// Converts |rect| of an I420 or NV12 |buffer| into the same position of
+// |dst_argb|, which has the buffer's size. |rect| must be even-aligned.
+void ConvertRectToArgb(const webrtc::VideoFrameBuffer& buffer,
+                       const webrtc::VideoFrame::UpdateRect& rect,
+                       uint8_t* dst_argb,
+                       int dst_stride) {
+  uint8_t* dst = dst_argb + rect.offset_y * dst_stride + rect.offset_x * 4;
+
+  if (buffer.type() == webrtc::VideoFrameBuffer::Type::kNV12) {
+    const webrtc::NV12BufferInterface* src = buffer.GetNV12();
+    libyuv::NV12ToARGB(
+        src->DataY() + rect.offset_y * src->StrideY() + rect.offset_x,
+        src->StrideY(),
+        src->DataUV() + (rect.offset_y / 2) * src->StrideUV() + rect.offset_x,
+        src->StrideUV(), dst, dst_stride, rect.width, rect.height);
+    return;
+  }
+
+  const webrtc::I420BufferInterface* src = buffer.GetI420();
+  libyuv::I420ToARGB(
+      src->DataY() + rect.offset_y * src->StrideY() + rect.offset_x,
+      src->StrideY(),
+      src->DataU() + (rect.offset_y / 2) * src->StrideU() + rect.offset_x / 2,
+      src->StrideU(),
+      src->DataV() + (rect.offset_y / 2) * src->StrideV() + rect.offset_x / 2,
+      src->StrideV(), dst, dst_stride, rect.width, rect.height);
+}
+
+bool IsTransposed(webrtc::VideoRotation rotation) {
+  return rotation == webrtc::kVideoRotation_90 ||
+         rotation == webrtc::kVideoRotation_270;
+}
+
+libyuv::RotationMode ToLibyuvRotation(webrtc::VideoRotation rotation) {
+  switch (rotation) {
+    case webrtc::kVideoRotation_90:
+      return libyuv::kRotate90;
+    case webrtc::kVideoRotation_180:
+      return libyuv::kRotate180;
+    case webrtc::kVideoRotation_270:
+      return libyuv::kRotate270;
+    case webrtc::kVideoRotation_0:
+    default:
+      return libyuv::kRotate0;
+  }
+}
+
+}  // namespace
+
+FrameConverter::FrameConverter()
+    : scale_pool_(/*zero_initialize=*/false, kMaxPooledBuffers),
+      rotate_pool_(/*zero_initialize=*/false, kMaxPooledBuffers) {}
+
+FrameConverter::~FrameConverter() = default;
+
+void FrameConverter::SetWorkerThreads(int num_threads) {
+  if (num_threads <= 0) {
+    workers_.reset();
+    return;
+  }
+  if (workers_ && workers_->num_workers() == num_threads) {
+    return;
+  }
+  workers_ = std::make_unique<SliceWorkerPool>(num_threads);
+}
+
+void FrameConverter::ForEachStripe(
+    int width,
+    int height,
+    webrtc::FunctionView<void(int first_row, int num_rows)> convert) {
+  int stripes = 1;
+  if (workers_ && width * height >= kMinPixelsForStripes) {
+    stripes = std::min(workers_->num_workers() + 1,
+                       height / kMinRowsPerStripe);
+  }
+  if (stripes <= 1) {
+    convert(0, height);
+    return;
+  }
+
+  // Even stripe heights, so a 4:2:0 chroma row is never split
+  const int rows_per_stripe = ((height + stripes - 1) / stripes + 1) & ~1;
+  workers_->ParallelFor(stripes, [&](int stripe) {
+    const int first_row = stripe * rows_per_stripe;
+    if (first_row < height) {
+      convert(first_row, std::min(rows_per_stripe, height - first_row));
+    }
+  });
+}
+
+int FrameConverter::RotatedWidth(const webrtc::VideoFrame& frame) {
+  return IsTransposed(frame.rotation()) ? frame.height() : frame.width();
+}
+
+int FrameConverter::RotatedHeight(const webrtc::VideoFrame& frame) {
+  return IsTransposed(frame.rotation()) ? frame.width() : frame.height();
+}
+
+bool FrameConverter::ConvertToArgb(const webrtc::VideoFrame& frame,
+                                   uint8_t* dst_argb,
+                                   int dst_stride,
+                                   int dst_width,
+                                   int dst_height) {
+  if (!dst_argb || dst_width <= 0 || dst_height <= 0) {
+    return false;
+  }
+  // The output no longer comes from the source-resolution copy
+  source_argb_valid_ = false;
+
+  webrtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer =
+      MapNativeBuffer(frame.video_frame_buffer());
+  if (!buffer) {
+    return false;
+  }
+
+  if (frame.rotation() != webrtc::kVideoRotation_0) {
+    return ConvertRotated(buffer, frame.rotation(), dst_argb, dst_stride,
+                          dst_width, dst_height);
+  }
+
+  switch (buffer->type()) {
+    case webrtc::VideoFrameBuffer::Type::kI420:
+    case webrtc::VideoFrameBuffer::Type::kI420A:
+      return ConvertI420(*buffer->GetI420(), dst_argb, dst_stride, dst_width,
+                         dst_height);
+    case webrtc::VideoFrameBuffer::Type::kNV12:
+      return ConvertNV12(*buffer->GetNV12(), dst_argb, dst_stride, dst_width,
+                         dst_height);
+    case webrtc::VideoFrameBuffer::Type::kI422:
+      return ConvertI422(*buffer->GetI422(), dst_argb, dst_stride, dst_width,
+                         dst_height);
+    case webrtc::VideoFrameBuffer::Type::kI444:
+      return ConvertI444(*buffer->GetI444(), dst_argb, dst_stride, dst_width,
+                         dst_height);
+    case webrtc::VideoFrameBuffer::Type::kI010:
+      return ConvertI010(*buffer->GetI010(), dst_argb, dst_stride, dst_width,
+                         dst_height);
+    default:
+      break;
+  }
+
+  // Everything else goes through an intermediate I420 copy
+  webrtc::scoped_refptr<webrtc::I420BufferInterface> i420 = buffer->ToI420();
+  if (!i420) {
+    return false;
+  }
+  return ConvertI420(*i420, dst_argb, dst_stride, dst_width, dst_height);
+}
+
+bool FrameConverter::ConvertRegionToArgb(
+    const webrtc::VideoFrame& frame,
+    const webrtc::VideoFrame::UpdateRect& region,
+    uint8_t* dst_argb,
+    int dst_stride,
+    int dst_width,
+    int dst_height) {
+  if (!dst_argb || dst_width <= 0 || dst_height <= 0 ||
+      frame.rotation() != webrtc::kVideoRotation_0) {
+    return false;
+  }
+
+  webrtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer =
+      MapNativeBuffer(frame.video_frame_buffer());
+  if (!buffer || (buffer->type() != webrtc::VideoFrameBuffer::Type::kI420 &&
+                  buffer->type() != webrtc::VideoFrameBuffer::Type::kI420A &&
+                  buffer->type() != webrtc::VideoFrameBuffer::Type::kNV12)) {
+    return false;
+  }
+  if (region.IsEmpty()) {
+    return true;
+  }
+
+  const int src_width = buffer->width();
+  const int src_height = buffer->height();
+  const webrtc::VideoFrame::UpdateRect src_rect =
+      AlignRectToEven(region, src_width, src_height);
+  if (src_rect.width <= 0 || src_rect.height <= 0) {
+    return true;
+  }
+
+  if (src_width == dst_width && src_height == dst_height) {
+    source_argb_valid_ = false;
+    ConvertRectToArgb(*buffer, src_rect, dst_argb, dst_stride);
+    return true;
+  }
+
+  // A patch scaled on its own would not line up with the pixels around it
+  // (different filter origin and ratio). Instead the region goes into the
+  // source-resolution copy, and the output pixels it reaches are redone by
+  // a scale of the whole copy clipped to them.
+  const int src_stride = src_width * 4;
+  if (!source_argb_valid_ || source_width_ != src_width ||
+      source_height_ != src_height || scaled_width_ != dst_width ||
+      scaled_height_ != dst_height) {
+    source_argb_.resize(static_cast<size_t>(src_stride) * src_height);
+    const bool converted =
+        buffer->type() == webrtc::VideoFrameBuffer::Type::kNV12
+            ? ConvertNV12(*buffer->GetNV12(), source_argb_.data(), src_stride,
+                          src_width, src_height)
+            : ConvertI420(*buffer->GetI420(), source_argb_.data(), src_stride,
+                          src_width, src_height);
+    if (!converted) {
+      source_argb_valid_ = false;
+      return false;
+    }
+    source_width_ = src_width;
+    source_height_ = src_height;
+    scaled_width_ = dst_width;
+    scaled_height_ = dst_height;
+    source_argb_valid_ = true;
+
+    // A fresh copy rescales the whole output, so the pixels around later
+    // patches come from the same ARGB scale as the patches themselves
+    ForEachStripe(dst_width, dst_height, [&](int row, int rows) {
+      libyuv::ARGBScaleClip(source_argb_.data(), src_stride, src_width,
+                            src_height, dst_argb, dst_stride, dst_width,
+                            dst_height, 0, row, dst_width, rows,
+                            libyuv::kFilterBox);
+    });
+    return true;
+  }
+
+  ConvertRectToArgb(*buffer, src_rect, source_argb_.data(), src_stride);
+  const webrtc::VideoFrame::UpdateRect dst_rect = MapRectThroughScale(
+      src_rect, src_width, src_height, dst_width, dst_height);
+  libyuv::ARGBScaleClip(source_argb_.data(), src_stride, src_width,
+                        src_height, dst_argb, dst_stride, dst_width,
+                        dst_height, dst_rect.offset_x, dst_rect.offset_y,
+                        dst_rect.width, dst_rect.height, libyuv::kFilterBox);
+  return true;
+}
+
+bool FrameConverter::ConvertRotated(
+    const webrtc::scoped_refptr<webrtc::VideoFrameBuffer>& buffer,
+    webrtc::VideoRotation rotation,
+    uint8_t* dst_argb,
+    int dst_stride,
+    int dst_width,
+    int dst_height) {
+  // Scale first, in the source orientation, so the rotation pass runs at
+  // the output size. Both steps write into pooled buffers, so steady-state
+  // rotated playback does not allocate.
+  const int scaled_width = IsTransposed(rotation) ? dst_height : dst_width;
+  const int scaled_height = IsTransposed(rotation) ? dst_width : dst_height;
+
+  webrtc::scoped_refptr<webrtc::I420Buffer> rotated =
+      rotate_pool_.CreateI420Buffer(dst_width, dst_height);
+  if (!rotated) {
+    RTC_LOG(LS_WARNING) << "FrameConverter: rotate buffer pool exhausted";
+    return false;
+  }
+
+  if (buffer->type() == webrtc::VideoFrameBuffer::Type::kNV12) {
+    // NV12 is de-interleaved and rotated in a single pass
+    webrtc::scoped_refptr<webrtc::NV12Buffer> scaled_holder;
+    const webrtc::NV12BufferInterface* src = ScaleNV12(
+        *buffer->GetNV12(), scaled_width, scaled_height, &scaled_holder);
+    if (!src) {
+      return false;
+    }
+    libyuv::NV12ToI420Rotate(src->DataY(), src->StrideY(),
+                             src->DataUV(), src->StrideUV(),
+                             rotated->MutableDataY(), rotated->StrideY(),
+                             rotated->MutableDataU(), rotated->StrideU(),
+                             rotated->MutableDataV(), rotated->StrideV(),
+                             src->width(), src->height(),
+                             ToLibyuvRotation(rotation));
+  } else {
+    webrtc::scoped_refptr<webrtc::I420BufferInterface> i420_holder;
+    const webrtc::I420BufferInterface* i420 = nullptr;
+    if (buffer->type() == webrtc::VideoFrameBuffer::Type::kI420 ||
+        buffer->type() == webrtc::VideoFrameBuffer::Type::kI420A) {
+      i420 = buffer->GetI420();
+    } else {
+      // Other layouts still need an intermediate I420 copy
+      i420_holder = buffer->ToI420();
+      i420 = i420_holder.get();
+    }
+    if (!i420) {
+      return false;
+    }
+
+    webrtc::scoped_refptr<webrtc::I420Buffer> scaled_holder;
+    const webrtc::I420BufferInterface* src =
+        ScaleI420(*i420, scaled_width, scaled_height, &scaled_holder);
+    if (!src) {
+      return false;
+    }
+    libyuv::I420Rotate(src->DataY(), src->StrideY(),
+                       src->DataU(), src->StrideU(),
+                       src->DataV(), src->StrideV(),
+                       rotated->MutableDataY(), rotated->StrideY(),
+                       rotated->MutableDataU(), rotated->StrideU(),
+                       rotated->MutableDataV(), rotated->StrideV(),
+                       src->width(), src->height(),
+                       ToLibyuvRotation(rotation));
+  }
+
+  I420ToArgbStriped(*rotated, dst_argb, dst_stride);
+  return true;
+}
+
+const webrtc::I420BufferInterface* FrameConverter::ScaleI420(
+    const webrtc::I420BufferInterface& src,
+    int width,
+    int height,
+    webrtc::scoped_refptr<webrtc::I420Buffer>* holder) {
+  if (src.width() == width && src.height() == height) {
+    return &src;
+  }
+
+  // Scale in YUV space so the colour conversion only touches output pixels
+  *holder = scale_pool_.CreateI420Buffer(width, height);
+  if (!*holder) {
+    RTC_LOG(LS_WARNING) << "FrameConverter: scale buffer pool exhausted";
+    return nullptr;
+  }
+  webrtc::I420Buffer* scaled = holder->get();
+  libyuv::I420Scale(src.DataY(), src.StrideY(),
+                    src.DataU(), src.StrideU(),
+                    src.DataV(), src.StrideV(),
+                    src.width(), src.height(),
+                    scaled->MutableDataY(), scaled->StrideY(),
+                    scaled->MutableDataU(), scaled->StrideU(),
+                    scaled->MutableDataV(), scaled->StrideV(),
+                    width, height, libyuv::kFilterBox);
+  return scaled;
+}
+
+const webrtc::NV12BufferInterface* FrameConverter::ScaleNV12(
+    const webrtc::NV12BufferInterface& src,
+    int width,
+    int height,
+    webrtc::scoped_refptr<webrtc::NV12Buffer>* holder) {
+  if (src.width() == width && src.height() == height) {
+    return &src;
+  }
+
+  *holder = scale_pool_.CreateNV12Buffer(width, height);
+  if (!*holder) {
+    RTC_LOG(LS_WARNING) << "FrameConverter: scale buffer pool exhausted";
+    return nullptr;
+  }
+  webrtc::NV12Buffer* scaled = holder->get();
+  libyuv::NV12Scale(src.DataY(), src.StrideY(),
+                    src.DataUV(), src.StrideUV(),
+                    src.width(), src.height(),
+                    scaled->MutableDataY(), scaled->StrideY(),
+                    scaled->MutableDataUV(), scaled->StrideUV(),
+                    width, height, libyuv::kFilterBox);
+  return scaled;
+}
+
+bool FrameConverter::ConvertI420(const webrtc::I420BufferInterface& src,
+                                 uint8_t* dst_argb,
+                                 int dst_stride,
+                                 int dst_width,
+                                 int dst_height) {
+  webrtc::scoped_refptr<webrtc::I420Buffer> scaled_holder;
+  const webrtc::I420BufferInterface* buffer =
+      ScaleI420(src, dst_width, dst_height, &scaled_holder);
+  if (!buffer) {
+    return false;
+  }
+
+  I420ToArgbStriped(*buffer, dst_argb, dst_stride);
+  return true;
+}
+
+bool FrameConverter::ConvertNV12(const webrtc::NV12BufferInterface& src,
+                                 uint8_t* dst_argb,
+                                 int dst_stride,
+                                 int dst_width,
+                                 int dst_height) {
+  webrtc::scoped_refptr<webrtc::NV12Buffer> scaled_holder;
+  const webrtc::NV12BufferInterface* buffer =
+      ScaleNV12(src, dst_width, dst_height, &scaled_holder);
+  if (!buffer) {
+    return false;
+  }
+
+  ForEachStripe(dst_width, dst_height, [&](int row, int rows) {
+    libyuv::NV12ToARGB(buffer->DataY() + row * buffer->StrideY(),
+                       buffer->StrideY(),
+                       buffer->DataUV() + (row / 2) * buffer->StrideUV(),
+                       buffer->StrideUV(),
+                       dst_argb + row * dst_stride, dst_stride,
+                       dst_width, rows);
+  });
+  return true;
+}
+
+bool FrameConverter::ConvertI422(const webrtc::I422BufferInterface& src,
+                                 uint8_t* dst_argb,
+                                 int dst_stride,
+                                 int dst_width,
+                                 int dst_height) {
+  const webrtc::I422BufferInterface* buffer = &src;
+
+  webrtc::scoped_refptr<webrtc::I422Buffer> scaled;
+  if (src.width() != dst_width || src.height() != dst_height) {
+    scaled = scale_pool_.CreateI422Buffer(dst_width, dst_height);
+    if (!scaled) {
+      RTC_LOG(LS_WARNING) << "FrameConverter: scale buffer pool exhausted";
+      return false;
+    }
+    libyuv::I422Scale(src.DataY(), src.StrideY(),
+                      src.DataU(), src.StrideU(),
+                      src.DataV(), src.StrideV(),
+                      src.width(), src.height(),
+                      scaled->MutableDataY(), scaled->StrideY(),
+                      scaled->MutableDataU(), scaled->StrideU(),
+                      scaled->MutableDataV(), scaled->StrideV(),
+                      dst_width, dst_height, libyuv::kFilterBox);
+    buffer = scaled.get();
+  }
+
+  // 4:2:2 and 4:4:4 have full-height chroma planes
+  ForEachStripe(dst_width, dst_height, [&](int row, int rows) {
+    libyuv::I422ToARGB(buffer->DataY() + row * buffer->StrideY(),
+                       buffer->StrideY(),
+                       buffer->DataU() + row * buffer->StrideU(),
+                       buffer->StrideU(),
+                       buffer->DataV() + row * buffer->StrideV(),
+                       buffer->StrideV(),
+                       dst_argb + row * dst_stride, dst_stride,
+                       dst_width, rows);
+  });
+  return true;
+}
+
+bool FrameConverter::ConvertI444(const webrtc::I444BufferInterface& src,
+                                 uint8_t* dst_argb,
+                                 int dst_stride,
+                                 int dst_width,
+                                 int dst_height) {
+  const webrtc::I444BufferInterface* buffer = &src;
+
+  webrtc::scoped_refptr<webrtc::I444Buffer> scaled;
+  if (src.width() != dst_width || src.height() != dst_height) {
+    scaled = scale_pool_.CreateI444Buffer(dst_width, dst_height);
+    if (!scaled) {
+      RTC_LOG(LS_WARNING) << "FrameConverter: scale buffer pool exhausted";
+      return false;
+    }
+    libyuv::I444Scale(src.DataY(), src.StrideY(),
+                      src.DataU(), src.StrideU(),
+                      src.DataV(), src.StrideV(),
+                      src.width(), src.height(),
+                      scaled->MutableDataY(), scaled->StrideY(),
+                      scaled->MutableDataU(), scaled->StrideU(),
+                      scaled->MutableDataV(), scaled->StrideV(),
+                      dst_width, dst_height, libyuv::kFilterBox);
+    buffer = scaled.get();
+  }
+
+  ForEachStripe(dst_width, dst_height, [&](int row, int rows) {
+    libyuv::I444ToARGB(buffer->DataY() + row * buffer->StrideY(),
+                       buffer->StrideY(),
+                       buffer->DataU() + row * buffer->StrideU(),
+                       buffer->StrideU(),
+                       buffer->DataV() + row * buffer->StrideV(),
+                       buffer->StrideV(),
+                       dst_argb + row * dst_stride, dst_stride,
+                       dst_width, rows);
+  });
+  return true;
+}
+
+bool FrameConverter::ConvertI010(const webrtc::I010BufferInterface& src,
+                                 uint8_t* dst_argb,
+                                 int dst_stride,
+                                 int dst_width,
+                                 int dst_height) {
+  const webrtc::I010BufferInterface* buffer = &src;
+
+  // Scale at 16 bits per sample; only the colour conversion drops to 8 bits
+  // per channel, so there is no intermediate 8-bit I420 copy
+  webrtc::scoped_refptr<webrtc::I010Buffer> scaled;
+  if (src.width() != dst_width || src.height() != dst_height) {
+    scaled = scale_pool_.CreateI010Buffer(dst_width, dst_height);
+    if (!scaled) {
+      RTC_LOG(LS_WARNING) << "FrameConverter: scale buffer pool exhausted";
+      return false;
+    }
+    libyuv::I420Scale_16(src.DataY(), src.StrideY(),
+                         src.DataU(), src.StrideU(),
+                         src.DataV(), src.StrideV(),
+                         src.width(), src.height(),
+                         scaled->MutableDataY(), scaled->StrideY(),
+                         scaled->MutableDataU(), scaled->StrideU(),
+                         scaled->MutableDataV(), scaled->StrideV(),
+                         dst_width, dst_height, libyuv::kFilterBox);
+    buffer = scaled.get();
+  }
+
+  // Strides of 16-bit planes are in samples, not bytes
+  ForEachStripe(dst_width, dst_height, [&](int row, int rows) {
+    libyuv::I010ToARGB(buffer->DataY() + row * buffer->StrideY(),
+                       buffer->StrideY(),
+                       buffer->DataU() + (row / 2) * buffer->StrideU(),
+                       buffer->StrideU(),
+                       buffer->DataV() + (row / 2) * buffer->StrideV(),
+                       buffer->StrideV(),
+                       dst_argb + row * dst_stride, dst_stride,
+                       dst_width, rows);
+  });
+  return true;
+}
+
+void FrameConverter::I420ToArgbStriped(const webrtc::I420BufferInterface& src,
+                                       uint8_t* dst_argb,
+                                       int dst_stride) {
+  ForEachStripe(src.width(), src.height(), [&](int row, int rows) {
+    libyuv::I420ToARGB(src.DataY() + row * src.StrideY(), src.StrideY(),
+                       src.DataU() + (row / 2) * src.StrideU(), src.StrideU(),
+                       src.DataV() + (row / 2) * src.StrideV(), src.StrideV(),
+                       dst_argb + row * dst_stride, dst_stride,
+                       src.width(), rows);
+  });
+}
@@ -0,0 +1,129 @@
+#include "loopback_endpoint.h"
+
+#include <cstdio>
+
+#include "api/environment/environment.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+LoopbackRelay::LoopbackRelay(const char* thread_name)
+    : thread_(webrtc::Thread::Create()) {
+  thread_->SetName(thread_name, nullptr);
+  thread_->Start();
+}
+
+bool LoopbackRelay::Add(LoopbackEndpoint* endpoint) {
+  return thread_->BlockingCall([&] {
+    endpoints_[endpoint->id()] = endpoint;
+    return endpoint->engine().Initialize();
+  });
+}
+
+void LoopbackRelay::Shutdown() {
+  thread_->BlockingCall([&] {
+    for (const auto& entry : endpoints_) {
+      entry.second->engine().Shutdown();
+    }
+    endpoints_.clear();
+  });
+  thread_->Stop();
+}
+
+LoopbackEndpoint* LoopbackRelay::Find(const std::string& id) const {
+  auto it = endpoints_.find(id);
+  return it != endpoints_.end() ? it->second : nullptr;
+}
+
+LoopbackEndpoint::LoopbackEndpoint(const std::string& id,
+                                   const webrtc::Environment& env,
+                                   LoopbackRelay* relay)
+    : id_(id), relay_(relay), engine_(env) {
+  engine_.SetObserver(this);
+}
+
+int LoopbackEndpoint::connected_peers() const {
+  webrtc::MutexLock lock(&mutex_);
+  return static_cast<int>(connected_.size());
+}
+
+bool LoopbackEndpoint::is_open(const std::string& label) const {
+  webrtc::MutexLock lock(&mutex_);
+  return open_.count(label) != 0;
+}
+
+bool LoopbackEndpoint::WaitForConnectedPeers(int count, int timeout_ms) const {
+  const int64_t deadline_ms = webrtc::TimeMillis() + timeout_ms;
+  while (connected_peers() < count) {
+    if (webrtc::TimeMillis() > deadline_ms) {
+      return false;
+    }
+    webrtc::Thread::SleepMs(50);
+  }
+  return true;
+}
+
+void LoopbackEndpoint::OnIceConnectionStateChanged(
+    const std::string& peer_id,
+    webrtc::PeerConnectionInterface::IceConnectionState state) {
+  webrtc::MutexLock lock(&mutex_);
+  if (state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
+      state == webrtc::PeerConnectionInterface::kIceConnectionCompleted) {
+    connected_.insert(peer_id);
+  } else {
+    connected_.erase(peer_id);
+  }
+}
+
+void LoopbackEndpoint::OnOfferCreated(const std::string& peer_id,
+                                      const std::string& sdp) {
+  relay_->thread()->PostTask([relay = relay_, from = id_, peer_id, sdp] {
+    if (LoopbackEndpoint* to = relay->Find(peer_id)) {
+      to->engine().SetRemoteOffer(from, sdp);
+      to->engine().CreateAnswer(from);
+    }
+  });
+}
+
+void LoopbackEndpoint::OnAnswerCreated(const std::string& peer_id,
+                                       const std::string& sdp) {
+  relay_->thread()->PostTask([relay = relay_, from = id_, peer_id, sdp] {
+    if (LoopbackEndpoint* to = relay->Find(peer_id)) {
+      to->engine().SetRemoteAnswer(from, sdp);
+    }
+  });
+}
+
+void LoopbackEndpoint::OnIceCandidateGenerated(const std::string& peer_id,
+                                               const std::string& sdp_mid,
+                                               int sdp_mline_index,
+                                               const std::string& candidate) {
+  relay_->thread()->PostTask([relay = relay_, from = id_, peer_id, sdp_mid,
+                              sdp_mline_index, candidate] {
+    if (LoopbackEndpoint* to = relay->Find(peer_id)) {
+      to->engine().AddIceCandidate(from, sdp_mid, sdp_mline_index, candidate);
+    }
+  });
+}
+
+void LoopbackEndpoint::OnDataChannelStateChanged(
+    const std::string& peer_id,
+    const std::string& label,
+    webrtc::DataChannelInterface::DataState state) {
+  webrtc::MutexLock lock(&mutex_);
+  if (state == webrtc::DataChannelInterface::kOpen) {
+    open_.insert(label);
+  } else {
+    open_.erase(label);
+  }
+}
+
+void LoopbackEndpoint::OnError(const std::string& peer_id,
+                               const std::string& error) {
+  RTC_LOG(LS_ERROR) << "Loopback endpoint " << id_ << " -> " << peer_id
+                    << ": " << error;
+}
+
+void ReportBenchmarkLine(const std::string& line) {
+  std::printf("%s\n", line.c_str());
+  RTC_LOG(LS_INFO) << line;
+}
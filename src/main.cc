@@ -14,6 +14,7 @@
 #include <shellapi.h>
 // clang-format on
 
+#include <cstring>
 #include <memory>
 
 // WebRTC headers
@@ -26,6 +27,9 @@
 
 // Application headers
 #include "call_coordinator.h"
+#include "data_channel_benchmark.h"
+#include "mesh_benchmark.h"
+#include "render_benchmark.h"
 #include "video_call_window.h"
 
 // Qt headers
@@ -43,6 +47,13 @@
  * @return int Exit code (0 for success, -1 for failure)
  */
 int main(int argc, char* argv[]) {
+  // Offline renderer benchmark; needs neither networking nor a window
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], kRenderBenchmarkSwitch) == 0) {
+      return RunRenderBenchmark();
+    }
+  }
+
   // ============================================================================
   // 1. Initialize WebRTC infrastructure
   // ============================================================================
@@ -60,6 +71,21 @@ int main(int argc, char* argv[]) {
   // Initialize SSL/TLS support
   webrtc::InitializeSSL();
 
+  // Multi-peer CPU and data channel benchmarks; need the networking set up
+  // above, no window
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], kMeshBenchmarkSwitch) == 0) {
+      const int result = RunMeshBenchmark(env);
+      webrtc::CleanupSSL();
+      return result;
+    }
+    if (std::strcmp(argv[i], kDataChannelBenchmarkSwitch) == 0) {
+      const int result = RunDataChannelBenchmark(env);
+      webrtc::CleanupSSL();
+      return result;
+    }
+  }
+
   // ============================================================================
   // 2. Initialize Qt Application
   // ============================================================================
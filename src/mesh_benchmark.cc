@@ -0,0 +1,108 @@
+#include "mesh_benchmark.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "api/environment/environment.h"
+#include "loopback_endpoint.h"
+#include "rtc_base/cpu_time.h"
+#include "rtc_base/strings/string_builder.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+const char kMeshBenchmarkSwitch[] = "--benchmark-mesh";
+
+namespace {
+
+constexpr int kMaxPeers = 5;
+constexpr int kConnectTimeoutMs = 15000;
+constexpr int kSettleMs = 2000;
+constexpr int kMeasureMs = 5000;
+constexpr char kHubId[] = "hub";
+
+// Process CPU over the next |window_ms|, as a percentage of one core.
+double MeasureCpuPercent(int window_ms) {
+  const int64_t cpu_start_ns = webrtc::GetProcessCpuTimeNanos();
+  const int64_t wall_start_ns = webrtc::TimeNanos();
+  webrtc::Thread::SleepMs(window_ms);
+  const int64_t wall_ns = webrtc::TimeNanos() - wall_start_ns;
+  const int64_t cpu_ns = webrtc::GetProcessCpuTimeNanos() - cpu_start_ns;
+  return wall_ns > 0 ? 100.0 * cpu_ns / wall_ns : 0.0;
+}
+
+}  // namespace
+
+int RunMeshBenchmark(const webrtc::Environment& env) {
+  // Endpoints outlive the relay's Shutdown() below
+  std::vector<std::unique_ptr<LoopbackEndpoint>> endpoints;
+  LoopbackRelay relay("mesh_relay");
+  auto add_endpoint = [&](const std::string& id) -> LoopbackEndpoint* {
+    endpoints.push_back(std::make_unique<LoopbackEndpoint>(id, env, &relay));
+    LoopbackEndpoint* endpoint = endpoints.back().get();
+    return relay.Add(endpoint) ? endpoint : nullptr;
+  };
+
+  int result = 0;
+  LoopbackEndpoint* hub = add_endpoint(kHubId);
+  if (!hub) {
+    ReportBenchmarkLine("Mesh benchmark: failed to initialize the hub engine");
+    result = -1;
+  }
+
+  double idle_percent = 0.0;
+  double first_peer_percent = 0.0;
+  double previous_percent = 0.0;
+  int peers = 0;
+  if (result == 0) {
+    idle_percent = previous_percent = MeasureCpuPercent(kMeasureMs);
+    webrtc::StringBuilder sb;
+    sb.AppendFormat("peers 0: process CPU %.1f%%", idle_percent);
+    ReportBenchmarkLine(sb.str());
+  }
+
+  for (int n = 1; result == 0 && n <= kMaxPeers; ++n) {
+    const std::string leaf_id = "peer" + std::to_string(n);
+    LoopbackEndpoint* leaf = add_endpoint(leaf_id);
+    // The leaf only receives, so the hub's offer decides its m-lines
+    const bool started = leaf && relay.thread()->BlockingCall([&] {
+      if (!leaf->engine().CreatePeerConnection(kHubId, /*will_offer=*/false) ||
+          !hub->engine().CreatePeerConnection(leaf_id) ||
+          !hub->engine().AddTracks(leaf_id)) {
+        return false;
+      }
+      hub->engine().CreateOffer(leaf_id);
+      return true;
+    });
+    if (!started || !hub->WaitForConnectedPeers(n, kConnectTimeoutMs)) {
+      ReportBenchmarkLine("Mesh benchmark: " + leaf_id + " did not connect");
+      result = -1;
+      break;
+    }
+
+    webrtc::Thread::SleepMs(kSettleMs);
+    const double percent = MeasureCpuPercent(kMeasureMs);
+    webrtc::StringBuilder sb;
+    sb.AppendFormat("peers %d: process CPU %.1f%% (+%.1f%% for this peer)", n,
+                    percent, percent - previous_percent);
+    ReportBenchmarkLine(sb.str());
+    if (n == 1) {
+      first_peer_percent = percent;
+    }
+    previous_percent = percent;
+    peers = n;
+  }
+
+  if (peers > 1) {
+    webrtc::StringBuilder sb;
+    sb.AppendFormat(
+        "Average per extra peer: +%.1f%% CPU (first peer +%.1f%% over idle)",
+        (previous_percent - first_peer_percent) / (peers - 1),
+        first_peer_percent - idle_percent);
+    ReportBenchmarkLine(sb.str());
+  }
+
+  relay.Shutdown();
+  return result;
+}
@@ -0,0 +1,108 @@
+#include "render_benchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include "api/test/create_frame_generator.h"
+#include "api/test/frame_generator_interface.h"
+#include "api/video/video_frame.h"
+#include "frame_converter.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/strings/string_builder.h"
+#include "rtc_base/time_utils.h"
+
+const char kRenderBenchmarkSwitch[] = "--benchmark-render";
+
+namespace {
+
+constexpr int kWarmupIterations = 5;
+constexpr int kIterations = 60;
+
+struct Resolution {
+  const char* name;
+  int width;
+  int height;
+};
+
+// Average microseconds per call of |convert|, after a short warm-up that
+// fills the converter's buffer pools.
+template <typename Convert>
+double TimeConversion(Convert convert) {
+  for (int i = 0; i < kWarmupIterations; ++i) {
+    convert();
+  }
+  const int64_t start_us = webrtc::TimeMicros();
+  for (int i = 0; i < kIterations; ++i) {
+    convert();
+  }
+  return static_cast<double>(webrtc::TimeMicros() - start_us) / kIterations;
+}
+
+void Report(const Resolution& source,
+            const Resolution& target,
+            double direct_us,
+            double two_step_us) {
+  webrtc::StringBuilder sb;
+  sb.AppendFormat(
+      "I010 %s -> ARGB %s: direct %.2f ms, ToI420+I420 %.2f ms (%.2fx)",
+      source.name, target.name, direct_us / 1000.0, two_step_us / 1000.0,
+      direct_us > 0 ? two_step_us / direct_us : 0.0);
+  std::printf("%s\n", sb.str().c_str());
+  RTC_LOG(LS_INFO) << sb.str();
+}
+
+}  // namespace
+
+int RunRenderBenchmark() {
+  const Resolution kSources[] = {
+      {"1080p", 1920, 1080},
+      {"4K", 3840, 2160},
+  };
+
+  for (const Resolution& source : kSources) {
+    auto generator = webrtc::test::CreateSquareFrameGenerator(
+        source.width, source.height,
+        webrtc::test::FrameGeneratorInterface::OutputType::kI010,
+        std::nullopt);
+    webrtc::VideoFrame frame =
+        webrtc::VideoFrame::Builder()
+            .set_video_frame_buffer(generator->NextFrame().buffer)
+            .set_timestamp_us(webrtc::TimeMicros())
+            .build();
+    if (frame.video_frame_buffer()->type() !=
+        webrtc::VideoFrameBuffer::Type::kI010) {
+      std::printf("Frame generator did not produce I010 frames\n");
+      return -1;
+    }
+
+    const Resolution targets[] = {source, {"720p", 1280, 720}};
+    for (const Resolution& target : targets) {
+      const int stride = target.width * 4;
+      std::vector<uint8_t> argb(static_cast<size_t>(stride) * target.height);
+
+      FrameConverter direct;
+      const double direct_us = TimeConversion([&] {
+        direct.ConvertToArgb(frame, argb.data(), stride, target.width,
+                             target.height);
+      });
+
+      // What the renderer used to do: an 8-bit I420 copy of every frame
+      // first, then the I420 path
+      FrameConverter two_step;
+      const double two_step_us = TimeConversion([&] {
+        webrtc::VideoFrame i420_frame =
+            webrtc::VideoFrame::Builder()
+                .set_video_frame_buffer(frame.video_frame_buffer()->ToI420())
+                .set_timestamp_us(frame.timestamp_us())
+                .build();
+        two_step.ConvertToArgb(i420_frame, argb.data(), stride, target.width,
+                               target.height);
+      });
+
+      Report(source, target, direct_us, two_step_us);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "render_stats.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "rtc_base/numerics/histogram_percentile_counter.h"
+#include "rtc_base/strings/string_builder.h"
+
+namespace {
+
+// Durations are bucketed at 0.1 ms; anything above 500 ms goes to the
+// histogram's sparse long tail.
+constexpr int64_t kBucketUs = 100;
+constexpr uint32_t kLongTailBuckets = 5000;
+
+double BucketsToMs(uint32_t buckets) {
+  return buckets * kBucketUs / 1000.0;
+}
+
+void AppendLatency(webrtc::StringBuilder& sb,
+                   const char* name,
+                   const RenderLatencyStats& latency) {
+  sb << " " << name << "(p50/p95/max)=";
+  if (latency.count == 0) {
+    sb << "-";
+    return;
+  }
+  sb.AppendFormat("%.1f/%.1f/%.1fms", latency.p50_ms, latency.p95_ms,
+                  latency.max_ms);
+}
+
+}  // namespace
+
+std::string RenderStatsToString(const RenderStatsSnapshot& stats) {
+  webrtc::StringBuilder sb;
+  sb.AppendFormat("fps=%.1f", stats.painted_fps);
+  sb << " received=" << stats.frames_received
+     << " painted=" << stats.frames_painted
+     << " skipped=" << stats.frames_skipped;
+  AppendLatency(sb, "convert", stats.convert);
+  AppendLatency(sb, "queue", stats.queue_to_paint);
+  AppendLatency(sb, "capture", stats.capture_to_paint);
+  sb << " image_pool(hit/miss/evict)=" << stats.image_pool_hits << "/"
+     << stats.image_pool_misses << "/" << stats.image_pool_evictions;
+  return sb.Release();
+}
+
+// One latency distribution for the current stats window.
+class RenderStatsCollector::Window {
+ public:
+  void Add(int64_t duration_us) {
+    duration_us = std::max<int64_t>(duration_us, 0);
+    if (!histogram_) {
+      histogram_ = std::make_unique<webrtc::HistogramPercentileCounter>(
+          kLongTailBuckets);
+    }
+    histogram_->Add(static_cast<uint32_t>(duration_us / kBucketUs));
+    sum_us_ += duration_us;
+    max_us_ = std::max(max_us_, duration_us);
+    ++count_;
+  }
+
+  RenderLatencyStats Take() {
+    RenderLatencyStats stats;
+    if (count_ == 0) {
+      return stats;
+    }
+    stats.count = count_;
+    stats.avg_ms = sum_us_ / 1000.0 / count_;
+    stats.p50_ms = BucketsToMs(histogram_->GetPercentile(0.5f).value_or(0));
+    stats.p95_ms = BucketsToMs(histogram_->GetPercentile(0.95f).value_or(0));
+    stats.max_ms = max_us_ / 1000.0;
+
+    histogram_.reset();
+    sum_us_ = 0;
+    max_us_ = 0;
+    count_ = 0;
+    return stats;
+  }
+
+ private:
+  std::unique_ptr<webrtc::HistogramPercentileCounter> histogram_;
+  int64_t sum_us_ = 0;
+  int64_t max_us_ = 0;
+  int count_ = 0;
+};
+
+RenderStatsCollector::RenderStatsCollector()
+    : convert_(std::make_unique<Window>()),
+      queue_to_paint_(std::make_unique<Window>()),
+      capture_to_paint_(std::make_unique<Window>()) {}
+
+RenderStatsCollector::~RenderStatsCollector() = default;
+
+void RenderStatsCollector::AddConversion(int64_t duration_us) {
+  convert_->Add(duration_us);
+}
+
+void RenderStatsCollector::AddPaintedFrame(int64_t arrival_us,
+                                           int64_t capture_us,
+                                           int64_t paint_us) {
+  ++frames_painted_;
+  queue_to_paint_->Add(paint_us - arrival_us);
+  if (capture_us > 0) {
+    capture_to_paint_->Add(paint_us - capture_us);
+  }
+}
+
+RenderStatsSnapshot RenderStatsCollector::TakeSnapshot(
+    uint64_t frames_received,
+    uint64_t frames_skipped,
+    int64_t now_us) {
+  RenderStatsSnapshot snapshot;
+  snapshot.valid = frames_received > 0;
+  snapshot.frames_received = frames_received;
+  snapshot.frames_painted = frames_painted_;
+  snapshot.frames_skipped = frames_skipped;
+
+  const int64_t elapsed_us = now_us - window_start_us_;
+  if (window_start_us_ > 0 && elapsed_us > 0) {
+    snapshot.painted_fps =
+        (frames_painted_ - window_start_painted_) * 1000000.0 / elapsed_us;
+  }
+  snapshot.convert = convert_->Take();
+  snapshot.queue_to_paint = queue_to_paint_->Take();
+  snapshot.capture_to_paint = capture_to_paint_->Take();
+
+  window_start_us_ = now_us;
+  window_start_painted_ = frames_painted_;
+  return snapshot;
+}
@@ -80,7 +80,7 @@ void SignalClient::RegisterObserver(SignalClientObserver* observer) {
   observer_ = observer;
 }
 
-void SignalClient::SendCallRequest(const QString& to) {
+void SignalClient::SendCallRequest(const QString& to, const QJsonObject& offer) {
   QJsonObject message;
   message["type"] = "call-request";
   message["from"] = client_id_;
@@ -88,12 +88,16 @@ void SignalClient::SendCallRequest(const QString& to) {
   
   QJsonObject payload;
   payload["timestamp"] = QDateTime::currentMSecsSinceEpoch();
+  if (!offer.isEmpty()) {
+    payload["offer"] = offer;
+  }
   message["payload"] = payload;
   
   SendMessage(message);
 }
 
-void SignalClient::SendCallResponse(const QString& to, bool accepted, const QString& reason) {
+void SignalClient::SendCallResponse(const QString& to, bool accepted, const QString& reason,
+                                    const QJsonObject& answer) {
   QJsonObject message;
   message["type"] = "call-response";
   message["from"] = client_id_;
@@ -104,6 +108,9 @@ void SignalClient::SendCallResponse(const QString& to, bool accepted, const QStr
   if (!reason.isEmpty()) {
     payload["reason"] = reason;
   }
+  if (!answer.isEmpty()) {
+    payload["answer"] = answer;
+  }
   message["payload"] = payload;
   
   SendMessage(message);
@@ -180,6 +187,19 @@ void SignalClient::SendIceCandidate(const QString& to, const QJsonObject& candid
   
   SendMessage(message);
 }
+
+void SignalClient::SendIceCandidates(const QString& to, const QJsonArray& candidates) {
+  QJsonObject message;
+  message["type"] = "ice-candidates";
+  message["from"] = client_id_;
+  message["to"] = to;
+
+  QJsonObject payload;
+  payload["candidates"] = candidates;
+  message["payload"] = payload;
+  
+  SendMessage(message);
+}
 
 void SignalClient::RequestClientList() {
   QJsonObject message;
@@ -353,7 +373,7 @@ void SignalClient::HandleMessage(const QJsonObject& message) {
     case SignalMessageType::CallResponse: {
       bool accepted = payload["accepted"].toBool();
       QString reason = payload["reason"].toString();
-      observer_->OnCallResponse(from.toStdString(), accepted, reason.toStdString());
+      observer_->OnCallResponse(from.toStdString(), accepted, reason.toStdString(), payload);
       break;
     }
     
@@ -385,6 +405,10 @@ void SignalClient::HandleMessage(const QJsonObject& message) {
       observer_->OnIceCandidate(from.toStdString(), payload);
       break;
       
+    case SignalMessageType::IceCandidates:
+      observer_->OnIceCandidates(from.toStdString(), payload["candidates"].toArray());
+      break;
+      
     default:
       qWarning() << "Unknown message type:" << type_str;
       break;
@@ -403,6 +427,7 @@ SignalMessageType SignalClient::GetMessageType(const QString& type_str) const {
   if (type_str == "offer") return SignalMessageType::Offer;
   if (type_str == "answer") return SignalMessageType::Answer;
   if (type_str == "ice-candidate") return SignalMessageType::IceCandidate;
+  if (type_str == "ice-candidates") return SignalMessageType::IceCandidates;
   return SignalMessageType::Unknown;
 }
 
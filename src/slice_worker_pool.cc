@@ -0,0 +1,84 @@
+#include "slice_worker_pool.h"
+
+SliceWorkerPool::SliceWorkerPool(int num_workers) {
+  workers_.reserve(num_workers > 0 ? num_workers : 0);
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+SliceWorkerPool::~SliceWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void SliceWorkerPool::ParallelFor(int num_slices,
+                                  webrtc::FunctionView<void(int)> job) {
+  if (num_slices <= 0) {
+    return;
+  }
+  if (num_slices == 1 || workers_.empty()) {
+    for (int i = 0; i < num_slices; ++i) {
+      job(i);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = &job;
+  num_slices_ = num_slices;
+  next_slice_ = 0;
+  pending_slices_ = num_slices;
+  ++generation_;
+  work_cv_.notify_all();
+
+  RunSlices(lock);
+
+  // Wait for the slices other threads claimed, and for every worker to have
+  // left this job before the next one can reuse the state.
+  done_cv_.wait(lock, [this]() {
+    return pending_slices_ == 0 && active_workers_ == 0;
+  });
+  job_ = nullptr;
+}
+
+void SliceWorkerPool::WorkerLoop() {
+  uint64_t seen_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this, &seen_generation]() {
+      return stop_ || generation_ != seen_generation;
+    });
+    if (stop_) {
+      return;
+    }
+    seen_generation = generation_;
+    if (!job_) {
+      continue;
+    }
+
+    ++active_workers_;
+    RunSlices(lock);
+    --active_workers_;
+    if (pending_slices_ == 0 && active_workers_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+void SliceWorkerPool::RunSlices(std::unique_lock<std::mutex>& lock) {
+  while (next_slice_ < num_slices_) {
+    const int slice = next_slice_++;
+    webrtc::FunctionView<void(int)> job = *job_;
+    lock.unlock();
+    job(slice);
+    lock.lock();
+    --pending_slices_;
+  }
+}
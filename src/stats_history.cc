@@ -0,0 +1,99 @@
+#include "stats_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+StatsHistory::StatsHistory() = default;
+StatsHistory::~StatsHistory() = default;
+
+void StatsHistory::Reset(size_t capacity) {
+  capacity = std::max<size_t>(capacity, 1);
+  webrtc::MutexLock lock(&mutex_);
+  // resize() keeps the reserved memory when shrinking
+  ring_.resize(capacity);
+  scratch_.reserve(capacity);
+  next_ = 0;
+  size_ = 0;
+}
+
+void StatsHistory::Add(const StatsSample& sample) {
+  webrtc::MutexLock lock(&mutex_);
+  if (ring_.empty()) {
+    return;
+  }
+  ring_[next_] = sample;
+  next_ = (next_ + 1) % ring_.size();
+  size_ = std::min(size_ + 1, ring_.size());
+}
+
+size_t StatsHistory::size() const {
+  webrtc::MutexLock lock(&mutex_);
+  return size_;
+}
+
+size_t StatsHistory::capacity() const {
+  webrtc::MutexLock lock(&mutex_);
+  return ring_.size();
+}
+
+StatsSummary StatsHistory::Summarize(StatsMetric metric,
+                                     int64_t window_ms,
+                                     int64_t now_ms) const {
+  StatsSummary summary;
+  webrtc::MutexLock lock(&mutex_);
+  const size_t count = CountInWindow(window_ms, now_ms);
+  scratch_.clear();
+  double sum = 0.0;
+  for (size_t age = 0; age < count; ++age) {
+    const float value = Newest(age)[metric];
+    if (std::isnan(value)) {
+      continue;
+    }
+    scratch_.push_back(value);
+    sum += value;
+  }
+  if (scratch_.empty()) {
+    return summary;
+  }
+
+  // Nearest-rank percentile
+  const size_t p95_rank =
+      static_cast<size_t>(std::ceil(0.95 * scratch_.size())) - 1;
+  std::nth_element(scratch_.begin(), scratch_.begin() + p95_rank,
+                   scratch_.end());
+  summary.count = static_cast<int>(scratch_.size());
+  summary.avg = sum / scratch_.size();
+  summary.p95 = scratch_[p95_rank];
+  summary.min = *std::min_element(scratch_.begin(), scratch_.end());
+  summary.max = *std::max_element(scratch_.begin(), scratch_.end());
+  return summary;
+}
+
+void StatsHistory::GetSamples(int64_t window_ms,
+                              int64_t now_ms,
+                              std::vector<StatsSample>* samples) const {
+  samples->clear();
+  webrtc::MutexLock lock(&mutex_);
+  const size_t count = CountInWindow(window_ms, now_ms);
+  samples->reserve(count);
+  for (size_t age = count; age > 0; --age) {
+    samples->push_back(Newest(age - 1));
+  }
+}
+
+size_t StatsHistory::CountInWindow(int64_t window_ms, int64_t now_ms) const {
+  if (window_ms <= 0) {
+    return size_;
+  }
+  // Samples are in time order, so stop at the first one that is too old
+  const int64_t oldest_ms = now_ms - window_ms;
+  size_t count = 0;
+  while (count < size_ && Newest(count).time_ms > oldest_ms) {
+    ++count;
+  }
+  return count;
+}
+
+const StatsSample& StatsHistory::Newest(size_t age) const {
+  return ring_[(next_ + ring_.size() - 1 - age) % ring_.size()];
+}
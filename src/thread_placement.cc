@@ -0,0 +1,349 @@
+#include "thread_placement.h"
+
+#include <cstdlib>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "api/task_queue/task_queue_base.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/strings/string_builder.h"
+
+#if defined(WEBRTC_WIN)
+#include <windows.h>
+#elif defined(WEBRTC_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::vector<std::string> Split(const std::string& text, char separator) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(separator, start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    parts.push_back(text.substr(start, end - start));
+    start = end + 1;
+  }
+  return parts;
+}
+
+bool ParseCpuIndex(const std::string& text, int* cpu) {
+  if (text.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  const long value = std::strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || value < 0 || value > 1023) {
+    return false;
+  }
+  *cpu = static_cast<int>(value);
+  return true;
+}
+
+// "2,3" or "4-7" or a mix of both; empty is allowed.
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus) {
+  if (text.empty()) {
+    return true;
+  }
+  for (const std::string& item : Split(text, ',')) {
+    const size_t dash = item.find('-');
+    int first = 0;
+    int last = 0;
+    if (dash == std::string::npos) {
+      if (!ParseCpuIndex(item, &first)) {
+        return false;
+      }
+      last = first;
+    } else if (!ParseCpuIndex(item.substr(0, dash), &first) ||
+               !ParseCpuIndex(item.substr(dash + 1), &last) || last < first) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(cpu);
+    }
+  }
+  return true;
+}
+
+bool ParsePriority(const std::string& text, webrtc::ThreadPriority* priority) {
+  if (text == "low") {
+    *priority = webrtc::ThreadPriority::kLow;
+  } else if (text == "normal") {
+    *priority = webrtc::ThreadPriority::kNormal;
+  } else if (text == "high") {
+    *priority = webrtc::ThreadPriority::kHigh;
+  } else if (text == "realtime") {
+    *priority = webrtc::ThreadPriority::kRealtime;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* PriorityName(webrtc::ThreadPriority priority) {
+  switch (priority) {
+    case webrtc::ThreadPriority::kLow:
+      return "low";
+    case webrtc::ThreadPriority::kNormal:
+      return "normal";
+    case webrtc::ThreadPriority::kHigh:
+      return "high";
+    case webrtc::ThreadPriority::kRealtime:
+      return "realtime";
+  }
+  return "?";
+}
+
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus) {
+#if defined(WEBRTC_WIN)
+  DWORD_PTR mask = 0;
+  for (int cpu : cpus) {
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+      return false;
+    }
+    mask |= static_cast<DWORD_PTR>(1) << cpu;
+  }
+  return ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#elif defined(WEBRTC_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+bool SetCurrentThreadPriority(webrtc::ThreadPriority priority) {
+#if defined(WEBRTC_WIN)
+  int value = THREAD_PRIORITY_NORMAL;
+  switch (priority) {
+    case webrtc::ThreadPriority::kLow:
+      value = THREAD_PRIORITY_BELOW_NORMAL;
+      break;
+    case webrtc::ThreadPriority::kNormal:
+      value = THREAD_PRIORITY_NORMAL;
+      break;
+    case webrtc::ThreadPriority::kHigh:
+      value = THREAD_PRIORITY_HIGHEST;
+      break;
+    case webrtc::ThreadPriority::kRealtime:
+      value = THREAD_PRIORITY_TIME_CRITICAL;
+      break;
+  }
+  return ::SetThreadPriority(::GetCurrentThread(), value) != 0;
+#elif defined(WEBRTC_LINUX)
+  if (priority == webrtc::ThreadPriority::kRealtime) {
+    sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+  }
+  // Leave SCHED_FIFO if an earlier placement put the thread there
+  sched_param param;
+  param.sched_priority = 0;
+  if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0) {
+    return false;
+  }
+  // Under SCHED_OTHER the nice value is per thread on Linux
+  int nice_value = 0;
+  if (priority == webrtc::ThreadPriority::kLow) {
+    nice_value = 10;
+  } else if (priority == webrtc::ThreadPriority::kHigh) {
+    nice_value = -10;
+  }
+  const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  return setpriority(PRIO_PROCESS, tid, nice_value) == 0;
+#else
+  return false;
+#endif
+}
+
+class PlacedTaskQueueFactory : public webrtc::TaskQueueFactory {
+ public:
+  PlacedTaskQueueFactory(const webrtc::TaskQueueFactory& base,
+                         const ThreadPlacement& placement)
+      : base_(base), placement_(placement) {}
+
+  std::unique_ptr<webrtc::TaskQueueBase, webrtc::TaskQueueDeleter>
+  CreateTaskQueue(absl::string_view name, Priority priority) const override {
+    auto queue = base_.CreateTaskQueue(name, priority);
+    if (queue) {
+      // First task on the queue, so it runs before any work is posted
+      queue->PostTask([placement = placement_] {
+        ApplyThreadPlacement(placement);
+      });
+    }
+    return queue;
+  }
+
+ private:
+  const webrtc::TaskQueueFactory& base_;
+  const ThreadPlacement placement_;
+};
+
+}  // namespace
+
+bool ApplyThreadPlacement(const ThreadPlacement& placement) {
+  bool ok = true;
+  if (!placement.cpus.empty() && !SetCurrentThreadAffinity(placement.cpus)) {
+    RTC_LOG(LS_WARNING) << "Failed to set thread affinity to "
+                        << ThreadPlacementToString(placement);
+    ok = false;
+  }
+  if (placement.priority && !SetCurrentThreadPriority(*placement.priority)) {
+    RTC_LOG(LS_WARNING) << "Failed to set thread priority to "
+                        << PriorityName(*placement.priority);
+    ok = false;
+  }
+  return ok;
+}
+
+bool ParseEngineThreadConfig(const std::string& spec,
+                             EngineThreadConfig* config) {
+  EngineThreadConfig parsed = *config;
+  for (const std::string& entry : Split(spec, ';')) {
+    if (entry.empty()) {
+      continue;
+    }
+    const size_t equals = entry.find('=');
+    if (equals == std::string::npos) {
+      RTC_LOG(LS_WARNING) << "Thread placement entry without '=': " << entry;
+      return false;
+    }
+    const std::string name = entry.substr(0, equals);
+    const std::string value = entry.substr(equals + 1);
+
+    ThreadPlacement* placement = nullptr;
+    if (name == "signaling") {
+      placement = &parsed.signaling;
+    } else if (name == "network") {
+      placement = &parsed.network;
+      parsed.dedicated_network_thread = true;
+    } else if (name == "worker") {
+      placement = &parsed.worker;
+      parsed.dedicated_worker_thread = true;
+    } else if (name == "capture") {
+      placement = &parsed.capture;
+    } else {
+      RTC_LOG(LS_WARNING) << "Unknown thread in placement spec: " << name;
+      return false;
+    }
+
+    ThreadPlacement result;
+    const size_t colon = value.find(':');
+    if (!ParseCpuList(value.substr(0, colon), &result.cpus)) {
+      RTC_LOG(LS_WARNING) << "Bad CPU list for " << name << ": " << value;
+      return false;
+    }
+    if (colon != std::string::npos) {
+      webrtc::ThreadPriority priority;
+      if (!ParsePriority(value.substr(colon + 1), &priority)) {
+        RTC_LOG(LS_WARNING) << "Bad priority for " << name << ": " << value;
+        return false;
+      }
+      result.priority = priority;
+    }
+    *placement = std::move(result);
+  }
+  *config = std::move(parsed);
+  return true;
+}
+
+std::string ThreadPlacementToString(const ThreadPlacement& placement) {
+  webrtc::StringBuilder sb;
+  if (placement.cpus.empty()) {
+    sb << "any";
+  }
+  for (size_t i = 0; i < placement.cpus.size(); ++i) {
+    sb << (i > 0 ? "," : "") << placement.cpus[i];
+  }
+  if (placement.priority) {
+    sb << " " << PriorityName(*placement.priority);
+  }
+  return sb.Release();
+}
+
+std::unique_ptr<webrtc::TaskQueueFactory> CreatePlacedTaskQueueFactory(
+    const webrtc::TaskQueueFactory& base,
+    const ThreadPlacement& placement) {
+  return std::make_unique<PlacedTaskQueueFactory>(base, placement);
+}
+
+ThreadCpuClock::~ThreadCpuClock() {
+  Release();
+}
+
+bool ThreadCpuClock::BindToCurrentThread() {
+  Release();
+#if defined(WEBRTC_WIN)
+  // GetCurrentThread() is a pseudo handle that means "the caller"; a real
+  // one is needed to query this thread from elsewhere
+  HANDLE handle = nullptr;
+  if (!::DuplicateHandle(::GetCurrentProcess(), ::GetCurrentThread(),
+                         ::GetCurrentProcess(), &handle,
+                         THREAD_QUERY_LIMITED_INFORMATION, FALSE, 0)) {
+    return false;
+  }
+  native_ = reinterpret_cast<intptr_t>(handle);
+  bound_ = true;
+#elif defined(WEBRTC_LINUX)
+  clockid_t clock_id;
+  if (pthread_getcpuclockid(pthread_self(), &clock_id) != 0) {
+    return false;
+  }
+  native_ = static_cast<intptr_t>(clock_id);
+  bound_ = true;
+#endif
+  return bound_;
+}
+
+int64_t ThreadCpuClock::CpuTimeNanos() const {
+  if (!bound_) {
+    return -1;
+  }
+#if defined(WEBRTC_WIN)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!::GetThreadTimes(reinterpret_cast<HANDLE>(native_), &creation_time,
+                        &exit_time, &kernel_time, &user_time)) {
+    return -1;
+  }
+  const uint64_t kernel_100ns =
+      (static_cast<uint64_t>(kernel_time.dwHighDateTime) << 32) |
+      kernel_time.dwLowDateTime;
+  const uint64_t user_100ns =
+      (static_cast<uint64_t>(user_time.dwHighDateTime) << 32) |
+      user_time.dwLowDateTime;
+  return static_cast<int64_t>((kernel_100ns + user_100ns) * 100);
+#elif defined(WEBRTC_LINUX)
+  timespec ts;
+  if (clock_gettime(static_cast<clockid_t>(native_), &ts) != 0) {
+    return -1;
+  }
+  return int64_t{ts.tv_sec} * 1000000000 + ts.tv_nsec;
+#else
+  return -1;
+#endif
+}
+
+void ThreadCpuClock::Release() {
+#if defined(WEBRTC_WIN)
+  if (bound_) {
+    ::CloseHandle(reinterpret_cast<HANDLE>(native_));
+  }
+#endif
+  bound_ = false;
+  native_ = 0;
+}
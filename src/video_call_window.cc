@@ -5,11 +5,18 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QCloseEvent>
+#include <QHideEvent>
+#include <QShowEvent>
+#include <QWindow>
 #include <QDateTime>
+#include <QFileDialog>
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QMetaObject>
 #include <QGridLayout>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
 #include <cmath>
 
 VideoCallWindow::VideoCallWindow(ICallController* controller, QWidget* parent)
@@ -114,6 +121,8 @@ void VideoCallWindow::OnStartLocalRenderer(webrtc::VideoTrackInterface* track) {
     if (!local_renderer_) {
       local_renderer_ = std::make_unique<VideoRenderer>(video_panel_);
       local_renderer_->setFixedSize(220, 160);
+      // 小窗预览只需要小分辨率，采集端为预览单独缩放，不影响编码分辨率
+      local_renderer_->SetAdaptiveSinkWants(true);
       local_renderer_->setStyleSheet(R"(
         QLabel {
           border: 2px solid rgba(255, 255, 255, 0.8);
@@ -122,6 +131,7 @@ void VideoCallWindow::OnStartLocalRenderer(webrtc::VideoTrackInterface* track) {
         }
       )");
       local_renderer_->raise();
+      UpdateRendererOcclusion();
     }
     local_renderer_->SetVideoTrack(track);
     local_renderer_->show();
@@ -267,6 +277,42 @@ void VideoCallWindow::OnCallStateChanged(CallState state, const std::string& pee
   }, Qt::QueuedConnection);
 }
 
+void VideoCallWindow::OnFileTransferProgress(const FileTransferProgress& progress) {
+  QMetaObject::invokeMethod(this, [this, progress]() {
+    const auto key = std::make_pair(progress.outgoing, progress.id);
+    const QString name = QString::fromStdString(progress.name);
+    const QString direction = progress.outgoing ? "发送" : "接收";
+    switch (progress.state) {
+      case FileTransferState::kCompleted:
+        file_transfers_.erase(key);
+        AppendLogInternal(QString("%1文件完成: %2（%3，平均 %4）")
+                              .arg(direction, name, FormatFileSize(progress.size),
+                                   FormatBitrate(progress.bytes_per_second * 8.0 / 1000.0)),
+                          "success");
+        break;
+      case FileTransferState::kFailed:
+        file_transfers_.erase(key);
+        AppendLogInternal(QString("%1文件失败: %2（%3）")
+                              .arg(direction, name, QString::fromStdString(progress.error)),
+                          "error");
+        break;
+      case FileTransferState::kCancelled:
+        file_transfers_.erase(key);
+        AppendLogInternal(QString("%1文件已取消: %2").arg(direction, name), "warning");
+        break;
+      default:
+        if (file_transfers_.find(key) == file_transfers_.end()) {
+          AppendLogInternal(QString("开始%1文件: %2（%3）")
+                                .arg(direction, name, FormatFileSize(progress.size)),
+                            "info");
+        }
+        file_transfers_[key] = progress;
+        break;
+    }
+    UpdateFileTransferLabel();
+  }, Qt::QueuedConnection);
+}
+
 void VideoCallWindow::OnIncomingCall(const std::string& caller_id) {
   QMetaObject::invokeMethod(this, [this, caller_id]() {
     QString qcaller_id = QString::fromStdString(caller_id);
@@ -442,6 +488,9 @@ void VideoCallWindow::CreateVideoPanel() {
   remote_renderer_ = std::make_unique<VideoRenderer>(video_panel_);
   remote_renderer_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
   remote_renderer_->setStyleSheet("QLabel { background-color: #1a202c; border-radius: 4px; }");
+  // 远端视频可能是1080p及以上，ARGB转换分条带并行，留一半核心给编解码
+  remote_renderer_->SetConversionThreads(
+      std::min(3, QThread::idealThreadCount() / 2));
   layout->addWidget(remote_renderer_.get());
   remote_renderer_->hide();
   
@@ -474,11 +523,27 @@ void VideoCallWindow::CreateStatsPanel() {
   add_row(row++, "上行码率", &stats_outbound_bitrate_value_);
   add_row(row++, "下行码率", &stats_inbound_bitrate_value_);
   add_row(row++, "往返时延", &stats_rtt_value_);
+  add_row(row++, "时延(近1分钟)", &stats_rtt_window_value_);
+  add_row(row++, "上行(近1分钟)", &stats_outbound_window_value_);
   add_row(row++, "音频抖动", &stats_audio_jitter_value_);
   add_row(row++, "音频丢包率", &stats_audio_loss_value_);
   add_row(row++, "视频丢包率", &stats_video_loss_value_);
   add_row(row++, "视频帧率", &stats_video_fps_value_);
   add_row(row++, "视频分辨率", &stats_video_resolution_value_);
+  add_row(row++, "视频编码", &stats_video_codec_value_);
+  add_row(row++, "发送限制", &stats_video_limits_value_);
+  add_row(row++, "渲染帧率", &stats_render_fps_value_);
+  add_row(row++, "渲染跳帧", &stats_render_skipped_value_);
+  add_row(row++, "转换耗时", &stats_render_convert_value_);
+  add_row(row++, "排队到绘制", &stats_render_queue_value_);
+  add_row(row++, "采集到绘制", &stats_render_capture_value_);
+  add_row(row++, "图像缓冲复用", &stats_render_pool_value_);
+  add_row(row++, "本地预览", &stats_local_render_value_);
+  add_row(row++, "呼叫建立", &stats_call_setup_value_);
+  add_row(row++, "预热/新建", &stats_call_setup_compare_value_);
+  add_row(row++, "ICE恢复", &stats_ice_recovery_value_);
+  add_row(row++, "进程CPU", &stats_cpu_value_);
+  add_row(row++, "线程CPU", &stats_thread_cpu_value_);
 
   layout->setColumnStretch(0, 0);
   layout->setColumnStretch(1, 1);
@@ -512,10 +577,22 @@ void VideoCallWindow::CreateControlPanel() {
   connect(hangup_button_, &QPushButton::clicked, this, &VideoCallWindow::OnHangupButtonClicked);
   layout->addWidget(hangup_button_);
   
+  send_file_button_ = new QPushButton("发送文件", control_panel_);
+  send_file_button_->setObjectName("sendFileButton");
+  send_file_button_->setEnabled(false);
+  send_file_button_->setMinimumHeight(40);
+  send_file_button_->setFixedWidth(110);
+  connect(send_file_button_, &QPushButton::clicked, this, &VideoCallWindow::OnSendFileButtonClicked);
+  layout->addWidget(send_file_button_);
+  
   call_info_label_ = new QLabel("空闲", control_panel_);
   call_info_label_->setStyleSheet("font-weight: 600; color: #4a5568; padding-left: 12px;");
   layout->addWidget(call_info_label_);
   
+  file_transfer_label_ = new QLabel(control_panel_);
+  file_transfer_label_->setStyleSheet("color: #4a5568; padding-left: 12px;");
+  layout->addWidget(file_transfer_label_);
+  
   layout->addStretch();
 }
 
@@ -570,8 +647,25 @@ void VideoCallWindow::OnHangupButtonClicked() {
   AppendLogInternal("通话已挂断", "info");
 }
 
+void VideoCallWindow::OnSendFileButtonClicked() {
+  const QStringList paths = QFileDialog::getOpenFileNames(this, "选择要发送的文件");
+  for (const QString& path : paths) {
+    if (!controller_->SendFile(path.toStdString())) {
+      AppendLogInternal("当前无法发送文件，请在通话建立后重试", "warning");
+      return;
+    }
+  }
+}
+
 void VideoCallWindow::OnUpdateStatsTimer() {
   RtcStatsSnapshot stats = controller_->GetLatestRtcStats();
+  // 渲染统计按定时器周期取出，每次取出开始新的统计窗口
+  if (local_renderer_) {
+    stats.local_render = local_renderer_->TakeRenderStats();
+  }
+  if (remote_renderer_) {
+    stats.remote_render = remote_renderer_->TakeRenderStats();
+  }
   if (controller_->IsInCall()) {
     CallState state = controller_->GetCallState();
     call_info_label_->setText(GetCallStateString(state));
@@ -580,6 +674,7 @@ void VideoCallWindow::OnUpdateStatsTimer() {
     stats.valid = false;
   }
   UpdateStatsUI(stats);
+  UpdateStatsHistoryUI();
 }
 
 // ============================================================================
@@ -595,6 +690,7 @@ void VideoCallWindow::UpdateUIState() {
 void VideoCallWindow::UpdateCallButtonState() {
   bool in_call = controller_->IsInCall();
   hangup_button_->setEnabled(in_call);
+  send_file_button_->setEnabled(controller_->GetCallState() == CallState::Connected);
   
   bool can_call = is_connected_ && !in_call && user_list_->currentItem() != nullptr;
   call_button_->setEnabled(can_call);
@@ -647,6 +743,71 @@ void VideoCallWindow::UpdateStatsUI(const RtcStatsSnapshot& stats) {
   }
   set_value(stats_ice_state_value_, ice_text);
 
+  // 渲染统计和呼叫建立耗时不依赖RTC统计是否可用
+  UpdateRenderStatsUI(stats);
+  UpdateCallSetupStatsUI(stats.call_setup);
+  // 码率上限, 帧率上限, 降级方式 (编码器受限原因)
+  if (stats.video_send_constraints_valid) {
+    const VideoSendConstraints& limits = stats.video_send_constraints;
+    QString text = limits.max_bitrate_kbps > 0
+                       ? QString("≤%1 kbps").arg(limits.max_bitrate_kbps)
+                       : QString("码率不限");
+    if (limits.min_bitrate_kbps > 0) {
+      text += QString(", ≥%1 kbps").arg(limits.min_bitrate_kbps);
+    }
+    if (limits.max_framerate > 0) {
+      text += QString(", ≤%1 fps").arg(FormatDouble(limits.max_framerate, 0));
+    }
+    switch (limits.degradation) {
+      case VideoDegradationMode::kMaintainFramerate:
+        text += ", 保帧率";
+        break;
+      case VideoDegradationMode::kMaintainResolution:
+        text += ", 保分辨率";
+        break;
+      case VideoDegradationMode::kBalanced:
+        text += ", 均衡";
+        break;
+    }
+    if (!stats.quality_limitation_reason.empty() && stats.quality_limitation_reason != "none") {
+      text += QString("（受限: %1）").arg(QString::fromStdString(stats.quality_limitation_reason));
+    }
+    set_value(stats_video_limits_value_, text);
+  } else {
+    set_value(stats_video_limits_value_, "—");
+  }
+  // 上次 / 平均 / 最长恢复耗时 (次数, 重启次数)
+  const IceRecoveryStats& recovery = stats.ice_recovery;
+  if (recovery.recovering) {
+    set_value(stats_ice_recovery_value_, "恢复中");
+  } else if (recovery.count > 0) {
+    set_value(stats_ice_recovery_value_,
+              QString("%1 / %2 / %3 ms（%4 次，重启 %5 次）")
+                  .arg(FormatDouble(recovery.last_ms, 0), FormatDouble(recovery.avg_ms, 0),
+                       FormatDouble(recovery.max_ms, 0))
+                  .arg(recovery.count)
+                  .arg(recovery.restarts));
+  } else {
+    set_value(stats_ice_recovery_value_, "—");
+  }
+  // CPU / 会话数
+  set_value(stats_cpu_value_,
+            QString("%1 / %2 路")
+                .arg(FormatPercentage(stats.process_cpu_percent))
+                .arg(stats.active_peer_connections));
+  // 线程名 占用[放置]，放置未配置时不显示
+  QStringList thread_cpu;
+  for (const ThreadCpuStats& thread : stats.thread_cpu) {
+    QString text = QString("%1 %2").arg(QString::fromStdString(thread.name),
+                                        FormatPercentage(thread.cpu_percent));
+    if (thread.placement != "any") {
+      text += QString("[%1]").arg(QString::fromStdString(thread.placement));
+    }
+    thread_cpu << text;
+  }
+  set_value(stats_thread_cpu_value_,
+            thread_cpu.isEmpty() ? QString("—") : thread_cpu.join(", "));
+
   if (!stats.valid) {
     set_value(stats_timestamp_value_, "—");
     set_value(stats_outbound_bitrate_value_, "—");
@@ -657,6 +818,7 @@ void VideoCallWindow::UpdateStatsUI(const RtcStatsSnapshot& stats) {
     set_value(stats_video_loss_value_, "—");
     set_value(stats_video_fps_value_, "—");
     set_value(stats_video_resolution_value_, "—");
+    set_value(stats_video_codec_value_, "—");
     return;
   }
 
@@ -669,6 +831,133 @@ void VideoCallWindow::UpdateStatsUI(const RtcStatsSnapshot& stats) {
   set_value(stats_video_loss_value_, FormatPercentage(stats.inbound_video_packet_loss_percent));
   set_value(stats_video_fps_value_, FormatDouble(stats.inbound_video_fps, 1) + " fps");
   set_value(stats_video_resolution_value_, FormatResolution(stats.inbound_video_width, stats.inbound_video_height));
+  // 发送 / 接收
+  auto codec_text = [](const std::string& codec) {
+    return codec.empty() ? QString("—") : QString::fromStdString(codec);
+  };
+  set_value(stats_video_codec_value_,
+            QString("%1 / %2").arg(codec_text(stats.outbound_video_codec),
+                                   codec_text(stats.inbound_video_codec)));
+}
+
+void VideoCallWindow::UpdateRenderStatsUI(const RtcStatsSnapshot& stats) {
+  auto set_value = [](QLabel* label, const QString& text) {
+    if (label) {
+      label->setText(text);
+    }
+  };
+
+  const RenderStatsSnapshot& remote = stats.remote_render;
+  if (remote.valid) {
+    set_value(stats_render_fps_value_, FormatDouble(remote.painted_fps, 1) + " fps");
+    set_value(stats_render_skipped_value_,
+              QString("%1 / %2").arg(remote.frames_skipped).arg(remote.frames_received));
+    set_value(stats_render_convert_value_, FormatLatency(remote.convert));
+    set_value(stats_render_queue_value_, FormatLatency(remote.queue_to_paint));
+    set_value(stats_render_capture_value_, FormatLatency(remote.capture_to_paint));
+    // 命中 / 未命中
+    set_value(stats_render_pool_value_,
+              QString("%1 / %2").arg(remote.image_pool_hits).arg(remote.image_pool_misses));
+  } else {
+    set_value(stats_render_fps_value_, "—");
+    set_value(stats_render_skipped_value_, "—");
+    set_value(stats_render_convert_value_, "—");
+    set_value(stats_render_queue_value_, "—");
+    set_value(stats_render_capture_value_, "—");
+    set_value(stats_render_pool_value_, "—");
+  }
+
+  const RenderStatsSnapshot& local = stats.local_render;
+  if (local.valid) {
+    set_value(stats_local_render_value_,
+              QString("%1 fps, 转换 %2")
+                  .arg(FormatDouble(local.painted_fps, 1), FormatLatency(local.convert)));
+  } else {
+    set_value(stats_local_render_value_, "—");
+  }
+}
+
+void VideoCallWindow::UpdateCallSetupStatsUI(const CallSetupStats& setup) {
+  if (stats_call_setup_value_) {
+    if (setup.pooled_count + setup.fresh_count > 0) {
+      stats_call_setup_value_->setText(
+          QString("%1 ms（%2，池中 %3）")
+              .arg(FormatDouble(setup.last_ms, 0),
+                   setup.last_pooled ? "预热" : "新建")
+              .arg(setup.idle_pooled_connections));
+    } else {
+      stats_call_setup_value_->setText(
+          QString("池中 %1").arg(setup.idle_pooled_connections));
+    }
+  }
+
+  // 平均耗时 / 次数
+  auto format_average = [this](double avg_ms, int count) {
+    return count > 0 ? QString("%1 ms×%2").arg(FormatDouble(avg_ms, 0)).arg(count)
+                     : QString("—");
+  };
+  if (stats_call_setup_compare_value_) {
+    stats_call_setup_compare_value_->setText(
+        QString("%1 / %2").arg(format_average(setup.pooled_avg_ms, setup.pooled_count),
+                               format_average(setup.fresh_avg_ms, setup.fresh_count)));
+  }
+}
+
+void VideoCallWindow::UpdateStatsHistoryUI() {
+  // 最小 / 平均 / P95，来自后台采样的历史
+  constexpr int kWindowSeconds = 60;
+  const StatsSummary rtt = controller_->GetStatsSummary(StatsMetric::kRttMs, kWindowSeconds);
+  stats_rtt_window_value_->setText(
+      rtt.count > 0 ? QString("%1 / %2 / %3 ms")
+                          .arg(FormatDouble(rtt.min, 0), FormatDouble(rtt.avg, 0),
+                               FormatDouble(rtt.p95, 0))
+                    : QString("—"));
+  const StatsSummary outbound =
+      controller_->GetStatsSummary(StatsMetric::kOutboundBitrateKbps, kWindowSeconds);
+  stats_outbound_window_value_->setText(
+      outbound.count > 0 ? QString("%1 / %2 / %3")
+                               .arg(FormatBitrate(outbound.min), FormatBitrate(outbound.avg),
+                                    FormatBitrate(outbound.p95))
+                         : QString("—"));
+}
+
+void VideoCallWindow::UpdateFileTransferLabel() {
+  if (file_transfers_.empty()) {
+    file_transfer_label_->clear();
+    return;
+  }
+  // 单个文件显示名称和进度，多个文件显示总进度；速率为各文件之和
+  uint64_t size = 0;
+  uint64_t transferred = 0;
+  double bytes_per_second = 0.0;
+  bool paused = true;
+  for (const auto& [key, progress] : file_transfers_) {
+    size += progress.size;
+    transferred += progress.transferred;
+    bytes_per_second += progress.bytes_per_second;
+    paused = paused && progress.state == FileTransferState::kPaused;
+  }
+  const double percent = size > 0 ? 100.0 * transferred / size : 100.0;
+  QString text;
+  if (file_transfers_.size() == 1) {
+    const FileTransferProgress& progress = file_transfers_.begin()->second;
+    text = QString("%1 %2 %3%")
+               .arg(progress.outgoing ? "发送" : "接收",
+                    QString::fromStdString(progress.name), FormatDouble(percent, 0));
+  } else {
+    text = QString("%1 个文件 %2%").arg(file_transfers_.size()).arg(FormatDouble(percent, 0));
+  }
+  text += paused ? QString("（已暂停）") : QString(" · %1").arg(FormatBitrate(bytes_per_second * 8.0 / 1000.0));
+  file_transfer_label_->setText(text);
+}
+
+QString VideoCallWindow::FormatLatency(const RenderLatencyStats& latency) const {
+  if (latency.count == 0) {
+    return "—";
+  }
+  // p50 / p95 毫秒
+  return QString("%1 / %2 ms")
+      .arg(FormatDouble(latency.p50_ms, 1), FormatDouble(latency.p95_ms, 1));
 }
 
 QString VideoCallWindow::FormatBitrate(double kbps) const {
@@ -681,6 +970,20 @@ QString VideoCallWindow::FormatBitrate(double kbps) const {
   return QString("%1 kbps").arg(FormatDouble(kbps, 1));
 }
 
+QString VideoCallWindow::FormatFileSize(uint64_t bytes) const {
+  const double value = static_cast<double>(bytes);
+  if (value >= 1024.0 * 1024.0 * 1024.0) {
+    return QString("%1 GB").arg(FormatDouble(value / (1024.0 * 1024.0 * 1024.0), 2));
+  }
+  if (value >= 1024.0 * 1024.0) {
+    return QString("%1 MB").arg(FormatDouble(value / (1024.0 * 1024.0), 1));
+  }
+  if (value >= 1024.0) {
+    return QString("%1 KB").arg(FormatDouble(value / 1024.0, 1));
+  }
+  return QString("%1 B").arg(bytes);
+}
+
 QString VideoCallWindow::FormatPercentage(double value) const {
   if (!std::isfinite(value) || value < 0.0) {
     return "—";
@@ -761,3 +1064,45 @@ void VideoCallWindow::resizeEvent(QResizeEvent* event) {
   QMainWindow::resizeEvent(event);
   LayoutLocalVideo();
 }
+
+void VideoCallWindow::changeEvent(QEvent* event) {
+  QMainWindow::changeEvent(event);
+  if (event->type() == QEvent::WindowStateChange) {
+    UpdateRendererOcclusion();
+  }
+}
+
+void VideoCallWindow::showEvent(QShowEvent* event) {
+  QMainWindow::showEvent(event);
+  // 窗口句柄在首次显示后才存在
+  if (!watching_expose_ && windowHandle()) {
+    windowHandle()->installEventFilter(this);
+    watching_expose_ = true;
+  }
+  UpdateRendererOcclusion();
+}
+
+void VideoCallWindow::hideEvent(QHideEvent* event) {
+  QMainWindow::hideEvent(event);
+  UpdateRendererOcclusion();
+}
+
+bool VideoCallWindow::eventFilter(QObject* watched, QEvent* event) {
+  if (watched == windowHandle() && event->type() == QEvent::Expose) {
+    UpdateRendererOcclusion();
+  }
+  return QMainWindow::eventFilter(watched, event);
+}
+
+void VideoCallWindow::UpdateRendererOcclusion() {
+  // 最小化、隐藏或窗口系统报告不可见时，渲染器与轨道断开，不再接收和处理帧
+  const QWindow* window = windowHandle();
+  const bool occluded = !isVisible() || isMinimized() ||
+                        (window && !window->isExposed());
+  if (local_renderer_) {
+    local_renderer_->SetOccluded(occluded);
+  }
+  if (remote_renderer_) {
+    remote_renderer_->SetOccluded(occluded);
+  }
+}
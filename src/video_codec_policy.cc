@@ -0,0 +1,147 @@
+#include "video_codec_policy.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace {
+
+struct CodecCost {
+  const char* name;
+  double cpu_percent;
+};
+
+// Software encoders in this build: OpenH264, libvpx and libaom
+constexpr CodecCost kCodecCosts[] = {
+    {"H264", 20.0},
+    {"VP8", 25.0},
+    {"VP9", 45.0},
+    {"AV1", 90.0},
+};
+
+std::string ToUpper(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+    return static_cast<char>(std::toupper(c));
+  });
+  return text;
+}
+
+bool IsAuxiliaryCodec(const std::string& upper_name) {
+  return upper_name == "RTX" || upper_name == "RED" ||
+         upper_name == "ULPFEC" || upper_name == "FLEXFEC-03";
+}
+
+}  // namespace
+
+double EstimatedEncoderCpuPercent(const std::string& codec_name) {
+  const std::string upper_name = ToUpper(codec_name);
+  double most_expensive = 0.0;
+  for (const CodecCost& cost : kCodecCosts) {
+    if (upper_name == cost.name) {
+      return cost.cpu_percent;
+    }
+    most_expensive = std::max(most_expensive, cost.cpu_percent);
+  }
+  return most_expensive;
+}
+
+std::set<std::string> ParseVideoCodecNames(const std::string& sdp) {
+  std::set<std::string> names;
+  std::istringstream lines(sdp);
+  std::string line;
+  bool in_video = false;
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.compare(0, 2, "m=") == 0) {
+      in_video = line.compare(0, 8, "m=video ") == 0;
+      continue;
+    }
+    // a=rtpmap:<payload type> <name>/<clock rate>[/<channels>]
+    if (!in_video || line.compare(0, 9, "a=rtpmap:") != 0) {
+      continue;
+    }
+    const size_t name_start = line.find(' ');
+    if (name_start == std::string::npos) {
+      continue;
+    }
+    const size_t name_end = line.find('/', name_start + 1);
+    names.insert(ToUpper(line.substr(name_start + 1, name_end - name_start - 1)));
+  }
+  return names;
+}
+
+std::vector<webrtc::RtpCodecCapability> SelectVideoCodecs(
+    const std::vector<webrtc::RtpCodecCapability>& capabilities,
+    const VideoCodecPolicy& policy,
+    double current_cpu_percent,
+    const std::set<std::string>* remote_codecs) {
+  // Distinct media codec names, in factory order, that the remote can take
+  std::vector<std::string> names;
+  for (const auto& codec : capabilities) {
+    const std::string upper_name = ToUpper(codec.name);
+    if (IsAuxiliaryCodec(upper_name) ||
+        std::find(names.begin(), names.end(), upper_name) != names.end()) {
+      continue;
+    }
+    if (remote_codecs && !remote_codecs->empty() &&
+        remote_codecs->count(upper_name) == 0) {
+      continue;
+    }
+    names.push_back(upper_name);
+  }
+
+  if (policy.cpu_budget_percent > 0.0 && !names.empty()) {
+    const double headroom = policy.cpu_budget_percent - current_cpu_percent;
+    std::vector<std::string> affordable;
+    for (const std::string& name : names) {
+      if (EstimatedEncoderCpuPercent(name) <= headroom) {
+        affordable.push_back(name);
+      }
+    }
+    if (affordable.empty()) {
+      affordable.push_back(*std::min_element(
+          names.begin(), names.end(),
+          [](const std::string& a, const std::string& b) {
+            return EstimatedEncoderCpuPercent(a) < EstimatedEncoderCpuPercent(b);
+          }));
+    }
+    names = std::move(affordable);
+  }
+  if (names.empty()) {
+    return {};
+  }
+
+  // Preferred codecs first, the rest keep their factory order
+  std::vector<std::string> order;
+  for (const std::string& preferred : policy.preferred_order) {
+    const std::string upper_name = ToUpper(preferred);
+    if (std::find(names.begin(), names.end(), upper_name) != names.end() &&
+        std::find(order.begin(), order.end(), upper_name) == order.end()) {
+      order.push_back(upper_name);
+    }
+  }
+  for (const std::string& name : names) {
+    if (std::find(order.begin(), order.end(), name) == order.end()) {
+      order.push_back(name);
+    }
+  }
+
+  // Every capability entry of each codec (H264 has several profiles),
+  // then RTX/RED/FEC so retransmission and FEC stay negotiable
+  std::vector<webrtc::RtpCodecCapability> selected;
+  for (const std::string& name : order) {
+    for (const auto& codec : capabilities) {
+      if (ToUpper(codec.name) == name) {
+        selected.push_back(codec);
+      }
+    }
+  }
+  for (const auto& codec : capabilities) {
+    if (IsAuxiliaryCodec(ToUpper(codec.name))) {
+      selected.push_back(codec);
+    }
+  }
+  return selected;
+}
@@ -11,18 +11,26 @@
 #undef QT_NO_EMIT_DEFINED
 #endif
 
+#include <utility>
+
+#include "rtc_base/time_utils.h"
+
 #include <QPainter>
 #include <QPaintEvent>
+#include <QRegion>
+#include <QResizeEvent>
+#include <QScreen>
+
+namespace {
 
-#include "api/video/i420_buffer.h"
-#include "api/video/video_frame_buffer.h"
-#include "api/video/video_rotation.h"
-#include "third_party/libyuv/include/libyuv/convert_argb.h"
+// Enough idle backing stores for a couple of 1080p sizes.
+constexpr size_t kImagePoolBudgetBytes = 24 * 1024 * 1024;
+
+}  // namespace
 
 VideoRenderer::VideoRenderer(QWidget* parent)
     : QWidget(parent),
-      width_(0),
-      height_(0) {
+      image_pool_(kImagePoolBudgetBytes) {
   setAttribute(Qt::WA_OpaquePaintEvent);
   setMinimumSize(160, 120);
   
@@ -42,9 +50,11 @@ void VideoRenderer::SetVideoTrack(webrtc::VideoTrackInterface* track_to_render)
   }
   
   rendered_track_ = track_to_render;
+  sink_wants_ = DesiredSinkWants();
+  discontinuity_.store(true, std::memory_order_release);
   
-  if (rendered_track_) {
-    rendered_track_->AddOrUpdateSink(this, webrtc::VideoSinkWants());
+  if (rendered_track_ && !occluded_) {
+    rendered_track_->AddOrUpdateSink(this, sink_wants_);
   }
 }
 
@@ -52,79 +62,259 @@ void VideoRenderer::Stop() {
   SetVideoTrack(nullptr);
 }
 
-void VideoRenderer::OnFrame(const webrtc::VideoFrame& video_frame) {
-  QMutexLocker lock(&mutex_);
-  
-  webrtc::scoped_refptr<webrtc::I420BufferInterface> buffer(
-      video_frame.video_frame_buffer()->ToI420());
-  
-  if (video_frame.rotation() != webrtc::kVideoRotation_0) {
-    buffer = webrtc::I420Buffer::Rotate(*buffer, video_frame.rotation());
+void VideoRenderer::SetAdaptiveSinkWants(bool enabled) {
+  adaptive_sink_wants_ = enabled;
+  UpdateSinkWants();
+}
+
+webrtc::VideoSinkWants VideoRenderer::DesiredSinkWants() const {
+  webrtc::VideoSinkWants wants;
+  if (!adaptive_sink_wants_ || size().isEmpty()) {
+    return wants;
   }
 
-  int width = buffer->width();
-  int height = buffer->height();
+  const qreal dpr = devicePixelRatioF();
+  wants.max_pixel_count = qRound(width() * dpr) * qRound(height() * dpr);
+  if (const QScreen* display = screen()) {
+    const int refresh_rate = qRound(display->refreshRate());
+    if (refresh_rate > 0) {
+      wants.max_framerate_fps = refresh_rate;
+    }
+  }
+  return wants;
+}
+
+void VideoRenderer::UpdateSinkWants() {
+  const webrtc::VideoSinkWants wants = DesiredSinkWants();
+
+  QMutexLocker lock(&mutex_);
+  if (wants.max_pixel_count == sink_wants_.max_pixel_count &&
+      wants.max_framerate_fps == sink_wants_.max_framerate_fps) {
+    return;
+  }
+  sink_wants_ = wants;
+  if (rendered_track_ && !occluded_) {
+    rendered_track_->AddOrUpdateSink(this, sink_wants_);
+  }
+}
 
-  if (width != width_ || height != height_) {
-    SetSize(width, height);
+void VideoRenderer::SetOccluded(bool occluded) {
+  QMutexLocker lock(&mutex_);
+  if (occluded_ == occluded) {
+    return;
+  }
+  occluded_ = occluded;
+  if (!rendered_track_) {
+    return;
   }
 
-  if (image_.isNull()) {
+  if (occluded) {
+    rendered_track_->RemoveSink(this);
     return;
   }
+  discontinuity_.store(true, std::memory_order_release);
+  rendered_track_->AddOrUpdateSink(this, sink_wants_);
+  // Don't show the stale frame from before we were hidden until the source
+  // happens to deliver the next one
+  if (webrtc::VideoTrackSourceInterface* source =
+          rendered_track_->GetSource()) {
+    source->RequestRefreshFrame();
+  }
+}
 
-  // Convert I420 to ARGB
-  libyuv::I420ToARGB(buffer->DataY(), buffer->StrideY(),
-                     buffer->DataU(), buffer->StrideU(),
-                     buffer->DataV(), buffer->StrideV(),
-                     image_.bits(), image_.bytesPerLine(),
-                     width, height);
+void VideoRenderer::OnFrame(const webrtc::VideoFrame& video_frame) {
+  // Only keep a reference; conversion happens when the frame is painted
+  QueuedFrame& slot = frames_.back();
+  slot.frame = video_frame;
+  slot.arrival_us = webrtc::TimeMicros();
+  slot.sequence = ++next_sequence_;
+  slot.discontinuity =
+      discontinuity_.exchange(false, std::memory_order_acq_rel);
+  frames_.Publish();
+  frames_received_.fetch_add(1, std::memory_order_relaxed);
 
-  // Emit signal to update UI in main thread
-  emit FrameReceived();
+  // Emit signal to update UI in main thread, unless one is already queued
+  if (!repaint_pending_.exchange(true, std::memory_order_acq_rel)) {
+    emit FrameReceived();
+  }
 }
 
 void VideoRenderer::OnFrameReceived() {
-  update();
+  repaint_pending_.store(false, std::memory_order_release);
+
+  // Pick up the newest frame; never blocks OnFrame. Frames that arrived in
+  // between were replaced without being converted.
+  if (!frames_.Consume()) {
+    return;
+  }
+  const QueuedFrame& queued = frames_.front();
+  const webrtc::VideoFrame& frame = *queued.frame;
+
+  // An update rect only describes the change from the frame right before
+  // it, so it can be used only if no frame was skipped or missed since the
+  // one already in image_, and nothing about the geometry changed
+  const bool contiguous =
+      !queued.discontinuity && queued.sequence == last_sequence_ + 1;
+  last_sequence_ = queued.sequence;
+  if (full_conversion_pending_ || !contiguous || !frame.has_update_rect() ||
+      frame.rotation() != webrtc::kVideoRotation_0 ||
+      QSize(frame.width(), frame.height()) != converted_frame_size_) {
+    full_conversion_pending_ = true;
+    frame_unpainted_ = true;
+    update();
+    return;
+  }
+
+  const webrtc::VideoFrame::UpdateRect& changed = frame.update_rect();
+  if (changed.IsEmpty()) {
+    // Identical content, e.g. a zero-hertz repeat; nothing to redraw
+    return;
+  }
+  dirty_region_.Union(changed);
+  frame_unpainted_ = true;
+
+  // Repaint only the widget area the change maps to. A scaled image also
+  // changes one frame pixel around it (the scale filter's taps), plus a
+  // pixel for rounding
+  const double scale_x =
+      static_cast<double>(draw_rect_.width()) / frame.width();
+  const double scale_y =
+      static_cast<double>(draw_rect_.height()) / frame.height();
+  const QRectF changed_rect(draw_rect_.x() + (changed.offset_x - 1) * scale_x,
+                            draw_rect_.y() + (changed.offset_y - 1) * scale_y,
+                            (changed.width + 2) * scale_x,
+                            (changed.height + 2) * scale_y);
+  update(changed_rect.toAlignedRect().adjusted(-1, -1, 1, 1));
+}
+
+RenderStatsSnapshot VideoRenderer::TakeRenderStats() {
+  RenderStatsSnapshot snapshot = stats_.TakeSnapshot(
+      frames_received_.load(std::memory_order_relaxed),
+      frames_.overwritten_count(), webrtc::TimeMicros());
+  snapshot.image_pool_hits = image_pool_.hits();
+  snapshot.image_pool_misses = image_pool_.misses();
+  snapshot.image_pool_evictions = image_pool_.evictions();
+  snapshot.image_pool_idle_bytes = image_pool_.idle_bytes();
+  return snapshot;
+}
+
+void VideoRenderer::ConvertFrame(const webrtc::VideoFrame& video_frame,
+                                 const QSize& size) {
+  SetSize(size.width(), size.height());
+
+  if (image_.isNull()) {
+    return;
+  }
+
+  // Scale in YUV space and convert straight into the target-sized image
+  const int64_t start_us = webrtc::TimeMicros();
+  if (!converter_.ConvertToArgb(video_frame, image_.bits(),
+                                image_.bytesPerLine(), image_.width(),
+                                image_.height())) {
+    image_pool_.Release(std::move(image_));
+    image_ = QImage();
+    return;
+  }
+  stats_.AddConversion(webrtc::TimeMicros() - start_us);
+}
+
+void VideoRenderer::ConvertRegion(
+    const webrtc::VideoFrame& video_frame,
+    const webrtc::VideoFrame::UpdateRect& region) {
+  // image_ still holds the previous frame; overwrite only what changed
+  const int64_t start_us = webrtc::TimeMicros();
+  if (!converter_.ConvertRegionToArgb(video_frame, region, image_.bits(),
+                                      image_.bytesPerLine(), image_.width(),
+                                      image_.height())) {
+    ConvertFrame(video_frame, image_.size());
+    return;
+  }
+  stats_.AddConversion(webrtc::TimeMicros() - start_us);
 }
 
 void VideoRenderer::SetSize(int width, int height) {
-  if (width == width_ && height == height_) {
+  if (image_.width() == width && image_.height() == height) {
     return;
   }
 
-  width_ = width;
-  height_ = height;
+  // Resolution changes tend to flip between a few sizes; keep the old
+  // backing store around instead of freeing it
+  image_pool_.Release(std::move(image_));
+  image_ = image_pool_.Acquire(QSize(width, height));
+}
+
+QRect VideoRenderer::LetterboxRect(int frame_width, int frame_height) const {
+  QRect target = rect();
+  if (frame_width <= 0 || frame_height <= 0 || target.isEmpty()) {
+    return QRect();
+  }
+
+  // Calculate aspect ratio to maintain video proportions
+  double widget_aspect = static_cast<double>(target.width()) / target.height();
+  double video_aspect = static_cast<double>(frame_width) / frame_height;
+
+  if (widget_aspect > video_aspect) {
+    // Widget is wider than video
+    int draw_width = static_cast<int>(target.height() * video_aspect);
+    int x_offset = (target.width() - draw_width) / 2;
+    return QRect(x_offset, 0, draw_width, target.height());
+  }
+  // Widget is taller than video
+  int draw_height = static_cast<int>(target.width() / video_aspect);
+  int y_offset = (target.height() - draw_height) / 2;
+  return QRect(0, y_offset, target.width(), draw_height);
+}
 
-  image_ = QImage(width_, height_, QImage::Format_ARGB32);
+void VideoRenderer::resizeEvent(QResizeEvent* event) {
+  QWidget::resizeEvent(event);
+  UpdateSinkWants();
 }
 
 void VideoRenderer::paintEvent(QPaintEvent* event) {
-  QMutexLocker lock(&mutex_);
-  
-  QPainter painter(this);
-  painter.fillRect(rect(), Qt::black);
-
-  if (!image_.isNull()) {
-    QRect target = rect();
-    
-    // Calculate aspect ratio to maintain video proportions
-    double widget_aspect = static_cast<double>(target.width()) / target.height();
-    double video_aspect = static_cast<double>(image_.width()) / image_.height();
-    
-    QRect draw_rect;
-    if (widget_aspect > video_aspect) {
-      // Widget is wider than video
-      int draw_width = static_cast<int>(target.height() * video_aspect);
-      int x_offset = (target.width() - draw_width) / 2;
-      draw_rect = QRect(x_offset, 0, draw_width, target.height());
-    } else {
-      // Widget is taller than video
-      int draw_height = static_cast<int>(target.width() / video_aspect);
-      int y_offset = (target.height() - draw_height) / 2;
-      draw_rect = QRect(0, y_offset, target.width(), draw_height);
+  // The frame to show was picked up by OnFrameReceived
+  const QueuedFrame& queued = frames_.front();
+  const std::optional<webrtc::VideoFrame>& frame = queued.frame;
+  const bool new_frame = frame_unpainted_;
+  frame_unpainted_ = false;
+
+  if (frame) {
+    QRect draw_rect = LetterboxRect(FrameConverter::RotatedWidth(*frame),
+                                    FrameConverter::RotatedHeight(*frame));
+    const qreal dpr = devicePixelRatioF();
+    QSize target_size(qRound(draw_rect.width() * dpr),
+                      qRound(draw_rect.height() * dpr));
+    if (!draw_rect.isEmpty()) {
+      // Re-convert fully when the frame can't be patched, or when a resize
+      // changed the target size; otherwise only the dirty region
+      if (full_conversion_pending_ || image_.isNull() ||
+          image_.size() != target_size) {
+        ConvertFrame(*frame, target_size);
+        image_.setDevicePixelRatio(dpr);
+      } else if (!dirty_region_.IsEmpty()) {
+        ConvertRegion(*frame, dirty_region_);
+      }
+      full_conversion_pending_ = image_.isNull();
+      dirty_region_ = webrtc::VideoFrame::UpdateRect{0, 0, 0, 0};
+      converted_frame_size_ = QSize(frame->width(), frame->height());
     }
-    
-    painter.drawImage(draw_rect, image_);
+    draw_rect_ = draw_rect;
+  }
+
+  QPainter painter(this);
+
+  if (image_.isNull() || draw_rect_.isEmpty()) {
+    painter.fillRect(rect(), Qt::black);
+    return;
+  }
+
+  // Only the letterbox bars need clearing; the image covers the rest
+  for (const QRect& bar : QRegion(rect()).subtracted(draw_rect_)) {
+    painter.fillRect(bar, Qt::black);
+  }
+  painter.drawImage(draw_rect_.topLeft(), image_);
+
+  if (new_frame) {
+    stats_.AddPaintedFrame(queued.arrival_us, frame->timestamp_us(),
+                           webrtc::TimeMicros());
   }
 }
@@ -4,17 +4,23 @@
 
 #include "webrtcengine.h"
 
+#include <algorithm>
+#include <atomic>
 #include <utility>
 #include <optional>
 
+#include "absl/strings/match.h"
 #include "api/audio_codecs/builtin_audio_decoder_factory.h"
 #include "api/audio_codecs/builtin_audio_encoder_factory.h"
 #include "api/audio_options.h"
 #include "api/create_modular_peer_connection_factory.h"
+#include "api/data_channel_interface.h"
 #include "api/enable_media.h"
 #include "api/jsep.h"
 #include "api/make_ref_counted.h"
+#include "api/rtp_transceiver_interface.h"
 #include "api/test/create_frame_generator.h"
+#include "api/units/time_delta.h"
 #include "api/video_codecs/video_decoder_factory_template.h"
 #include "api/video_codecs/video_decoder_factory_template_dav1d_adapter.h"
 #include "api/video_codecs/video_decoder_factory_template_libvpx_vp8_adapter.h"
@@ -30,6 +36,9 @@
 #include "rtc_base/checks.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/ref_counted_object.h"
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/ssl_identity.h"
+#include "rtc_base/time_utils.h"
 #include "api/stats/rtc_stats_collector_callback.h"
 #include "system_wrappers/include/clock.h"
 #include "test/frame_generator.h"
@@ -42,6 +51,9 @@ namespace {
 
 using webrtc::test::TestVideoCapturer;
 
+// 创建连接后立即预收集的 ICE 候选集数量(BUNDLE 下一组即可)
+constexpr int kIceCandidatePoolSize = 1;
+
 // 设置远程描述的观察者
 class SetRemoteDescriptionObserver
     : public webrtc::SetRemoteDescriptionObserverInterface {
@@ -86,6 +98,26 @@ class SetLocalDescriptionObserver
   std::function<void(webrtc::RTCError)> callback_;
 };
 
+// 在 |thread| 上把放置配置应用到它自己
+void PlaceThread(webrtc::Thread* thread, const ThreadPlacement& placement) {
+  if (placement.empty()) {
+    return;
+  }
+  const bool applied = thread->BlockingCall([&placement] {
+    return ApplyThreadPlacement(placement);
+  });
+  RTC_LOG(LS_INFO) << "Thread " << thread->name() << " placed on "
+                   << ThreadPlacementToString(placement)
+                   << (applied ? "" : " (partially failed)");
+}
+
+// 在 |thread| 上取得它自己的 CPU 时钟，之后读取不必再切到该线程
+void BindCpuClock(webrtc::Thread* thread, ThreadCpuClock* clock) {
+  if (!thread->BlockingCall([clock] { return clock->BindToCurrentThread(); })) {
+    RTC_LOG(LS_WARNING) << "No CPU clock for thread " << thread->name();
+  }
+}
+
 // 创建视频捕获器
 std::unique_ptr<TestVideoCapturer> CreateCapturer(
     webrtc::TaskQueueFactory& task_queue_factory) {
@@ -139,6 +171,13 @@ class CapturerTrackSource : public webrtc::VideoTrackSource {
     }
   }
 
+  // 渲染器重新可见时请求立即补发一帧
+  void RequestRefreshFrame() override {
+    if (capturer_) {
+      capturer_->RequestRefreshFrame();
+    }
+  }
+
  protected:
   explicit CapturerTrackSource(std::unique_ptr<TestVideoCapturer> capturer)
       : VideoTrackSource(/*remote=*/false), capturer_(std::move(capturer)) {}
@@ -157,58 +196,159 @@ class CapturerTrackSource : public webrtc::VideoTrackSource {
 // 内部观察者类实现
 // ============================================================================
 
-// PeerConnectionObserver的内部实现
+// PeerConnectionObserver的内部实现 - 每个会话一个，事件带上对端ID转发给引擎
 class WebRTCEngine::PeerConnectionObserverImpl : public webrtc::PeerConnectionObserver {
  public:
-  explicit PeerConnectionObserverImpl(WebRTCEngine* engine) : engine_(engine) {}
+  // 预热池中的连接以 active=false 创建，取用时再 Activate()，
+  // 避免闲置连接关闭时的状态变化被当成当前通话的事件
+  PeerConnectionObserverImpl(WebRTCEngine* engine,
+                             const std::string& peer_id,
+                             std::weak_ptr<PeerSession> session,
+                             bool active = true)
+      : engine_(engine), peer_id_(peer_id), session_(std::move(session)), active_(active) {}
+  
+  // 对端ID和会话在激活前写入，激活后只读
+  void Activate(const std::string& peer_id, std::weak_ptr<PeerSession> session) {
+    peer_id_ = peer_id;
+    session_ = std::move(session);
+    active_.store(true, std::memory_order_release);
+  }
   
   void OnSignalingChange(webrtc::PeerConnectionInterface::SignalingState new_state) override {}
   void OnAddTrack(webrtc::scoped_refptr<webrtc::RtpReceiverInterface> receiver,
                   const std::vector<webrtc::scoped_refptr<webrtc::MediaStreamInterface>>& streams) override {
-    engine_->OnPeerConnectionAddTrack(receiver.get());
+    if (active()) {
+      engine_->OnPeerConnectionAddTrack(peer_id_, receiver.get());
+    }
   }
   void OnRemoveTrack(webrtc::scoped_refptr<webrtc::RtpReceiverInterface> receiver) override {
-    engine_->OnPeerConnectionRemoveTrack(receiver.get());
+    if (active()) {
+      engine_->OnPeerConnectionRemoveTrack(peer_id_, receiver.get());
+    }
+  }
+  void OnDataChannel(webrtc::scoped_refptr<webrtc::DataChannelInterface> channel) override {
+    if (active()) {
+      engine_->OnPeerConnectionDataChannel(peer_id_, std::move(channel));
+    }
   }
-  void OnDataChannel(webrtc::scoped_refptr<webrtc::DataChannelInterface> channel) override {}
   void OnRenegotiationNeeded() override {}
   void OnIceConnectionChange(webrtc::PeerConnectionInterface::IceConnectionState new_state) override {
-    engine_->OnPeerConnectionIceConnectionChange(new_state);
+    if (active()) {
+      engine_->OnPeerConnectionIceConnectionChange(peer_id_, session_.lock(), new_state);
+    }
+  }
+  void OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringState new_state) override {
+    if (active()) {
+      engine_->OnPeerConnectionIceGatheringChange(peer_id_, new_state);
+    }
   }
-  void OnIceGatheringChange(webrtc::PeerConnectionInterface::IceGatheringState new_state) override {}
   void OnIceCandidate(const webrtc::IceCandidate* candidate) override {
-    engine_->OnPeerConnectionIceCandidate(candidate);
+    if (active()) {
+      engine_->OnPeerConnectionIceCandidate(peer_id_, candidate);
+    }
   }
   void OnIceConnectionReceivingChange(bool receiving) override {}
   void OnIceCandidateRemoved(const webrtc::IceCandidate* candidate) override {}
   
+ private:
+  bool active() const { return active_.load(std::memory_order_acquire); }
+  
+  WebRTCEngine* engine_;
+  std::string peer_id_;
+  // 会话持有观察者，这里只能弱引用
+  std::weak_ptr<PeerSession> session_;
+  std::atomic<bool> active_;
+};
+
+// DataChannelObserver的内部实现 - 每个数据通道一个，在信令线程回调
+class WebRTCEngine::DataChannelObserverImpl : public webrtc::DataChannelObserver {
+ public:
+  DataChannelObserverImpl(WebRTCEngine* engine,
+                          const std::string& peer_id,
+                          webrtc::DataChannelInterface* channel)
+      : engine_(engine), peer_id_(peer_id), label_(channel->label()), channel_(channel) {}
+  
+  void OnStateChange() override {
+    const auto state = channel_->state();
+    RTC_LOG(LS_INFO) << "Data channel " << label_ << " with " << peer_id_ << ": "
+                     << webrtc::DataChannelInterface::DataStateString(state);
+    if (engine_->observer_) {
+      engine_->observer_->OnDataChannelStateChanged(peer_id_, label_, state);
+    }
+  }
+  void OnMessage(const webrtc::DataBuffer& buffer) override {
+    if (engine_->observer_) {
+      engine_->observer_->OnDataChannelMessage(peer_id_, label_, buffer.data, buffer.binary);
+    }
+  }
+  void OnBufferedAmountChange(uint64_t sent_data_size) override {
+    if (engine_->observer_) {
+      engine_->observer_->OnDataChannelBufferedAmountChange(peer_id_, label_, sent_data_size);
+    }
+  }
+  
  private:
   WebRTCEngine* engine_;
+  const std::string peer_id_;
+  const std::string label_;
+  // 通道持有登记表里的引用，比观察者活得久
+  webrtc::DataChannelInterface* channel_;
+};
+
+// 单个对端的会话：连接、观察者和尚未应用的远端候选
+// 由 sessions_ 和进行中的异步回调共同持有，关闭后回调仍可安全访问
+struct WebRTCEngine::PeerSession {
+  std::string peer_id;
+  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection;
+  std::unique_ptr<PeerConnectionObserverImpl> observer;
+  bool pooled = false;
+  bool will_offer = true;  // 主叫：可以发起同播，负责 ICE 重启
+  
+  // ICE 中断恢复状态，只在信令线程访问
+  int64_t ice_interrupted_ms = 0;  // 本次中断开始的时间，0 表示未中断
+  int ice_restart_attempts = 0;
+  int64_t ice_last_restart_ms = 0;
+  uint64_t ice_restart_generation = 0;  // 递增以作废已排队的重启
+  bool ice_restart_offer_pending = false;  // 重启 offer 已发出，尚未连通
+  
+  // SetVideoSendLimits 在调用线程写，ApplyVideoSendLayers 在信令线程读
+  webrtc::Mutex limits_mutex;
+  std::optional<VideoSendLimits> video_limits RTC_GUARDED_BY(limits_mutex);
+  
+  // AddIceCandidate 在调用线程、SetRemoteDescription 回调在信令线程
+  webrtc::Mutex candidates_mutex;
+  std::deque<std::unique_ptr<webrtc::IceCandidate>> pending_ice_candidates
+      RTC_GUARDED_BY(candidates_mutex);
 };
 
 // CreateSessionDescriptionObserver的内部实现
 class WebRTCEngine::CreateSessionDescriptionObserverImpl : public webrtc::CreateSessionDescriptionObserver {
  public:
   static webrtc::scoped_refptr<CreateSessionDescriptionObserverImpl> Create(
-      WebRTCEngine* engine, bool is_offer) {
-    return webrtc::make_ref_counted<CreateSessionDescriptionObserverImpl>(engine, is_offer);
+      WebRTCEngine* engine, std::shared_ptr<PeerSession> session, bool is_offer) {
+    return webrtc::make_ref_counted<CreateSessionDescriptionObserverImpl>(
+        engine, std::move(session), is_offer);
   }
   
-  explicit CreateSessionDescriptionObserverImpl(WebRTCEngine* engine, bool is_offer)
-      : engine_(engine), is_offer_(is_offer) {}
+  CreateSessionDescriptionObserverImpl(WebRTCEngine* engine,
+                                       std::shared_ptr<PeerSession> session,
+                                       bool is_offer)
+      : engine_(engine), session_(std::move(session)), is_offer_(is_offer) {}
   
   void OnSuccess(webrtc::SessionDescriptionInterface* desc) override {
-    RTC_LOG(LS_INFO) << "=== CreateSessionDescriptionObserver::OnSuccess called, is_offer: " << is_offer_ << " ===";
-    engine_->OnSessionDescriptionSuccess(desc, is_offer_);
+    RTC_LOG(LS_INFO) << "=== CreateSessionDescriptionObserver::OnSuccess called, peer: "
+                     << session_->peer_id << " is_offer: " << is_offer_ << " ===";
+    engine_->OnSessionDescriptionSuccess(session_, desc, is_offer_);
   }
   
   void OnFailure(webrtc::RTCError error) override {
     RTC_LOG(LS_ERROR) << "=== CreateSessionDescriptionObserver::OnFailure called: " << error.message() << " ===";
-    engine_->OnSessionDescriptionFailure(error.message());
+    engine_->OnSessionDescriptionFailure(session_->peer_id, error.message());
   }
   
  private:
   WebRTCEngine* engine_;
+  std::shared_ptr<PeerSession> session_;
   bool is_offer_;
 };
 
@@ -234,7 +374,7 @@ class WebRTCEngine::StatsCollectorCallback : public webrtc::RTCStatsCollectorCal
 // ============================================================================
 
 WebRTCEngine::WebRTCEngine(const webrtc::Environment& env)
-    : env_(env), observer_(nullptr), is_creating_offer_(false) {
+    : env_(env), observer_(nullptr) {
 }
 
 WebRTCEngine::~WebRTCEngine() {
@@ -245,9 +385,43 @@ void WebRTCEngine::SetObserver(WebRTCEngineObserver* observer) {
   observer_ = observer;
 }
 
+void WebRTCEngine::SetThreadConfig(const EngineThreadConfig& config) {
+  RTC_DCHECK(!peer_connection_factory_);
+  thread_config_ = config;
+}
+
+std::vector<WebRTCEngine::ThreadCpuTime> WebRTCEngine::GetThreadCpuTimes() const {
+  std::vector<ThreadCpuTime> times;
+  auto sample = [&times](webrtc::Thread* thread, const ThreadCpuClock& clock,
+                         const char* name, const ThreadPlacement& placement) {
+    if (!thread) {
+      return;
+    }
+    const int64_t cpu_time_ns = clock.CpuTimeNanos();
+    if (cpu_time_ns < 0) {
+      return;
+    }
+    ThreadCpuTime time;
+    time.name = name;
+    time.placement = ThreadPlacementToString(placement);
+    time.cpu_time_ns = cpu_time_ns;
+    times.push_back(std::move(time));
+  };
+  sample(signaling_thread_.get(), signaling_cpu_clock_, "signaling", thread_config_.signaling);
+  sample(network_thread_.get(), network_cpu_clock_, "network", thread_config_.network);
+  sample(worker_thread_.get(), worker_cpu_clock_, "worker", thread_config_.worker);
+  return times;
+}
+
 void WebRTCEngine::SetIceServers(const std::vector<IceServerConfig>& ice_servers) {
   ice_servers_ = ice_servers;
   RTC_LOG(LS_INFO) << "Updated ICE servers configuration, count: " << ice_servers_.size();
+  
+  // 池中连接是按旧的 ICE 配置建的，换成新配置重新预热
+  if (pool_target_size_ > 0) {
+    DrainPeerConnectionPool();
+    RefillPeerConnectionPool();
+  }
 }
 
 bool WebRTCEngine::Initialize() {
@@ -256,11 +430,44 @@ bool WebRTCEngine::Initialize() {
 
   if (!signaling_thread_) {
     signaling_thread_ = webrtc::Thread::CreateWithSocketServer();
+    signaling_thread_->SetName("signaling_thread", nullptr);
     signaling_thread_->Start();
+    PlaceThread(signaling_thread_.get(), thread_config_.signaling);
+    BindCpuClock(signaling_thread_.get(), &signaling_cpu_clock_);
+  }
+  
+  // 自建网络/工作线程，才能固定 CPU 并统计各自的 CPU 时间；
+  // 否则由工厂内部创建
+  if (thread_config_.dedicated_network_thread && !network_thread_) {
+    network_thread_ = webrtc::Thread::CreateWithSocketServer();
+    network_thread_->SetName("network_thread", nullptr);
+    network_thread_->Start();
+    PlaceThread(network_thread_.get(), thread_config_.network);
+    BindCpuClock(network_thread_.get(), &network_cpu_clock_);
+  }
+  if (thread_config_.dedicated_worker_thread && !worker_thread_) {
+    worker_thread_ = webrtc::Thread::Create();
+    worker_thread_->SetName("worker_thread", nullptr);
+    worker_thread_->Start();
+    PlaceThread(worker_thread_.get(), thread_config_.worker);
+    BindCpuClock(worker_thread_.get(), &worker_cpu_clock_);
+  }
+  if (!thread_config_.capture.empty() && !capture_task_queue_factory_) {
+    capture_task_queue_factory_ = CreatePlacedTaskQueueFactory(
+        env_.task_queue_factory(), thread_config_.capture);
+  }
+  
+  // 预热线程：证书生成和建连都在这里做，不占用信令线程和 UI 线程
+  if (!pool_thread_) {
+    pool_thread_ = webrtc::Thread::Create();
+    pool_thread_->SetName("pc_pool", nullptr);
+    pool_thread_->Start();
   }
 
   webrtc::PeerConnectionFactoryDependencies deps;
   deps.signaling_thread = signaling_thread_.get();
+  deps.network_thread = network_thread_.get();
+  deps.worker_thread = worker_thread_.get();
   deps.env = env_;
   deps.audio_encoder_factory = webrtc::CreateBuiltinAudioEncoderFactory();
   deps.audio_decoder_factory = webrtc::CreateBuiltinAudioDecoderFactory();
@@ -287,13 +494,143 @@ bool WebRTCEngine::Initialize() {
   }
 
   RTC_LOG(LS_INFO) << "WebRTC Engine initialized successfully";
+  RefillPeerConnectionPool();
   return true;
 }
+void WebRTCEngine::SetPeerConnectionPoolSize(int size) {
+  pool_target_size_ = std::max(size, 0);
+  RTC_LOG(LS_INFO) << "PeerConnection pool size: " << pool_target_size_;
+  
+  // 缩小时关闭多余的空闲连接
+  std::vector<PooledPeerConnection> surplus;
+  {
+    webrtc::MutexLock lock(&pool_mutex_);
+    while (static_cast<int>(pc_pool_.size()) > pool_target_size_) {
+      surplus.push_back(std::move(pc_pool_.back()));
+      pc_pool_.pop_back();
+    }
+  }
+  for (auto& entry : surplus) {
+    entry.peer_connection->Close();
+  }
+  
+  RefillPeerConnectionPool();
+}
 
-bool WebRTCEngine::CreatePeerConnection() {
-  RTC_DCHECK(peer_connection_factory_);
-  RTC_DCHECK(!peer_connection_);
+int WebRTCEngine::GetPooledPeerConnectionCount() const {
+  webrtc::MutexLock lock(&pool_mutex_);
+  return static_cast<int>(pc_pool_.size());
+}
+
+void WebRTCEngine::RefillPeerConnectionPool() {
+  if (!pool_thread_ || !peer_connection_factory_ || pool_target_size_ <= 0) {
+    return;
+  }
+  
+  const auto config = BuildRtcConfiguration();
+  const auto video_encodings = BuildVideoSendEncodings();
+  webrtc::MutexLock lock(&pool_mutex_);
+  int missing = pool_target_size_ - static_cast<int>(pc_pool_.size()) - pool_pending_;
+  for (; missing > 0; --missing) {
+    ++pool_pending_;
+    pool_thread_->PostTask([this, config, video_encodings, generation = pool_generation_]() {
+      WarmPeerConnection(config, video_encodings, generation);
+    });
+  }
+}
+
+void WebRTCEngine::WarmPeerConnection(
+    webrtc::PeerConnectionInterface::RTCConfiguration config,
+    std::vector<webrtc::RtpEncodingParameters> video_encodings,
+    uint64_t generation) {
+  RTC_DCHECK(pool_thread_->IsCurrent());
+  const int64_t start_ms = webrtc::TimeMillis();
+  
+  // 闲置连接不预收集候选：TURN 分配会过期且占用服务器资源，
+  // 取用时再通过 SetConfiguration 打开
+  config.ice_candidate_pool_size = 0;
+  
+  // DTLS 证书生成是建连最慢的一步，预先生成后通过配置传入
+  auto certificate = webrtc::RTCCertificateGenerator::GenerateCertificate(
+      webrtc::KeyParams::ECDSA(), std::nullopt);
+  if (certificate) {
+    config.certificates.push_back(certificate);
+  } else {
+    RTC_LOG(LS_WARNING) << "Pre-generating DTLS certificate failed, "
+                           "PeerConnection will generate its own";
+  }
+  
+  auto observer = std::make_unique<PeerConnectionObserverImpl>(
+      this, std::string(), std::weak_ptr<PeerSession>(), false);
+  webrtc::PeerConnectionDependencies pc_dependencies(observer.get());
+  auto error_or_peer_connection =
+      peer_connection_factory_->CreatePeerConnectionOrError(
+          config, std::move(pc_dependencies));
+  
+  webrtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection;
+  if (error_or_peer_connection.ok()) {
+    peer_connection = std::move(error_or_peer_connection.value());
+    
+    // 预先建好音视频收发器，通话时只需把本地轨道挂上去
+    webrtc::RtpTransceiverInit init;
+    init.direction = webrtc::RtpTransceiverDirection::kSendRecv;
+    init.stream_ids = {"stream_id"};
+    for (webrtc::MediaType media_type :
+         {webrtc::MediaType::VIDEO, webrtc::MediaType::AUDIO}) {
+      // 同播编码只能在建收发器时给出
+      init.send_encodings = media_type == webrtc::MediaType::VIDEO
+                                ? video_encodings
+                                : std::vector<webrtc::RtpEncodingParameters>();
+      auto transceiver = peer_connection->AddTransceiver(media_type, init);
+      if (!transceiver.ok()) {
+        RTC_LOG(LS_WARNING) << "Pre-adding transceiver failed: "
+                            << transceiver.error().message();
+      }
+    }
+  } else {
+    RTC_LOG(LS_ERROR) << "Pre-warming PeerConnection failed: "
+                      << error_or_peer_connection.error().message();
+  }
+  
+  bool stale = false;
+  size_t pool_size = 0;
+  {
+    webrtc::MutexLock lock(&pool_mutex_);
+    --pool_pending_;
+    stale = generation != pool_generation_;
+    if (peer_connection && !stale) {
+      pc_pool_.push_back({peer_connection, std::move(observer)});
+    }
+    pool_size = pc_pool_.size();
+  }
+  
+  if (peer_connection && stale) {
+    peer_connection->Close();
+    return;
+  }
+  if (peer_connection) {
+    RTC_LOG(LS_INFO) << "Pre-warmed PeerConnection ready in "
+                     << (webrtc::TimeMillis() - start_ms)
+                     << " ms, pooled: " << pool_size;
+  }
+}
 
+void WebRTCEngine::DrainPeerConnectionPool() {
+  std::deque<PooledPeerConnection> drained;
+  {
+    webrtc::MutexLock lock(&pool_mutex_);
+    ++pool_generation_;
+    drained.swap(pc_pool_);
+  }
+  for (auto& entry : drained) {
+    entry.peer_connection->Close();
+  }
+  if (!drained.empty()) {
+    RTC_LOG(LS_INFO) << "Discarded " << drained.size() << " pooled PeerConnections";
+  }
+}
+
+webrtc::PeerConnectionInterface::RTCConfiguration WebRTCEngine::BuildRtcConfiguration() const {
   webrtc::PeerConnectionInterface::RTCConfiguration config;
   config.sdp_semantics = webrtc::SdpSemantics::kUnifiedPlan;
   
@@ -333,31 +670,148 @@ bool WebRTCEngine::CreatePeerConnection() {
   // 启用 ICE 连续收集模式
   config.continual_gathering_policy = 
       webrtc::PeerConnectionInterface::GATHER_CONTINUALLY;
+  
+  // 不等 SetLocalDescription，连接一创建就开始 STUN/TURN 收集
+  config.ice_candidate_pool_size = kIceCandidatePoolSize;
+  return config;
+}
+
+std::shared_ptr<WebRTCEngine::PeerSession> WebRTCEngine::FindSession(
+    const std::string& peer_id) const {
+  auto it = sessions_.find(peer_id);
+  return it != sessions_.end() ? it->second : nullptr;
+}
+
+bool WebRTCEngine::CreatePeerConnection(const std::string& peer_id, bool will_offer) {
+  RTC_DCHECK(peer_connection_factory_);
+  if (sessions_.count(peer_id)) {
+    RTC_LOG(LS_WARNING) << "PeerConnection for " << peer_id << " already exists";
+    return true;
+  }
+
+  auto session = std::make_shared<PeerSession>();
+  session->peer_id = peer_id;
+  session->will_offer = will_offer;
+
+  // 优先取用预热好的连接，证书和收发器都已就绪
+  PooledPeerConnection pooled;
+  {
+    webrtc::MutexLock lock(&pool_mutex_);
+    if (!pc_pool_.empty()) {
+      pooled = std::move(pc_pool_.front());
+      pc_pool_.pop_front();
+    }
+  }
+  if (pooled.peer_connection) {
+    session->observer = std::move(pooled.observer);
+    session->observer->Activate(peer_id, session);
+    session->peer_connection = std::move(pooled.peer_connection);
+    session->pooled = true;
+    RTC_LOG(LS_INFO) << "PeerConnection for " << peer_id << " taken from pre-warmed pool";
+    
+    // 开始预收集 ICE 候选(只能在 SetLocalDescription 之前修改)
+    auto config = session->peer_connection->GetConfiguration();
+    config.ice_candidate_pool_size = kIceCandidatePoolSize;
+    auto error = session->peer_connection->SetConfiguration(config);
+    if (!error.ok()) {
+      RTC_LOG(LS_WARNING) << "Enabling ICE candidate pool failed: " << error.message();
+    }
+    
+    // 远端 offer 只会复用 AddTrack 建的收发器，停掉预建的，
+    // 让 AddTracks() 走 AddTrack，它们在协商后被移除
+    if (!will_offer) {
+      for (const auto& transceiver : session->peer_connection->GetTransceivers()) {
+        if (!transceiver->mid()) {
+          transceiver->StopStandard();
+        }
+      }
+    }
+    sessions_[peer_id] = std::move(session);
+    return true;
+  }
+
+  const auto config = BuildRtcConfiguration();
 
   // 创建并保存内部观察者 - 必须保持存活!
-  pc_observer_ = std::make_unique<PeerConnectionObserverImpl>(this);
-  webrtc::PeerConnectionDependencies pc_dependencies(pc_observer_.get());
+  session->observer = std::make_unique<PeerConnectionObserverImpl>(this, peer_id, session);
+  webrtc::PeerConnectionDependencies pc_dependencies(session->observer.get());
   auto error_or_peer_connection =
       peer_connection_factory_->CreatePeerConnectionOrError(
           config, std::move(pc_dependencies));
           
   if (error_or_peer_connection.ok()) {
-    peer_connection_ = std::move(error_or_peer_connection.value());
-    RTC_LOG(LS_INFO) << "PeerConnection created successfully";
+    session->peer_connection = std::move(error_or_peer_connection.value());
+    sessions_[peer_id] = std::move(session);
+    RTC_LOG(LS_INFO) << "PeerConnection for " << peer_id << " created successfully, sessions: "
+                     << sessions_.size();
     return true;
   } else {
     RTC_LOG(LS_ERROR) << "CreatePeerConnection failed: "
                       << error_or_peer_connection.error().message();
     if (observer_) {
-      observer_->OnError(error_or_peer_connection.error().message());
+      observer_->OnError(peer_id, error_or_peer_connection.error().message());
     }
-    pc_observer_.reset();  // 清理观察者
     return false;
   }
 }
 
-void WebRTCEngine::ClosePeerConnection() {
-  RTC_LOG(LS_INFO) << "Closing peer connection...";
+bool WebRTCEngine::IsPooledPeerConnection(const std::string& peer_id) const {
+  auto session = FindSession(peer_id);
+  return session && session->pooled;
+}
+
+void WebRTCEngine::ClosePeerConnection(const std::string& peer_id) {
+  auto it = sessions_.find(peer_id);
+  if (it == sessions_.end()) {
+    // 没有会话时仍要确保本地采集已释放
+    ReleaseLocalMediaIfUnused();
+    return;
+  }
+  
+  RTC_LOG(LS_INFO) << "Closing peer connection with " << peer_id << "...";
+  std::shared_ptr<PeerSession> session = std::move(it->second);
+  sessions_.erase(it);
+  CloseDataChannels(peer_id);
+  {
+    webrtc::MutexLock lock(&codec_policy_mutex_);
+    peer_codec_policies_.erase(peer_id);
+  }
+  
+  // 移除该连接中的所有 senders (释放对共享track的引用)
+  auto senders = session->peer_connection->GetSenders();
+  for (const auto& sender : senders) {
+    session->peer_connection->RemoveTrackOrError(sender);
+  }
+  RTC_LOG(LS_INFO) << "Removed " << senders.size() << " senders from peer connection";
+  
+  // 关闭连接
+  session->peer_connection->Close();
+  {
+    webrtc::MutexLock lock(&session->candidates_mutex);
+    session->pending_ice_candidates.clear();
+  }
+  RTC_LOG(LS_INFO) << "Peer connection with " << peer_id << " closed, remaining: "
+                   << sessions_.size();
+  
+  // 最后一个会话关闭时停止采集并释放本地轨道
+  ReleaseLocalMediaIfUnused();
+  
+  // 在后台为下一次通话补齐预热连接
+  RefillPeerConnectionPool();
+}
+
+void WebRTCEngine::CloseAllPeerConnections() {
+  std::vector<std::string> peer_ids = GetPeerIds();
+  for (const auto& peer_id : peer_ids) {
+    ClosePeerConnection(peer_id);
+  }
+  ReleaseLocalMediaIfUnused();
+}
+
+void WebRTCEngine::ReleaseLocalMediaIfUnused() {
+  if (!sessions_.empty() || (!video_source_ && !local_video_track_ && !local_audio_track_)) {
+    return;
+  }
   
   // 第一步: 显式停止摄像头采集(最重要!)
   if (video_source_) {
@@ -379,127 +833,494 @@ void WebRTCEngine::ClosePeerConnection() {
     RTC_LOG(LS_INFO) << "Local audio track disabled";
   }
   
-  // 第三步: 移除 PeerConnection 中的所有 senders (释放对track的引用)
-  if (peer_connection_) {
-    auto senders = peer_connection_->GetSenders();
-    for (const auto& sender : senders) {
-      peer_connection_->RemoveTrackOrError(sender);
-    }
-    RTC_LOG(LS_INFO) << "Removed " << senders.size() << " senders from peer connection";
-    
-    // 关闭连接
-    peer_connection_->Close();
-    peer_connection_ = nullptr;
-    RTC_LOG(LS_INFO) << "Peer connection closed";
-  }
-  
-  // 第四步: 释放本地媒体轨道 (释放对source的引用)
+  // 第三步: 释放本地媒体轨道 (各连接的 sender 已移除，不再引用)
   local_video_track_ = nullptr;
   local_audio_track_ = nullptr;
   
-  // 第五步: 释放 video_source (现在引用计数应该为0,触发析构)
+  // 第四步: 释放 video_source (现在引用计数应该为0,触发析构)
   video_source_ = nullptr;
   RTC_LOG(LS_INFO) << "Video source released";
-  
-  // 第六步: 清理观察者和其他资源
-  pc_observer_.reset();
-  pending_ice_candidates_.clear();
-  
-  RTC_LOG(LS_INFO) << "Peer connection closed successfully";
 }
 
-bool WebRTCEngine::AddTracks() {
-  if (!peer_connection_) {
-    RTC_LOG(LS_ERROR) << "Cannot add tracks: no peer connection";
+bool WebRTCEngine::AddTracks(const std::string& peer_id) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot add tracks: no peer connection for " << peer_id;
     return false;
   }
 
-  if (!peer_connection_->GetSenders().empty()) {
-    RTC_LOG(LS_WARNING) << "Tracks already added";
-    return true;
+  // 预热连接自带没有轨道的 sender，只有挂上轨道才算已添加
+  for (const auto& sender : session->peer_connection->GetSenders()) {
+    if (sender->track()) {
+      RTC_LOG(LS_WARNING) << "Tracks already added";
+      return true;
+    }
+  }
+
+  // 本地采集源和轨道由所有会话共享，只在第一个会话时创建；
+  // 每个连接的 sender 各自编码
+  if (!video_source_) {
+    video_source_ = CapturerTrackSource::Create(
+        capture_task_queue_factory_ ? *capture_task_queue_factory_
+                                    : env_.task_queue_factory());
+    if (video_source_) {
+      local_video_track_ = peer_connection_factory_->CreateVideoTrack(video_source_, "video_label");
+      if (observer_) {
+        observer_->OnLocalVideoTrackAdded(local_video_track_.get());
+      }
+    }
+  }
+  if (!local_audio_track_) {
+    webrtc::AudioOptions audio_options;
+    auto audio_source = peer_connection_factory_->CreateAudioSource(audio_options);
+    local_audio_track_ = peer_connection_factory_->CreateAudioTrack("audio_label", audio_source.get());
   }
 
   // 添加视频轨道
-  video_source_ = CapturerTrackSource::Create(env_.task_queue_factory());
-  if (video_source_) {
-    local_video_track_ = peer_connection_factory_->CreateVideoTrack(video_source_, "video_label");
-    auto result_or_error = peer_connection_->AddTrack(local_video_track_, {"stream_id"});
-    
-    if (!result_or_error.ok()) {
+  if (local_video_track_) {
+    // 远端 offer 只复用 AddTrack 建的收发器，被叫不带同播编码
+    auto error = AttachLocalTrack(session->peer_connection, local_video_track_,
+                                  webrtc::MediaType::VIDEO,
+                                  session->will_offer ? BuildVideoSendEncodings()
+                                                      : std::vector<webrtc::RtpEncodingParameters>());
+    if (!error.ok()) {
       RTC_LOG(LS_ERROR) << "Failed to add video track: "
-                        << result_or_error.error().message();
+                        << error.message();
       if (observer_) {
-        observer_->OnError("Failed to add video track");
+        observer_->OnError(peer_id, "Failed to add video track");
       }
       return false;
-    } else {
+    }
+  }
+
+  // 添加音频轨道
+  auto error = AttachLocalTrack(session->peer_connection, local_audio_track_,
+                                webrtc::MediaType::AUDIO);
+  if (!error.ok()) {
+    RTC_LOG(LS_ERROR) << "Failed to add audio track: "
+                      << error.message();
+    if (observer_) {
+      observer_->OnError(peer_id, "Failed to add audio track");
+    }
+    return false;
+  }
+
+  return true;
+}
+
+bool WebRTCEngine::AddSendTransceivers(const std::string& peer_id) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot add transceivers: no peer connection for " << peer_id;
+    return false;
+  }
+
+  // 预热连接已经带着收发器
+  const auto transceivers = session->peer_connection->GetTransceivers();
+  webrtc::RtpTransceiverInit init;
+  init.direction = webrtc::RtpTransceiverDirection::kSendRecv;
+  init.stream_ids = {"stream_id"};
+  for (webrtc::MediaType media_type :
+       {webrtc::MediaType::VIDEO, webrtc::MediaType::AUDIO}) {
+    const bool present = std::any_of(
+        transceivers.begin(), transceivers.end(), [media_type](const auto& transceiver) {
+          return transceiver->media_type() == media_type && !transceiver->stopping();
+        });
+    if (present) {
+      continue;
+    }
+    init.send_encodings = media_type == webrtc::MediaType::VIDEO
+                              ? BuildVideoSendEncodings()
+                              : std::vector<webrtc::RtpEncodingParameters>();
+    auto transceiver = session->peer_connection->AddTransceiver(media_type, init);
+    if (!transceiver.ok()) {
+      RTC_LOG(LS_ERROR) << "Failed to add transceiver: " << transceiver.error().message();
       if (observer_) {
-        observer_->OnLocalVideoTrackAdded(local_video_track_.get());
+        observer_->OnError(peer_id, "Failed to add transceiver");
       }
+      return false;
     }
   }
+  return true;
+}
 
-  // 添加音频轨道
-  webrtc::AudioOptions audio_options;
-  auto audio_source = peer_connection_factory_->CreateAudioSource(audio_options);
-  local_audio_track_ = peer_connection_factory_->CreateAudioTrack("audio_label", audio_source.get());
-  auto result_or_error = peer_connection_->AddTrack(local_audio_track_, {"stream_id"});
+webrtc::RTCError WebRTCEngine::AttachLocalTrack(
+    const webrtc::scoped_refptr<webrtc::PeerConnectionInterface>& peer_connection,
+    webrtc::scoped_refptr<webrtc::MediaStreamTrackInterface> track,
+    webrtc::MediaType media_type,
+    const std::vector<webrtc::RtpEncodingParameters>& send_encodings) {
+  for (const auto& transceiver : peer_connection->GetTransceivers()) {
+    auto sender = transceiver->sender();
+    if (transceiver->media_type() == media_type && !transceiver->stopping() &&
+        !sender->track()) {
+      if (!sender->SetTrack(track.get())) {
+        return webrtc::RTCError(webrtc::RTCErrorType::INTERNAL_ERROR,
+                                "SetTrack on pre-added transceiver failed");
+      }
+      return webrtc::RTCError::OK();
+    }
+  }
+  
+  if (!send_encodings.empty()) {
+    webrtc::RtpTransceiverInit init;
+    init.direction = webrtc::RtpTransceiverDirection::kSendRecv;
+    init.stream_ids = {"stream_id"};
+    init.send_encodings = send_encodings;
+    auto transceiver_or_error = peer_connection->AddTransceiver(track, init);
+    if (!transceiver_or_error.ok()) {
+      return transceiver_or_error.MoveError();
+    }
+    return webrtc::RTCError::OK();
+  }
   
+  auto result_or_error = peer_connection->AddTrack(track, {"stream_id"});
   if (!result_or_error.ok()) {
-    RTC_LOG(LS_ERROR) << "Failed to add audio track: "
-                      << result_or_error.error().message();
-    if (observer_) {
-      observer_->OnError("Failed to add audio track");
+    return result_or_error.MoveError();
+  }
+  return webrtc::RTCError::OK();
+}
+
+std::vector<webrtc::RtpEncodingParameters> WebRTCEngine::BuildVideoSendEncodings() const {
+  std::vector<webrtc::RtpEncodingParameters> encodings;
+  webrtc::MutexLock lock(&codec_policy_mutex_);
+  if (!send_layers_.enabled || send_layers_.simulcast_layers.size() < 2) {
+    return encodings;
+  }
+  for (const auto& layer : send_layers_.simulcast_layers) {
+    webrtc::RtpEncodingParameters encoding;
+    encoding.rid = layer.rid;
+    encoding.scale_resolution_down_by = layer.scale_resolution_down_by;
+    if (layer.max_bitrate_bps > 0) {
+      encoding.max_bitrate_bps = layer.max_bitrate_bps;
+    }
+    encodings.push_back(encoding);
+  }
+  return encodings;
+}
+
+void WebRTCEngine::SetVideoSendLayers(const VideoSendLayersConfig& config) {
+  {
+    webrtc::MutexLock lock(&codec_policy_mutex_);
+    send_layers_ = config;
+  }
+  // 池中连接的收发器是按旧配置建的
+  if (pool_target_size_ > 0) {
+    DrainPeerConnectionPool();
+    RefillPeerConnectionPool();
+  }
+}
+
+webrtc::scoped_refptr<webrtc::RtpSenderInterface> WebRTCEngine::FindVideoSender(
+    const PeerSession& session) const {
+  for (const auto& sender : session.peer_connection->GetSenders()) {
+    if (sender->media_type() == webrtc::MediaType::VIDEO && sender->track()) {
+      return sender;
+    }
+  }
+  return nullptr;
+}
+
+void WebRTCEngine::ApplyVideoSendLayers(PeerSession& session) {
+  VideoSendLayersConfig config;
+  {
+    webrtc::MutexLock lock(&codec_policy_mutex_);
+    config = send_layers_;
+  }
+  auto sender = FindVideoSender(session);
+  if (!config.enabled || !sender) {
+    return;
+  }
+  
+  webrtc::RtpParameters parameters = sender->GetParameters();
+  if (parameters.codecs.empty() || parameters.encodings.empty()) {
+    return;
+  }
+  // 第一个协商出的编解码器就是发送用的
+  const std::string& codec = parameters.codecs.front().name;
+  const bool svc = absl::EqualsIgnoreCase(codec, "VP9") || absl::EqualsIgnoreCase(codec, "AV1");
+  auto& encodings = parameters.encodings;
+  
+  if (svc) {
+    // 一路编码内分空间/时间层；其余同播层关掉，码率上限取各层之和
+    int total_bitrate_bps = 0;
+    for (const auto& layer : config.simulcast_layers) {
+      total_bitrate_bps += layer.max_bitrate_bps;
+    }
+    encodings[0].active = true;
+    encodings[0].scalability_mode = config.svc_scalability_mode;
+    encodings[0].scale_resolution_down_by = 1.0;
+    if (encodings.size() > 1 && total_bitrate_bps > 0) {
+      encodings[0].max_bitrate_bps = total_bitrate_bps;
     }
+    for (size_t i = 1; i < encodings.size(); ++i) {
+      encodings[i].active = false;
+    }
+  } else {
+    // VP8/H264：同播各层按配置恢复(重新协商前可能切到过 SVC)
+    for (size_t i = 0; i < encodings.size(); ++i) {
+      encodings[i].active = true;
+      encodings[i].scalability_mode = std::nullopt;
+      if (encodings.size() > 1 && i < config.simulcast_layers.size()) {
+        const auto& layer = config.simulcast_layers[i];
+        encodings[i].scale_resolution_down_by = layer.scale_resolution_down_by;
+        if (layer.max_bitrate_bps > 0) {
+          encodings[i].max_bitrate_bps = layer.max_bitrate_bps;
+        }
+      }
+    }
+  }
+  
+  // 上面按分层配置重置了码率，再叠加会话的发送限制
+  {
+    webrtc::MutexLock lock(&session.limits_mutex);
+    if (session.video_limits) {
+      ApplyVideoSendLimits(*session.video_limits, config, parameters);
+    }
+  }
+  
+  webrtc::RTCError error = sender->SetParameters(parameters);
+  if (!error.ok()) {
+    RTC_LOG(LS_WARNING) << "Applying video send layers for " << session.peer_id
+                        << " failed: " << error.message();
+    return;
+  }
+  RTC_LOG(LS_INFO) << "Video send layers for " << session.peer_id << ": " << codec << " "
+                   << (svc ? config.svc_scalability_mode
+                           : std::to_string(encodings.size()) + " simulcast encoding(s)");
+}
+
+bool WebRTCEngine::SetVideoLayerSettings(const std::string& peer_id,
+                                         size_t layer_index,
+                                         const VideoLayerSettings& settings) {
+  auto session = FindSession(peer_id);
+  auto sender = session ? FindVideoSender(*session) : nullptr;
+  if (!sender) {
+    RTC_LOG(LS_WARNING) << "Cannot set video layer: no video sender for " << peer_id;
     return false;
   }
+  
+  webrtc::RtpParameters parameters = sender->GetParameters();
+  if (layer_index >= parameters.encodings.size()) {
+    RTC_LOG(LS_WARNING) << "Video layer " << layer_index << " out of range, encodings: "
+                        << parameters.encodings.size();
+    return false;
+  }
+  webrtc::RtpEncodingParameters& encoding = parameters.encodings[layer_index];
+  if (settings.active) {
+    encoding.active = *settings.active;
+  }
+  if (settings.max_bitrate_bps) {
+    encoding.max_bitrate_bps = *settings.max_bitrate_bps;
+  }
+  if (settings.scale_resolution_down_by) {
+    encoding.scale_resolution_down_by = *settings.scale_resolution_down_by;
+  }
+  if (settings.max_framerate) {
+    encoding.max_framerate = *settings.max_framerate;
+  }
+  
+  webrtc::RTCError error = sender->SetParameters(parameters);
+  if (!error.ok()) {
+    RTC_LOG(LS_WARNING) << "SetParameters for video layer " << layer_index
+                        << " failed: " << error.message();
+    return false;
+  }
+  return true;
+}
+
+void WebRTCEngine::ApplyVideoSendLimits(const VideoSendLimits& limits,
+                                        const VideoSendLayersConfig& layers,
+                                        webrtc::RtpParameters& parameters) {
+  parameters.degradation_preference = limits.degradation_preference;
+  
+  std::vector<webrtc::RtpEncodingParameters*> active;
+  std::vector<int> base_bitrates;  // 各活跃层的配置码率
+  for (size_t i = 0; i < parameters.encodings.size(); ++i) {
+    if (!parameters.encodings[i].active) {
+      continue;
+    }
+    active.push_back(&parameters.encodings[i]);
+    base_bitrates.push_back(i < layers.simulcast_layers.size()
+                                ? layers.simulcast_layers[i].max_bitrate_bps
+                                : 0);
+  }
+  if (active.empty()) {
+    return;
+  }
+  
+  for (auto* encoding : active) {
+    encoding->max_framerate = limits.max_framerate > 0
+                                  ? std::optional<double>(limits.max_framerate)
+                                  : std::nullopt;
+    encoding->min_bitrate_bps = std::nullopt;
+  }
+  if (limits.min_bitrate_bps > 0) {
+    active.front()->min_bitrate_bps = limits.min_bitrate_bps;
+  }
+  
+  if (active.size() == 1) {
+    // 单层或 SVC：SVC 时不限制也要保留分层配置的总码率
+    int base_total = 0;
+    if (layers.enabled && parameters.encodings.size() > 1) {
+      for (const auto& layer : layers.simulcast_layers) {
+        base_total += layer.max_bitrate_bps;
+      }
+    }
+    const int max_bitrate_bps = limits.max_bitrate_bps > 0 ? limits.max_bitrate_bps : base_total;
+    active.front()->max_bitrate_bps = max_bitrate_bps > 0
+                                          ? std::optional<int>(max_bitrate_bps)
+                                          : std::nullopt;
+    return;
+  }
+  
+  // 同播：总上限低于各层配置之和时按比例压低每层
+  int base_total = 0;
+  for (int bitrate : base_bitrates) {
+    base_total += bitrate;
+  }
+  for (size_t i = 0; i < active.size(); ++i) {
+    int max_bitrate_bps = base_bitrates[i];
+    if (limits.max_bitrate_bps > 0 && base_total > limits.max_bitrate_bps) {
+      max_bitrate_bps = static_cast<int>(
+          static_cast<int64_t>(base_bitrates[i]) * limits.max_bitrate_bps / base_total);
+    }
+    active[i]->max_bitrate_bps = max_bitrate_bps > 0
+                                     ? std::optional<int>(max_bitrate_bps)
+                                     : std::nullopt;
+  }
+}
 
+bool WebRTCEngine::SetVideoSendLimits(const std::string& peer_id,
+                                      const VideoSendLimits& limits) {
+  auto session = FindSession(peer_id);
+  auto sender = session ? FindVideoSender(*session) : nullptr;
+  if (!sender) {
+    RTC_LOG(LS_WARNING) << "Cannot set video send limits: no video sender for " << peer_id;
+    return false;
+  }
+  
+  VideoSendLayersConfig layers;
+  {
+    webrtc::MutexLock lock(&codec_policy_mutex_);
+    layers = send_layers_;
+  }
+  webrtc::RtpParameters parameters = sender->GetParameters();
+  ApplyVideoSendLimits(limits, layers, parameters);
+  webrtc::RTCError error = sender->SetParameters(parameters);
+  if (!error.ok()) {
+    RTC_LOG(LS_WARNING) << "SetParameters for video send limits failed: " << error.message();
+    return false;
+  }
+  {
+    webrtc::MutexLock lock(&session->limits_mutex);
+    session->video_limits = limits;
+  }
+  RTC_LOG(LS_INFO) << "Video send limits for " << peer_id << ": max "
+                   << limits.max_bitrate_bps << " bps, min " << limits.min_bitrate_bps
+                   << " bps, max " << limits.max_framerate << " fps";
   return true;
 }
 
-void WebRTCEngine::CreateOffer() {
-  if (!peer_connection_) {
-    RTC_LOG(LS_ERROR) << "Cannot create offer: no peer connection";
+std::optional<VideoSendLimits> WebRTCEngine::GetVideoSendLimits(
+    const std::string& peer_id) const {
+  auto session = FindSession(peer_id);
+  auto sender = session ? FindVideoSender(*session) : nullptr;
+  if (!sender) {
+    return std::nullopt;
+  }
+  
+  // 各活跃层上限之和(任一层不限则不限)、最低活跃层下限、最高帧率上限
+  const webrtc::RtpParameters parameters = sender->GetParameters();
+  VideoSendLimits limits;
+  limits.degradation_preference = parameters.degradation_preference;
+  bool first_active = true;
+  bool bitrate_unlimited = false;
+  for (const auto& encoding : parameters.encodings) {
+    if (!encoding.active) {
+      continue;
+    }
+    bitrate_unlimited |= !encoding.max_bitrate_bps;
+    limits.max_bitrate_bps += encoding.max_bitrate_bps.value_or(0);
+    if (first_active) {
+      limits.min_bitrate_bps = encoding.min_bitrate_bps.value_or(0);
+      first_active = false;
+    }
+    limits.max_framerate = std::max(limits.max_framerate, encoding.max_framerate.value_or(0.0));
+  }
+  if (bitrate_unlimited) {
+    limits.max_bitrate_bps = 0;
+  }
+  return limits;
+}
+
+std::vector<webrtc::RtpEncodingParameters> WebRTCEngine::GetVideoEncodings(
+    const std::string& peer_id) const {
+  auto session = FindSession(peer_id);
+  auto sender = session ? FindVideoSender(*session) : nullptr;
+  if (!sender) {
+    return {};
+  }
+  return sender->GetParameters().encodings;
+}
+
+void WebRTCEngine::CreateOffer(const std::string& peer_id) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot create offer: no peer connection for " << peer_id;
     return;
   }
 
-  RTC_LOG(LS_INFO) << "=== Creating Offer ===";
-  is_creating_offer_ = true;
+  RTC_LOG(LS_INFO) << "=== Creating Offer for " << peer_id << " ===";
+  // 主叫还不知道对端能力，按本地策略排序，协商时取双方都支持的第一个
+  ApplyVideoCodecPolicy(*session, nullptr);
+  
   webrtc::PeerConnectionInterface::RTCOfferAnswerOptions options;
   options.offer_to_receive_audio = true;
   options.offer_to_receive_video = true;
   
-  auto observer = CreateSessionDescriptionObserverImpl::Create(this, true);
-  peer_connection_->CreateOffer(observer.get(), options);
+  auto observer = CreateSessionDescriptionObserverImpl::Create(this, session, true);
+  session->peer_connection->CreateOffer(observer.get(), options);
   RTC_LOG(LS_INFO) << "CreateOffer called on peer_connection";
 }
 
-void WebRTCEngine::CreateAnswer() {
-  if (!peer_connection_) {
-    RTC_LOG(LS_ERROR) << "Cannot create answer: no peer connection";
+void WebRTCEngine::CreateAnswer(const std::string& peer_id) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot create answer: no peer connection for " << peer_id;
     return;
   }
 
-  RTC_LOG(LS_INFO) << "=== Creating Answer ===";
-  is_creating_offer_ = false;
+  RTC_LOG(LS_INFO) << "=== Creating Answer for " << peer_id << " ===";
   webrtc::PeerConnectionInterface::RTCOfferAnswerOptions options;
   
-  auto observer = CreateSessionDescriptionObserverImpl::Create(this, false);
-  peer_connection_->CreateAnswer(observer.get(), options);
+  auto observer = CreateSessionDescriptionObserverImpl::Create(this, session, false);
+  session->peer_connection->CreateAnswer(observer.get(), options);
   RTC_LOG(LS_INFO) << "CreateAnswer called on peer_connection";
 }
 
-void WebRTCEngine::SetRemoteOffer(const std::string& sdp) {
-  SetRemoteDescription("offer", sdp);
+void WebRTCEngine::SetRemoteOffer(const std::string& peer_id, const std::string& sdp) {
+  SetRemoteDescription(peer_id, "offer", sdp);
 }
 
-void WebRTCEngine::SetRemoteAnswer(const std::string& sdp) {
-  SetRemoteDescription("answer", sdp);
+void WebRTCEngine::SetRemoteAnswer(const std::string& peer_id, const std::string& sdp) {
+  SetRemoteDescription(peer_id, "answer", sdp);
+}
+
+std::string WebRTCEngine::GetLocalDescriptionSdp(const std::string& peer_id) const {
+  std::string sdp;
+  auto session = FindSession(peer_id);
+  if (session && session->peer_connection->local_description()) {
+    session->peer_connection->local_description()->ToString(&sdp);
+  }
+  return sdp;
 }
 
-void WebRTCEngine::SetRemoteDescription(const std::string& type, const std::string& sdp) {
-  if (!peer_connection_) {
-    RTC_LOG(LS_ERROR) << "Cannot set remote description: no peer connection";
+void WebRTCEngine::SetRemoteDescription(const std::string& peer_id,
+                                        const std::string& type,
+                                        const std::string& sdp) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot set remote description: no peer connection for " << peer_id;
     return;
   }
 
@@ -510,103 +1331,384 @@ void WebRTCEngine::SetRemoteDescription(const std::string& type, const std::stri
   if (!session_desc) {
     RTC_LOG(LS_ERROR) << "Failed to parse SDP: " << error.description;
     if (observer_) {
-      observer_->OnError("Failed to parse SDP: " + error.description);
+      observer_->OnError(peer_id, "Failed to parse SDP: " + error.description);
     }
     return;
   }
 
-  auto observer = SetRemoteDescriptionObserver::Create([this](webrtc::RTCError error) {
+  // 远端 offer 里的视频编解码器就是对端的能力
+  std::set<std::string> remote_codecs;
+  if (sdp_type == webrtc::SdpType::kOffer) {
+    remote_codecs = ParseVideoCodecNames(sdp);
+  }
+  
+  auto observer = SetRemoteDescriptionObserver::Create(
+      [this, session, sdp_type, remote_codecs](webrtc::RTCError error) {
     if (!error.ok()) {
       RTC_LOG(LS_ERROR) << "SetRemoteDescription failed: " << error.message();
       if (observer_) {
-        observer_->OnError(std::string("SetRemoteDescription failed: ") + error.message());
+        observer_->OnError(session->peer_id,
+                           std::string("SetRemoteDescription failed: ") + error.message());
       }
     } else {
-      RTC_LOG(LS_INFO) << "SetRemoteDescription succeeded";
-      ProcessPendingIceCandidates();
+      RTC_LOG(LS_INFO) << "SetRemoteDescription succeeded for " << session->peer_id;
+      // 在同一操作内完成，早于随后排队的 CreateAnswer
+      if (sdp_type == webrtc::SdpType::kOffer) {
+        ApplyVideoCodecPolicy(*session, &remote_codecs);
+      } else {
+        // 主叫：发送编解码器已经确定
+        ApplyVideoSendLayers(*session);
+      }
+      ProcessPendingIceCandidates(*session);
     }
   });
 
-  peer_connection_->SetRemoteDescription(std::move(session_desc), observer);
+  session->peer_connection->SetRemoteDescription(std::move(session_desc), observer);
+}
+
+void WebRTCEngine::SetVideoCodecPolicy(const VideoCodecPolicy& policy) {
+  webrtc::MutexLock lock(&codec_policy_mutex_);
+  video_codec_policy_ = policy;
+}
+
+void WebRTCEngine::SetVideoCodecPolicy(const std::string& peer_id,
+                                       const VideoCodecPolicy& policy) {
+  webrtc::MutexLock lock(&codec_policy_mutex_);
+  peer_codec_policies_[peer_id] = policy;
+}
+
+void WebRTCEngine::UpdateCpuLoad(double process_cpu_percent) {
+  webrtc::MutexLock lock(&codec_policy_mutex_);
+  cpu_load_percent_ = process_cpu_percent;
+}
+
+void WebRTCEngine::ApplyVideoCodecPolicy(PeerSession& session,
+                                         const std::set<std::string>* remote_codecs) {
+  VideoCodecPolicy policy;
+  double cpu_load_percent = 0.0;
+  {
+    webrtc::MutexLock lock(&codec_policy_mutex_);
+    auto it = peer_codec_policies_.find(session.peer_id);
+    policy = it != peer_codec_policies_.end() ? it->second : video_codec_policy_;
+    cpu_load_percent = cpu_load_percent_;
+  }
+  
+  // 偏好必须是接收能力的子集
+  const webrtc::RtpCapabilities capabilities =
+      peer_connection_factory_->GetRtpReceiverCapabilities(webrtc::MediaType::VIDEO);
+  const std::vector<webrtc::RtpCodecCapability> codecs =
+      SelectVideoCodecs(capabilities.codecs, policy, cpu_load_percent, remote_codecs);
+  if (codecs.empty()) {
+    RTC_LOG(LS_WARNING) << "Codec policy leaves no video codec for " << session.peer_id
+                        << ", keeping default order";
+    return;
+  }
+  
+  for (const auto& transceiver : session.peer_connection->GetTransceivers()) {
+    if (transceiver->media_type() != webrtc::MediaType::VIDEO || transceiver->stopping()) {
+      continue;
+    }
+    webrtc::RTCError error = transceiver->SetCodecPreferences(codecs);
+    if (!error.ok()) {
+      RTC_LOG(LS_WARNING) << "SetCodecPreferences failed for " << session.peer_id
+                          << ": " << error.message();
+    }
+  }
+  RTC_LOG(LS_INFO) << "Video codec preference for " << session.peer_id << ": "
+                   << codecs.front().name << " first (process CPU "
+                   << cpu_load_percent << "%, budget " << policy.cpu_budget_percent
+                   << "%, remote codecs " << (remote_codecs ? "known" : "unknown") << ")";
+}
+
+bool WebRTCEngine::CreateDataChannel(const std::string& peer_id,
+                                     const std::string& label,
+                                     const DataChannelOptions& options) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_ERROR) << "Cannot create data channel: no peer connection for " << peer_id;
+    return false;
+  }
+  
+  webrtc::DataChannelInit init;
+  init.ordered = options.ordered;
+  init.maxRetransmitTime = options.max_retransmit_time_ms;
+  init.maxRetransmits = options.max_retransmits;
+  init.protocol = options.protocol;
+  
+  auto result = session->peer_connection->CreateDataChannelOrError(label, &init);
+  if (!result.ok()) {
+    RTC_LOG(LS_ERROR) << "CreateDataChannel " << label << " failed: "
+                      << result.error().message();
+    if (observer_) {
+      observer_->OnError(peer_id, std::string("CreateDataChannel failed: ") +
+                                      result.error().message());
+    }
+    return false;
+  }
+  AddDataChannel(peer_id, result.MoveValue(), /*notify_if_open=*/false);
+  return true;
 }
 
-void WebRTCEngine::AddIceCandidate(const std::string& sdp_mid, 
+bool WebRTCEngine::SendData(const std::string& peer_id,
+                            const std::string& label,
+                            webrtc::CopyOnWriteBuffer data) {
+  auto channel = FindDataChannel(peer_id, label);
+  if (!channel || channel->state() != webrtc::DataChannelInterface::kOpen) {
+    return false;
+  }
+  // 排队的数据超过上限时 WebRTC 会直接关闭通道，这里先拒绝
+  if (channel->buffered_amount() + data.size() >
+      webrtc::DataChannelInterface::MaxSendQueueSize()) {
+    return false;
+  }
+  
+  // DataBuffer 与 |data| 共享同一块内存，只增加引用计数
+  channel->SendAsync(webrtc::DataBuffer(data, /*binary=*/true),
+                     [peer_id, label](webrtc::RTCError error) {
+    if (!error.ok()) {
+      RTC_LOG(LS_WARNING) << "Data channel " << label << " with " << peer_id
+                          << " send failed: " << error.message();
+    }
+  });
+  return true;
+}
+
+uint64_t WebRTCEngine::GetDataChannelBufferedAmount(const std::string& peer_id,
+                                                    const std::string& label) const {
+  auto channel = FindDataChannel(peer_id, label);
+  return channel ? channel->buffered_amount() : 0;
+}
+
+std::optional<webrtc::DataChannelInterface::DataState> WebRTCEngine::GetDataChannelState(
+    const std::string& peer_id, const std::string& label) const {
+  auto channel = FindDataChannel(peer_id, label);
+  if (!channel) {
+    return std::nullopt;
+  }
+  return channel->state();
+}
+
+void WebRTCEngine::CloseDataChannel(const std::string& peer_id, const std::string& label) {
+  // 保留登记和观察者，应用仍能收到 closing/closed；会话关闭时一并清除
+  if (auto channel = FindDataChannel(peer_id, label)) {
+    channel->Close();
+  }
+}
+
+void WebRTCEngine::AddDataChannel(const std::string& peer_id,
+                                  webrtc::scoped_refptr<webrtc::DataChannelInterface> channel,
+                                  bool notify_if_open) {
+  DataChannelEntry entry;
+  entry.channel = channel;
+  entry.observer = std::make_unique<DataChannelObserverImpl>(this, peer_id, channel.get());
+  // 代理调用会切到信令线程，不能持锁
+  channel->RegisterObserver(entry.observer.get());
+  
+  DataChannelEntry replaced;
+  {
+    webrtc::MutexLock lock(&data_channels_mutex_);
+    DataChannelEntry& slot = data_channels_[peer_id][channel->label()];
+    replaced = std::move(slot);
+    slot = std::move(entry);
+  }
+  if (replaced.channel) {
+    RTC_LOG(LS_WARNING) << "Data channel " << channel->label() << " with " << peer_id
+                        << " replaces an earlier one";
+    replaced.channel->UnregisterObserver();
+    replaced.channel->Close();
+  }
+  
+  if (notify_if_open && channel->state() == webrtc::DataChannelInterface::kOpen && observer_) {
+    observer_->OnDataChannelStateChanged(peer_id, channel->label(),
+                                         webrtc::DataChannelInterface::kOpen);
+  }
+}
+
+void WebRTCEngine::CloseDataChannels(const std::string& peer_id) {
+  std::map<std::string, DataChannelEntry> channels;
+  {
+    webrtc::MutexLock lock(&data_channels_mutex_);
+    auto it = data_channels_.find(peer_id);
+    if (it == data_channels_.end()) {
+      return;
+    }
+    channels = std::move(it->second);
+    data_channels_.erase(it);
+  }
+  // 先注销再关闭，观察者随 |channels| 销毁时不会再有回调
+  for (auto& [label, entry] : channels) {
+    entry.channel->UnregisterObserver();
+    entry.channel->Close();
+  }
+}
+
+webrtc::scoped_refptr<webrtc::DataChannelInterface> WebRTCEngine::FindDataChannel(
+    const std::string& peer_id, const std::string& label) const {
+  webrtc::MutexLock lock(&data_channels_mutex_);
+  auto peer_it = data_channels_.find(peer_id);
+  if (peer_it == data_channels_.end()) {
+    return nullptr;
+  }
+  auto it = peer_it->second.find(label);
+  return it != peer_it->second.end() ? it->second.channel : nullptr;
+}
+
+void WebRTCEngine::OnPeerConnectionDataChannel(
+    const std::string& peer_id,
+    webrtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+  RTC_LOG(LS_INFO) << "Remote data channel " << channel->label() << " from " << peer_id;
+  AddDataChannel(peer_id, std::move(channel), /*notify_if_open=*/true);
+}
+
+void WebRTCEngine::SetIceRestartConfig(const IceRestartConfig& config) {
+  webrtc::MutexLock lock(&ice_restart_mutex_);
+  ice_restart_config_ = config;
+}
+
+void WebRTCEngine::AddIceCandidate(const std::string& peer_id,
+                                    const std::string& sdp_mid, 
                                     int sdp_mline_index, 
                                     const std::string& candidate) {
-  if (!peer_connection_) {
-    RTC_LOG(LS_WARNING) << "Cannot add ICE candidate: no peer connection";
+  AddIceCandidates(peer_id, {RemoteIceCandidate{sdp_mid, sdp_mline_index, candidate}});
+}
+
+void WebRTCEngine::AddIceCandidates(const std::string& peer_id,
+                                     const std::vector<RemoteIceCandidate>& candidates) {
+  auto session = FindSession(peer_id);
+  if (!session) {
+    RTC_LOG(LS_WARNING) << "Cannot add " << candidates.size()
+                        << " ICE candidate(s): no peer connection for " << peer_id;
     return;
   }
 
-  webrtc::SdpParseError error;
-  std::unique_ptr<webrtc::IceCandidate> ice_candidate(
-      webrtc::CreateIceCandidate(sdp_mid, sdp_mline_index, candidate, &error));
-      
-  if (!ice_candidate) {
-    RTC_LOG(LS_ERROR) << "Failed to parse ICE candidate: " << error.description;
+  std::vector<std::unique_ptr<webrtc::IceCandidate>> parsed;
+  parsed.reserve(candidates.size());
+  for (const RemoteIceCandidate& candidate : candidates) {
+    webrtc::SdpParseError error;
+    std::unique_ptr<webrtc::IceCandidate> ice_candidate(webrtc::CreateIceCandidate(
+        candidate.sdp_mid, candidate.sdp_mline_index, candidate.candidate, &error));
+    if (!ice_candidate) {
+      RTC_LOG(LS_ERROR) << "Failed to parse ICE candidate: " << error.description;
+      continue;
+    }
+    parsed.push_back(std::move(ice_candidate));
+  }
+  if (parsed.empty()) {
     return;
   }
 
-  if (!peer_connection_->remote_description()) {
-    RTC_LOG(LS_INFO) << "Remote description not set yet, queueing ICE candidate";
-    pending_ice_candidates_.push_back(ice_candidate.release());
-    return;
+  {
+    webrtc::MutexLock lock(&session->candidates_mutex);
+    if (!session->peer_connection->remote_description()) {
+      RTC_LOG(LS_INFO) << "Remote description not set yet, queueing " << parsed.size()
+                       << " ICE candidate(s)";
+      for (auto& ice_candidate : parsed) {
+        session->pending_ice_candidates.push_back(std::move(ice_candidate));
+      }
+      return;
+    }
   }
 
-  if (!peer_connection_->AddIceCandidate(ice_candidate.get())) {
-    RTC_LOG(LS_ERROR) << "Failed to add ICE candidate";
+  for (const auto& ice_candidate : parsed) {
+    if (!session->peer_connection->AddIceCandidate(ice_candidate.get())) {
+      RTC_LOG(LS_ERROR) << "Failed to add ICE candidate";
+    }
   }
 }
 
-void WebRTCEngine::ProcessPendingIceCandidates() {
-  if (!peer_connection_ || !peer_connection_->remote_description()) {
-    return;
+void WebRTCEngine::ProcessPendingIceCandidates(PeerSession& session) {
+  std::deque<std::unique_ptr<webrtc::IceCandidate>> candidates;
+  {
+    webrtc::MutexLock lock(&session.candidates_mutex);
+    candidates.swap(session.pending_ice_candidates);
   }
 
-  for (const auto* candidate : pending_ice_candidates_) {
-    if (!peer_connection_->AddIceCandidate(candidate)) {
+  for (const auto& candidate : candidates) {
+    if (!session.peer_connection->AddIceCandidate(candidate.get())) {
       RTC_LOG(LS_ERROR) << "Failed to add pending ICE candidate";
     }
-    delete candidate;
   }
-  pending_ice_candidates_.clear();
 }
 
-bool WebRTCEngine::IsConnected() const {
-  if (!peer_connection_) {
+bool WebRTCEngine::IsConnected(const std::string& peer_id) const {
+  auto session = FindSession(peer_id);
+  if (!session) {
     return false;
   }
   
-  auto state = peer_connection_->ice_connection_state();
+  auto state = session->peer_connection->ice_connection_state();
   return state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
          state == webrtc::PeerConnectionInterface::kIceConnectionCompleted;
 }
 
+bool WebRTCEngine::HasPeerConnection(const std::string& peer_id) const {
+  return sessions_.count(peer_id) != 0;
+}
+
+webrtc::scoped_refptr<webrtc::PeerConnectionInterface> WebRTCEngine::GetPeerConnection(
+    const std::string& peer_id) const {
+  auto session = FindSession(peer_id);
+  return session ? session->peer_connection : nullptr;
+}
+
+std::vector<std::string> WebRTCEngine::GetPeerIds() const {
+  std::vector<std::string> peer_ids;
+  peer_ids.reserve(sessions_.size());
+  for (const auto& entry : sessions_) {
+    peer_ids.push_back(entry.first);
+  }
+  return peer_ids;
+}
+
 void WebRTCEngine::CollectStats(
+    const std::string& peer_id,
     std::function<void(const webrtc::scoped_refptr<const webrtc::RTCStatsReport>&)> callback) {
-  if (!peer_connection_) {
+  auto session = FindSession(peer_id);
+  if (!session) {
     if (callback) {
       callback(nullptr);
     }
     return;
   }
-  peer_connection_->GetStats(new webrtc::RefCountedObject<StatsCollectorCallback>(std::move(callback)));
+  session->peer_connection->GetStats(
+      new webrtc::RefCountedObject<StatsCollectorCallback>(std::move(callback)));
 }
 
 void WebRTCEngine::Shutdown() {
   RTC_LOG(LS_INFO) << "Shutting down WebRTC Engine...";
   
-  // 关闭对等连接
-  ClosePeerConnection();
+  // 先停预热线程(等待进行中的预热结束)，再关闭池中连接，避免关闭后又被补齐
+  pool_target_size_ = 0;
+  if (pool_thread_) {
+    pool_thread_->Stop();
+    pool_thread_ = nullptr;
+  }
+  {
+    // Stop() 会丢弃尚未执行的预热任务
+    webrtc::MutexLock lock(&pool_mutex_);
+    pool_pending_ = 0;
+  }
+  DrainPeerConnectionPool();
+  
+  // 关闭所有对等连接
+  CloseAllPeerConnections();
   
   // 释放工厂（这会停止所有线程）
   peer_connection_factory_ = nullptr;
   
-  // 停止信令线程
+  // 停止信令、网络和工作线程
   if (signaling_thread_) {
     signaling_thread_->Stop();
     signaling_thread_ = nullptr;
   }
+  if (network_thread_) {
+    network_thread_->Stop();
+    network_thread_ = nullptr;
+  }
+  if (worker_thread_) {
+    worker_thread_->Stop();
+    worker_thread_ = nullptr;
+  }
   
   RTC_LOG(LS_INFO) << "WebRTC Engine shutdown complete";
 }
@@ -615,45 +1717,221 @@ void WebRTCEngine::Shutdown() {
 // 内部回调方法 - 从观察者类调用
 // ============================================================================
 
-void WebRTCEngine::OnPeerConnectionAddTrack(webrtc::RtpReceiverInterface* receiver) {
-  RTC_LOG(LS_INFO) << "Track added: " << receiver->id();
+void WebRTCEngine::OnPeerConnectionAddTrack(const std::string& peer_id,
+                                            webrtc::RtpReceiverInterface* receiver) {
+  RTC_LOG(LS_INFO) << "Track added from " << peer_id << ": " << receiver->id();
   auto* track = receiver->track().get();
   
   if (track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
     auto* video_track = static_cast<webrtc::VideoTrackInterface*>(track);
     if (observer_) {
-      observer_->OnRemoteVideoTrackAdded(video_track);
+      observer_->OnRemoteVideoTrackAdded(peer_id, video_track);
     }
   }
 }
 
-void WebRTCEngine::OnPeerConnectionRemoveTrack(webrtc::RtpReceiverInterface* receiver) {
-  RTC_LOG(LS_INFO) << "Track removed: " << receiver->id();
+void WebRTCEngine::OnPeerConnectionRemoveTrack(const std::string& peer_id,
+                                               webrtc::RtpReceiverInterface* receiver) {
+  RTC_LOG(LS_INFO) << "Track removed from " << peer_id << ": " << receiver->id();
   auto* track = receiver->track().get();
   
   if (track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
     if (observer_) {
-      observer_->OnRemoteVideoTrackRemoved();
+      observer_->OnRemoteVideoTrackRemoved(peer_id);
     }
   }
 }
 
 void WebRTCEngine::OnPeerConnectionIceConnectionChange(
+    const std::string& peer_id,
+    const std::shared_ptr<PeerSession>& session,
     webrtc::PeerConnectionInterface::IceConnectionState new_state) {
-  RTC_LOG(LS_INFO) << "ICE connection state changed: " << new_state;
+  RTC_LOG(LS_INFO) << "ICE connection state with " << peer_id << " changed: " << new_state;
   
   if (observer_) {
-    observer_->OnIceConnectionStateChanged(new_state);
+    observer_->OnIceConnectionStateChanged(peer_id, new_state);
+  }
+  if (session) {
+    UpdateIceRecovery(session, new_state);
+  }
+}
+
+void WebRTCEngine::UpdateIceRecovery(
+    const std::shared_ptr<PeerSession>& session,
+    webrtc::PeerConnectionInterface::IceConnectionState new_state) {
+  PeerSession& s = *session;
+  switch (new_state) {
+    case webrtc::PeerConnectionInterface::kIceConnectionConnected:
+    case webrtc::PeerConnectionInterface::kIceConnectionCompleted: {
+      // 作废尚未执行的重启和重启超时
+      ++s.ice_restart_generation;
+      s.ice_restart_offer_pending = false;
+      if (s.ice_interrupted_ms == 0) {
+        return;
+      }
+      const int64_t recovery_ms = webrtc::TimeMillis() - s.ice_interrupted_ms;
+      const int restarts = s.ice_restart_attempts;
+      s.ice_interrupted_ms = 0;
+      s.ice_restart_attempts = 0;
+      RTC_LOG(LS_INFO) << "ICE with " << s.peer_id << " recovered after " << recovery_ms
+                       << " ms, " << restarts << " restart(s)";
+      if (observer_) {
+        observer_->OnIceRecovered(s.peer_id, recovery_ms, restarts);
+      }
+      return;
+    }
+    case webrtc::PeerConnectionInterface::kIceConnectionDisconnected:
+    case webrtc::PeerConnectionInterface::kIceConnectionFailed: {
+      const bool failed = new_state == webrtc::PeerConnectionInterface::kIceConnectionFailed;
+      int delay_ms = 0;
+      {
+        webrtc::MutexLock lock(&ice_restart_mutex_);
+        if (!ice_restart_config_.enabled) {
+          return;
+        }
+        if (s.ice_restart_attempts > 0) {
+          // 上一次重启没能恢复，按重试间隔再来
+          const int64_t since_last_ms = webrtc::TimeMillis() - s.ice_last_restart_ms;
+          delay_ms = static_cast<int>(std::max<int64_t>(
+              0, ice_restart_config_.retry_interval_ms - since_last_ms));
+        } else if (!failed) {
+          delay_ms = ice_restart_config_.grace_period_ms;
+        }
+      }
+      if (s.ice_interrupted_ms == 0) {
+        s.ice_interrupted_ms = webrtc::TimeMillis();
+      }
+      ScheduleIceRestart(session, delay_ms);
+      return;
+    }
+    case webrtc::PeerConnectionInterface::kIceConnectionClosed:
+      ++s.ice_restart_generation;
+      s.ice_restart_offer_pending = false;
+      s.ice_interrupted_ms = 0;
+      return;
+    default:
+      // checking/new：重启进行中，结果以随后的 connected 或 failed 为准
+      return;
   }
 }
 
-void WebRTCEngine::OnPeerConnectionIceCandidate(const webrtc::IceCandidate* candidate) {
-  RTC_LOG(LS_INFO) << "ICE candidate generated: " << candidate->sdp_mline_index();
+void WebRTCEngine::ScheduleIceRestart(const std::shared_ptr<PeerSession>& session,
+                                      int delay_ms) {
+  // 被叫不发起重启，等主叫的重启 offer
+  if (!session->will_offer) {
+    return;
+  }
+  const uint64_t generation = ++session->ice_restart_generation;
+  std::weak_ptr<PeerSession> weak_session = session;
+  signaling_thread_->PostDelayedTask(
+      [this, weak_session, generation] {
+        auto session = weak_session.lock();
+        if (session && session->ice_restart_generation == generation) {
+          RestartIce(session);
+        }
+      },
+      webrtc::TimeDelta::Millis(delay_ms));
+}
+
+void WebRTCEngine::RestartIce(const std::shared_ptr<PeerSession>& session) {
+  auto& peer_connection = session->peer_connection;
+  const auto signaling_state = peer_connection->signaling_state();
+  if (signaling_state == webrtc::PeerConnectionInterface::kClosed) {
+    return;
+  }
+  
+  int max_attempts = 0;
+  int retry_interval_ms = 0;
+  {
+    webrtc::MutexLock lock(&ice_restart_mutex_);
+    max_attempts = ice_restart_config_.max_attempts;
+    retry_interval_ms = ice_restart_config_.retry_interval_ms;
+  }
+  if (session->ice_restart_attempts >= max_attempts) {
+    RTC_LOG(LS_WARNING) << "ICE with " << session->peer_id << " not recovered after "
+                        << session->ice_restart_attempts << " restart(s), giving up";
+    if (observer_) {
+      observer_->OnError(session->peer_id, "ICE restart failed");
+    }
+    return;
+  }
+  // 正在交换 offer/answer 时不能再发 offer。上一次重启的 answer 没到时
+  // 那次重启已计过数；被别的协商占着时这次也计数，两种情况都不会无限等下去
+  if (signaling_state != webrtc::PeerConnectionInterface::kStable) {
+    if (!session->ice_restart_offer_pending) {
+      ++session->ice_restart_attempts;
+    }
+    session->ice_restart_offer_pending = false;
+    RTC_LOG(LS_WARNING) << "ICE restart with " << session->peer_id
+                        << " blocked in signaling state " << signaling_state;
+    if (signaling_state == webrtc::PeerConnectionInterface::kHaveLocalOffer) {
+      RollbackLocalOffer(session);
+    } else {
+      ScheduleIceRestart(session, retry_interval_ms);
+    }
+    return;
+  }
+  
+  const int attempt = ++session->ice_restart_attempts;
+  session->ice_last_restart_ms = webrtc::TimeMillis();
+  RTC_LOG(LS_INFO) << "Restarting ICE with " << session->peer_id << ", attempt " << attempt;
+  if (observer_) {
+    observer_->OnIceRestarting(session->peer_id, attempt);
+  }
+  
+  // 只换 ICE 凭据：收发器、轨道和编解码器偏好保持不变
+  webrtc::PeerConnectionInterface::RTCOfferAnswerOptions options;
+  options.offer_to_receive_audio = true;
+  options.offer_to_receive_video = true;
+  options.ice_restart = true;
+  
+  auto observer = CreateSessionDescriptionObserverImpl::Create(this, session, true);
+  peer_connection->CreateOffer(observer.get(), options);
+  
+  // 重启超时：answer 丢失或 ICE 停在 checking 时不会再有状态变化，
+  // 到时仍未连通(连通会作废它)就进入下一次尝试
+  session->ice_restart_offer_pending = true;
+  ScheduleIceRestart(session, retry_interval_ms);
+}
+
+void WebRTCEngine::RollbackLocalOffer(const std::shared_ptr<PeerSession>& session) {
+  RTC_LOG(LS_INFO) << "Rolling back unanswered local offer to " << session->peer_id;
+  const uint64_t generation = ++session->ice_restart_generation;
+  std::weak_ptr<PeerSession> weak_session = session;
+  auto observer = SetLocalDescriptionObserver::Create(
+      [this, weak_session, generation](webrtc::RTCError error) {
+        auto session = weak_session.lock();
+        if (!session) {
+          return;
+        }
+        // 期间已经连通就不再重启
+        if (session->ice_restart_generation != generation) {
+          return;
+        }
+        int delay_ms = 0;
+        if (!error.ok()) {
+          RTC_LOG(LS_WARNING) << "Rolling back local offer to " << session->peer_id
+                              << " failed: " << error.message();
+          webrtc::MutexLock lock(&ice_restart_mutex_);
+          delay_ms = ice_restart_config_.retry_interval_ms;
+        }
+        ScheduleIceRestart(session, delay_ms);
+      });
+  session->peer_connection->SetLocalDescription(
+      webrtc::CreateSessionDescription(webrtc::SdpType::kRollback, std::string()),
+      observer);
+}
+
+void WebRTCEngine::OnPeerConnectionIceCandidate(const std::string& peer_id,
+                                                const webrtc::IceCandidate* candidate) {
+  RTC_LOG(LS_INFO) << "ICE candidate generated for " << peer_id << ": "
+                   << candidate->sdp_mline_index();
   
   std::string candidate_str;
   if (candidate->ToString(&candidate_str)) {
     if (observer_) {
       observer_->OnIceCandidateGenerated(
+          peer_id,
           candidate->sdp_mid(), 
           candidate->sdp_mline_index(), 
           candidate_str);
@@ -661,28 +1939,47 @@ void WebRTCEngine::OnPeerConnectionIceCandidate(const webrtc::IceCandidate* cand
   }
 }
 
-void WebRTCEngine::OnSessionDescriptionSuccess(webrtc::SessionDescriptionInterface* desc, bool is_offer) {
-  RTC_LOG(LS_INFO) << "=== OnSessionDescriptionSuccess called, is_offer: " << is_offer << " ===";
+void WebRTCEngine::OnPeerConnectionIceGatheringChange(
+    const std::string& peer_id,
+    webrtc::PeerConnectionInterface::IceGatheringState new_state) {
+  RTC_LOG(LS_INFO) << "ICE gathering state with " << peer_id << " changed: " << new_state;
+  
+  if (new_state == webrtc::PeerConnectionInterface::kIceGatheringComplete && observer_) {
+    observer_->OnIceGatheringComplete(peer_id);
+  }
+}
+
+void WebRTCEngine::OnSessionDescriptionSuccess(const std::shared_ptr<PeerSession>& session,
+                                               webrtc::SessionDescriptionInterface* desc,
+                                               bool is_offer) {
+  RTC_LOG(LS_INFO) << "=== OnSessionDescriptionSuccess called, peer: " << session->peer_id
+                   << " is_offer: " << is_offer << " ===";
   
   std::string sdp;
   desc->ToString(&sdp);
 
-  auto observer = SetLocalDescriptionObserver::Create([this, sdp, is_offer](webrtc::RTCError error) {
+  const std::string peer_id = session->peer_id;
+  auto observer = SetLocalDescriptionObserver::Create(
+      [this, session, peer_id, sdp, is_offer](webrtc::RTCError error) {
     if (!error.ok()) {
       RTC_LOG(LS_ERROR) << "SetLocalDescription failed: " << error.message();
       if (observer_) {
-        observer_->OnError(std::string("SetLocalDescription failed: ") + error.message());
+        observer_->OnError(peer_id, std::string("SetLocalDescription failed: ") + error.message());
       }
     } else {
       RTC_LOG(LS_INFO) << "SetLocalDescription succeeded, is_offer: " << is_offer;
+      if (!is_offer) {
+        // 被叫：本地 answer 生效后发送编解码器才确定
+        ApplyVideoSendLayers(*session);
+      }
       
       if (observer_) {
         if (is_offer) {
           RTC_LOG(LS_INFO) << "Calling observer_->OnOfferCreated()";
-          observer_->OnOfferCreated(sdp);
+          observer_->OnOfferCreated(peer_id, sdp);
         } else {
           RTC_LOG(LS_INFO) << "Calling observer_->OnAnswerCreated()";
-          observer_->OnAnswerCreated(sdp);
+          observer_->OnAnswerCreated(peer_id, sdp);
         }
       } else {
         RTC_LOG(LS_ERROR) << "observer_ is null!";
@@ -691,14 +1988,15 @@ void WebRTCEngine::OnSessionDescriptionSuccess(webrtc::SessionDescriptionInterfa
   });
 
   RTC_LOG(LS_INFO) << "Calling SetLocalDescription...";
-  peer_connection_->SetLocalDescription(
+  session->peer_connection->SetLocalDescription(
       std::unique_ptr<webrtc::SessionDescriptionInterface>(desc), observer);
 }
 
-void WebRTCEngine::OnSessionDescriptionFailure(const std::string& error) {
-  RTC_LOG(LS_ERROR) << "Create session description failed: " << error;
+void WebRTCEngine::OnSessionDescriptionFailure(const std::string& peer_id,
+                                               const std::string& error) {
+  RTC_LOG(LS_ERROR) << "Create session description for " << peer_id << " failed: " << error;
   
   if (observer_) {
-    observer_->OnError("Create session description failed: " + error);
+    observer_->OnError(peer_id, "Create session description failed: " + error);
   }
 }
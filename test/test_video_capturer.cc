@@ -10,6 +10,7 @@
 
 #include "test/test_video_capturer.h"
 
+#include <algorithm>
 #include <optional>
 #include <utility>
 
@@ -31,19 +32,23 @@ void TestVideoCapturer::OnOutputFormatRequest(
     int width,
     int height,
     const std::optional<int>& max_fps) {
-  std::optional<std::pair<int, int>> target_aspect_ratio =
-      std::make_pair(width, height);
-  std::optional<int> max_pixel_count = width * height;
-  video_adapter_.OnOutputFormatRequest(target_aspect_ratio, max_pixel_count,
-                                       max_fps);
+  MutexLock lock(&sinks_lock_);
+  output_aspect_ratio_ = std::make_pair(width, height);
+  output_max_pixel_count_ = width * height;
+  output_max_fps_ = max_fps;
+  for (auto& sink : sinks_) {
+    ApplyOutputFormatRequest(sink->adapter);
+  }
 }
 
-void TestVideoCapturer::OnFrame(const VideoFrame& original_frame) {
-  int cropped_width = 0;
-  int cropped_height = 0;
-  int out_width = 0;
-  int out_height = 0;
+void TestVideoCapturer::ApplyOutputFormatRequest(VideoAdapter& adapter) {
+  if (output_aspect_ratio_) {
+    adapter.OnOutputFormatRequest(output_aspect_ratio_,
+                                  output_max_pixel_count_, output_max_fps_);
+  }
+}
 
+void TestVideoCapturer::OnFrame(const VideoFrame& original_frame) {
   VideoFrame frame = MaybePreprocess(original_frame);
 
   bool enable_adaptation;
@@ -51,62 +56,153 @@ void TestVideoCapturer::OnFrame(const VideoFrame& original_frame) {
     MutexLock lock(&lock_);
     enable_adaptation = enable_adaptation_;
   }
-  if (!enable_adaptation) {
-    broadcaster_.OnFrame(frame);
-    return;
-  }
 
-  if (!video_adapter_.AdaptFrameResolution(
-          frame.width(), frame.height(), frame.timestamp_us() * 1000,
-          &cropped_width, &cropped_height, &out_width, &out_height)) {
-    // Drop frame in order to respect frame rate constraint.
-    return;
-  }
+  MutexLock lock(&sinks_lock_);
+  scaled_frames_.clear();
+  for (auto& sink : sinks_) {
+    if (!enable_adaptation) {
+      sink->broadcaster.OnFrame(frame);
+      continue;
+    }
 
-  if (out_height != frame.height() || out_width != frame.width()) {
-    // Video adapter has requested a down-scale. Allocate a new buffer and
-    // return scaled version.
-    // For simplicity, only scale here without cropping.
-    scoped_refptr<I420Buffer> scaled_buffer =
-        I420Buffer::Create(out_width, out_height);
-    scaled_buffer->ScaleFrom(*frame.video_frame_buffer()->ToI420());
-    VideoFrame::Builder new_frame_builder =
-        VideoFrame::Builder()
-            .set_video_frame_buffer(scaled_buffer)
-            .set_rotation(kVideoRotation_0)
-            .set_timestamp_us(frame.timestamp_us())
-            .set_id(frame.id());
-    if (frame.has_update_rect()) {
-      VideoFrame::UpdateRect new_rect = frame.update_rect().ScaleWithFrame(
-          frame.width(), frame.height(), 0, 0, frame.width(), frame.height(),
-          out_width, out_height);
-      new_frame_builder.set_update_rect(new_rect);
+    int cropped_width = 0;
+    int cropped_height = 0;
+    int out_width = 0;
+    int out_height = 0;
+    if (!sink->adapter.AdaptFrameResolution(
+            frame.width(), frame.height(), frame.timestamp_us() * 1000,
+            &cropped_width, &cropped_height, &out_width, &out_height)) {
+      // Drop frame in order to respect this sink's frame rate constraint.
+      continue;
     }
-    broadcaster_.OnFrame(new_frame_builder.build());
 
-  } else {
-    // No adaptations needed, just return the frame as is.
-    broadcaster_.OnFrame(frame);
+    if (out_height == frame.height() && out_width == frame.width()) {
+      // No adaptations needed, just pass the frame on as is.
+      sink->broadcaster.OnFrame(frame);
+      continue;
+    }
+
+    // Video adapter has requested a down-scale. Sinks asking for the same
+    // size, e.g. several encoder layers, share one scaled copy.
+    const ScaledFrame* scaled = nullptr;
+    for (const ScaledFrame& candidate : scaled_frames_) {
+      if (candidate.width == out_width && candidate.height == out_height) {
+        scaled = &candidate;
+        break;
+      }
+    }
+    if (!scaled) {
+      scaled_frames_.push_back(
+          {out_width, out_height, ScaleFrame(frame, out_width, out_height)});
+      scaled = &scaled_frames_.back();
+    }
+    sink->broadcaster.OnFrame(scaled->frame);
   }
+  // Do not hold on to buffers between frames.
+  scaled_frames_.clear();
+}
+
+VideoFrame TestVideoCapturer::ScaleFrame(const VideoFrame& frame,
+                                         int width,
+                                         int height) {
+  // For simplicity, only scale here without cropping.
+  scoped_refptr<I420Buffer> scaled_buffer = I420Buffer::Create(width, height);
+  scaled_buffer->ScaleFrom(*frame.video_frame_buffer()->ToI420());
+  VideoFrame::Builder new_frame_builder =
+      VideoFrame::Builder()
+          .set_video_frame_buffer(scaled_buffer)
+          .set_rotation(kVideoRotation_0)
+          .set_timestamp_us(frame.timestamp_us())
+          .set_id(frame.id());
+  if (frame.has_update_rect()) {
+    VideoFrame::UpdateRect new_rect = frame.update_rect().ScaleWithFrame(
+        frame.width(), frame.height(), 0, 0, frame.width(), frame.height(),
+        width, height);
+    new_frame_builder.set_update_rect(new_rect);
+  }
+  return new_frame_builder.build();
 }
 
 VideoSinkWants TestVideoCapturer::GetSinkWants() {
-  return broadcaster_.wants();
+  MutexLock lock(&sinks_lock_);
+  if (sinks_.empty()) {
+    return VideoSinkWants();
+  }
+
+  // Alignment (LCM), target pixel count, requested resolution, is_active
+  // and the aggregates come from the broadcaster unchanged.
+  VideoSinkWants wants = wants_aggregator_.wants();
+
+  // The broadcaster takes the minimum pixel count and frame rate, which
+  // would let the preview lower the encoder's input; take the maximum over
+  // the active sinks instead, or over all of them if none is active.
+  const bool any_active =
+      std::any_of(sinks_.begin(), sinks_.end(),
+                  [](const std::unique_ptr<SinkAdapter>& sink) {
+                    return sink->wants.is_active;
+                  });
+  wants.max_pixel_count = 0;
+  wants.max_framerate_fps = 0;
+  wants.resolutions.clear();
+  for (const auto& sink : sinks_) {
+    if (any_active && !sink->wants.is_active) {
+      continue;
+    }
+    wants.rotation_applied |= sink->wants.rotation_applied;
+    wants.max_pixel_count =
+        std::max(wants.max_pixel_count, sink->wants.max_pixel_count);
+    wants.max_framerate_fps =
+        std::max(wants.max_framerate_fps, sink->wants.max_framerate_fps);
+    // Every layer any encoder is configured with
+    for (const auto& resolution : sink->wants.resolutions) {
+      const bool known = std::any_of(
+          wants.resolutions.begin(), wants.resolutions.end(),
+          [&resolution](const VideoSinkWants::FrameSize& known_resolution) {
+            return known_resolution.width == resolution.width &&
+                   known_resolution.height == resolution.height;
+          });
+      if (!known) {
+        wants.resolutions.push_back(resolution);
+      }
+    }
+  }
+  if (wants.target_pixel_count &&
+      *wants.target_pixel_count > wants.max_pixel_count) {
+    wants.target_pixel_count = wants.max_pixel_count;
+  }
+  return wants;
 }
 
 void TestVideoCapturer::AddOrUpdateSink(VideoSinkInterface<VideoFrame>* sink,
                                         const VideoSinkWants& wants) {
-  broadcaster_.AddOrUpdateSink(sink, wants);
-  UpdateVideoAdapter();
+  MutexLock lock(&sinks_lock_);
+  auto it = std::find_if(sinks_.begin(), sinks_.end(),
+                         [sink](const std::unique_ptr<SinkAdapter>& entry) {
+                           return entry->sink == sink;
+                         });
+  SinkAdapter* entry = nullptr;
+  if (it != sinks_.end()) {
+    entry = it->get();
+  } else {
+    sinks_.push_back(std::make_unique<SinkAdapter>());
+    entry = sinks_.back().get();
+    entry->sink = sink;
+    ApplyOutputFormatRequest(entry->adapter);
+  }
+  entry->wants = wants;
+  wants_aggregator_.AddOrUpdateSink(sink, wants);
+  entry->broadcaster.AddOrUpdateSink(sink, wants);
+  entry->adapter.OnSinkWants(entry->broadcaster.wants());
 }
 
 void TestVideoCapturer::RemoveSink(VideoSinkInterface<VideoFrame>* sink) {
-  broadcaster_.RemoveSink(sink);
-  UpdateVideoAdapter();
-}
-
-void TestVideoCapturer::UpdateVideoAdapter() {
-  video_adapter_.OnSinkWants(broadcaster_.wants());
+  MutexLock lock(&sinks_lock_);
+  wants_aggregator_.RemoveSink(sink);
+  sinks_.erase(std::remove_if(sinks_.begin(), sinks_.end(),
+                              [sink](const std::unique_ptr<SinkAdapter>& entry) {
+                                return entry->sink == sink;
+                              }),
+               sinks_.end());
 }
 
 VideoFrame TestVideoCapturer::MaybePreprocess(const VideoFrame& frame) {
@@ -13,6 +13,7 @@
 #include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
@@ -47,6 +48,7 @@ class TestVideoCapturer : public VideoSourceInterface<VideoFrame> {
     MutexLock lock(&lock_);
     enable_adaptation_ = enable_adaptation;
   }
+  // Applies to every sink, on top of the sink's own wants.
   void OnOutputFormatRequest(int width,
                              int height,
                              const std::optional<int>& max_fps);
@@ -63,17 +65,50 @@ class TestVideoCapturer : public VideoSourceInterface<VideoFrame> {
 
  protected:
   void OnFrame(const VideoFrame& frame);
+  // What the capturer itself should produce: the most demanding resolution
+  // and frame rate across all sinks. Each sink's adapter reduces from there.
+  // Every other field is aggregated the way VideoBroadcaster does it.
   VideoSinkWants GetSinkWants();
 
  private:
-  void UpdateVideoAdapter();
+  // Every sink is adapted separately, so a small preview asking for few
+  // pixels does not lower the resolution sent to the encoder.
+  struct SinkAdapter {
+    VideoSinkInterface<VideoFrame>* sink = nullptr;
+    VideoSinkWants wants;
+    VideoAdapter adapter;
+    // Delivers to |sink| only; keeps the broadcaster's black-frame and
+    // update-rect handling per sink.
+    VideoBroadcaster broadcaster;
+  };
+
+  // An adapted frame shared by all sinks that asked for the same size.
+  struct ScaledFrame {
+    int width;
+    int height;
+    VideoFrame frame;
+  };
+
+  void ApplyOutputFormatRequest(VideoAdapter& adapter)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(sinks_lock_);
+  VideoFrame ScaleFrame(const VideoFrame& frame, int width, int height);
   VideoFrame MaybePreprocess(const VideoFrame& frame);
 
   Mutex lock_;
   std::unique_ptr<FramePreprocessor> preprocessor_ RTC_GUARDED_BY(lock_);
   bool enable_adaptation_ RTC_GUARDED_BY(lock_) = true;
-  VideoBroadcaster broadcaster_;
-  VideoAdapter video_adapter_;
+
+  Mutex sinks_lock_;
+  std::vector<std::unique_ptr<SinkAdapter>> sinks_
+      RTC_GUARDED_BY(sinks_lock_);
+  std::optional<std::pair<int, int>> output_aspect_ratio_
+      RTC_GUARDED_BY(sinks_lock_);
+  std::optional<int> output_max_pixel_count_ RTC_GUARDED_BY(sinks_lock_);
+  std::optional<int> output_max_fps_ RTC_GUARDED_BY(sinks_lock_);
+  // Holds every sink only to aggregate their wants; never gets frames.
+  VideoBroadcaster wants_aggregator_;
+  // Reused by OnFrame so sinks with equal adapted sizes share one scale.
+  std::vector<ScaledFrame> scaled_frames_ RTC_GUARDED_BY(sinks_lock_);
 };
 }  // namespace test
 }  // namespace webrtc
@@ -427,7 +427,7 @@ func (c *WebRTCClient) readPump() {
 			log.Printf("忽略注册消息，客户端已注册: %s", c.uid)
 		case "list-clients":
 			c.server.sendClientList(c)
-		case "offer", "answer", "ice-candidate", "conflict-resolution",
+		case "offer", "answer", "ice-candidate", "ice-candidates", "conflict-resolution",
 			"call-request", "call-response", "call-cancel", "call-end":
 			// 转发信令消息
 			if msg.To == "" {
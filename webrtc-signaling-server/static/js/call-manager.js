@@ -19,6 +19,7 @@ class CallManager {
         this.signalingManager.registerHandler('offer', this.handleOffer.bind(this));
         this.signalingManager.registerHandler('answer', this.handleAnswer.bind(this));
         this.signalingManager.registerHandler('ice-candidate', this.handleIceCandidate.bind(this));
+        this.signalingManager.registerHandler('ice-candidates', this.handleIceCandidates.bind(this));
         this.signalingManager.registerHandler('user-offline', this.handleUserOffline.bind(this));
     }
     
@@ -262,6 +263,18 @@ class CallManager {
         this.onIceCandidateReceived?.(message);
     }
     
+    // 批量候选按单个候选逐一交给上层处理
+    handleIceCandidates(message) {
+        if (this.currentCall !== message.from) {
+            return;
+        }
+        
+        const candidates = message.payload?.candidates || [];
+        for (const candidate of candidates) {
+            this.onIceCandidateReceived?.({ ...message, type: 'ice-candidate', payload: { candidate } });
+        }
+    }
+    
     clearCallTimeouts() {
         if (this.callRequestTimeout) {
             clearTimeout(this.callRequestTimeout);